@@ -0,0 +1,97 @@
+/*
+ * Copyright © 2020 Reza Hasanzadeh
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 3.0 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/*
+   times the scalar, SSE2 and AVX2 page filter kernels on an A4 page
+   rendered at 300 dpi and prints each one's throughput. the best of a few
+   rounds is kept so a cold cache or a context switch does not count. build
+   and run with 'make bench'.
+*/
+
+#include "../src/page_filter.c"
+#include <string.h>
+
+/* A4 at 300 dpi, 4 bytes per pixel */
+#define SURFACE_WIDTH 2480
+#define SURFACE_HEIGHT 3508
+#define SURFACE_SIZE ((gsize)SURFACE_WIDTH * SURFACE_HEIGHT * 4)
+#define NUM_ROUNDS 10
+
+typedef struct
+{
+    const char *isa;
+    KernelFunc kernels[NumKernels];
+}KernelSet;
+
+static void
+time_kernels(const KernelSet *set,
+             guint8          *surface)
+{
+    g_print("%-6s",
+            set->isa);
+    for(int kernel = 0; kernel < NumKernels; kernel++){
+        gint64 best_time_us = G_MAXINT64;
+        for(int round = 0; round < NUM_ROUNDS; round++){
+            gint64 start = g_get_monotonic_time();
+            set->kernels[kernel](surface,
+                                 SURFACE_SIZE);
+            gint64 elapsed = g_get_monotonic_time() - start;
+            best_time_us = MIN(best_time_us, elapsed);
+        }
+        g_print(" %s %6.2f GB/s%s",
+                kernel_names[kernel],
+                best_time_us > 0 ? SURFACE_SIZE / (best_time_us * 1000.0) : 0.0,
+                kernel < NumKernels - 1 ? "," : "\n");
+    }
+}
+
+int
+main(void)
+{
+    guint8 *surface = g_malloc(SURFACE_SIZE);
+    GRand *rand = g_rand_new_with_seed(46);
+    /* mostly white paper with some ink, like a text page */
+    memset(surface, 0xff, SURFACE_SIZE);
+    for(gsize i = 0; i < SURFACE_SIZE; i += g_rand_int_range(rand, 1, 64)){
+        surface[i] = g_rand_int_range(rand, 0, 256);
+    }
+    g_rand_free(rand);
+    g_print("%dx%d surface, %.1f MB, best of %d rounds\n",
+            SURFACE_WIDTH,
+            SURFACE_HEIGHT,
+            SURFACE_SIZE / 1e6,
+            NUM_ROUNDS);
+
+    KernelSet scalar = {"scalar", {invert_scalar, tint_scalar, contrast_scalar}};
+    time_kernels(&scalar,
+                 surface);
+#ifdef HAVE_X86_KERNELS
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("sse2")){
+        KernelSet sse2 = {"sse2", {invert_sse2, tint_sse2, contrast_sse2}};
+        time_kernels(&sse2,
+                     surface);
+    }
+    if(__builtin_cpu_supports("avx2")){
+        KernelSet avx2 = {"avx2", {invert_avx2, tint_avx2, contrast_avx2}};
+        time_kernels(&avx2,
+                     surface);
+    }
+#endif
+    g_free(surface);
+    return 0;
+}
@@ -0,0 +1,210 @@
+/*
+ * Copyright © 2020 Reza Hasanzadeh
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 3.0 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/*
+   the per-page overlay lists(links, units, figure references, find results)
+   used to be GLists and are GPtrArrays now. this times both on the character
+   boxes of a real PDF, as many items per page as the page has characters:
+   import builds the lists, draw walks them, hit-test looks up the item under
+   a point and cursor steps through them by position the way find next and
+   previous do. build and run with 'make bench PDF=some.pdf'.
+*/
+
+#include <glib.h>
+#include <poppler/glib/poppler.h>
+#include "rect.h"
+
+#define NUM_PROBES 256
+/* stepping a GList by position is quadratic, keep it bounded */
+#define MAX_CURSOR_ITEMS 512
+
+typedef struct
+{
+    const char *name;
+    gint64 list_time_us;
+    gint64 array_time_us;
+}Timing;
+
+static void
+print_timing(const Timing *timing)
+{
+    g_print("%-10s GList %8.2f ms, GPtrArray %8.2f ms, %.1fx\n",
+            timing->name,
+            timing->list_time_us / 1000.0,
+            timing->array_time_us / 1000.0,
+            timing->array_time_us > 0 ? (double)timing->list_time_us / timing->array_time_us
+                                      : 0.0);
+}
+
+static GPtrArray *
+load_page_rects(PopplerDocument *doc,
+                int              page_num)
+{
+    PopplerPage *page = poppler_document_get_page(doc,
+                                                  page_num);
+    PopplerRectangle *layouts = NULL;
+    guint num_layouts = 0;
+    GPtrArray *rects = g_ptr_array_new_with_free_func((GDestroyNotify)rect_free);
+    if(poppler_page_get_text_layout(page,
+                                    &layouts,
+                                    &num_layouts))
+    {
+        for(guint i = 0; i < num_layouts; i++){
+            g_ptr_array_add(rects,
+                            rect_from_poppler_rectangle(&layouts[i]));
+        }
+        g_free(layouts);
+    }
+    g_object_unref(page);
+    return rects;
+}
+
+int
+main(int    argc,
+     char **argv)
+{
+    if(argc < 2){
+        g_print("usage: %s file.pdf\n",
+                argv[0]);
+        return 1;
+    }
+    GError *err = NULL;
+    char *uri = g_filename_to_uri(argv[1],
+                                  NULL,
+                                  &err);
+    PopplerDocument *doc = uri ? poppler_document_new_from_file(uri,
+                                                                NULL,
+                                                                &err)
+                               : NULL;
+    g_free(uri);
+    if(!doc){
+        g_print("Failed to load document.\ndomain: %d, \ncode: %d, \nmessage: %s\n",
+                err->domain, err->code, err->message);
+        g_error_free(err);
+        return 1;
+    }
+    int num_pages = poppler_document_get_n_pages(doc);
+    GPtrArray *pages = g_ptr_array_new_with_free_func((GDestroyNotify)g_ptr_array_unref);
+    guint num_items = 0;
+    for(int i = 0; i < num_pages; i++){
+        GPtrArray *rects = load_page_rects(doc,
+                                           i);
+        num_items += rects->len;
+        g_ptr_array_add(pages,
+                        rects);
+    }
+    g_print("%d pages, %u items\n",
+            num_pages,
+            num_items);
+
+    Timing import = {"import", 0, 0},
+           draw = {"draw", 0, 0},
+           hit_test = {"hit-test", 0, 0},
+           cursor = {"cursor", 0, 0};
+    /* keeps the walks from being optimized away */
+    double checksum = 0.0;
+    GRand *rand = g_rand_new_with_seed(7);
+    for(guint p = 0; p < pages->len; p++){
+        GPtrArray *rects = g_ptr_array_index(pages,
+                                             p);
+        /* import */
+        gint64 t0 = g_get_monotonic_time();
+        GList *list = NULL;
+        for(guint i = 0; i < rects->len; i++){
+            list = g_list_append(list,
+                                 g_ptr_array_index(rects, i));
+        }
+        gint64 t1 = g_get_monotonic_time();
+        GPtrArray *array = g_ptr_array_new();
+        for(guint i = 0; i < rects->len; i++){
+            g_ptr_array_add(array,
+                            g_ptr_array_index(rects, i));
+        }
+        gint64 t2 = g_get_monotonic_time();
+        import.list_time_us += t1 - t0;
+        import.array_time_us += t2 - t1;
+
+        /* draw */
+        t0 = g_get_monotonic_time();
+        for(GList *list_p = list; list_p; list_p = list_p->next){
+            checksum += rect_width(list_p->data);
+        }
+        t1 = g_get_monotonic_time();
+        for(guint i = 0; i < array->len; i++){
+            checksum += rect_width(g_ptr_array_index(array, i));
+        }
+        t2 = g_get_monotonic_time();
+        draw.list_time_us += t1 - t0;
+        draw.array_time_us += t2 - t1;
+
+        /* hit-test, the same probes over a letter-sized page for both */
+        double xs[NUM_PROBES], ys[NUM_PROBES];
+        for(int i = 0; i < NUM_PROBES; i++){
+            xs[i] = g_rand_double_range(rand, 0, 612);
+            ys[i] = g_rand_double_range(rand, 0, 792);
+        }
+        t0 = g_get_monotonic_time();
+        for(int i = 0; i < NUM_PROBES; i++){
+            for(GList *list_p = list; list_p; list_p = list_p->next){
+                if(rect_contains_point(list_p->data, xs[i], ys[i])){
+                    checksum += 1.0;
+                    break;
+                }
+            }
+        }
+        t1 = g_get_monotonic_time();
+        for(int i = 0; i < NUM_PROBES; i++){
+            for(guint j = 0; j < array->len; j++){
+                if(rect_contains_point(g_ptr_array_index(array, j), xs[i], ys[i])){
+                    checksum += 1.0;
+                    break;
+                }
+            }
+        }
+        t2 = g_get_monotonic_time();
+        hit_test.list_time_us += t1 - t0;
+        hit_test.array_time_us += t2 - t1;
+
+        /* cursor */
+        guint num_cursor_items = MIN(array->len, MAX_CURSOR_ITEMS);
+        t0 = g_get_monotonic_time();
+        for(guint i = 0; i < num_cursor_items; i++){
+            checksum += rect_height(g_list_nth_data(list, i));
+        }
+        t1 = g_get_monotonic_time();
+        for(guint i = 0; i < num_cursor_items; i++){
+            checksum += rect_height(g_ptr_array_index(array, i));
+        }
+        t2 = g_get_monotonic_time();
+        cursor.list_time_us += t1 - t0;
+        cursor.array_time_us += t2 - t1;
+
+        g_list_free(list);
+        g_ptr_array_unref(array);
+    }
+    print_timing(&import);
+    print_timing(&draw);
+    print_timing(&hit_test);
+    print_timing(&cursor);
+    g_print("checksum %g\n",
+            checksum);
+
+    g_rand_free(rand);
+    g_ptr_array_unref(pages);
+    g_object_unref(doc);
+    return 0;
+}
@@ -0,0 +1,82 @@
+/*
+ * Copyright © 2020 Reza Hasanzadeh
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 3.0 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/*
+   feeds the text of every page of a PDF through the unit scanner and the
+   former regex and reports where they disagree and how fast each one is.
+   build and run with 'make bench PDF=some.pdf'.
+*/
+
+#include <glib.h>
+#include <poppler/glib/poppler.h>
+#include "unit_convertor.h"
+#include "regex_registry.h"
+
+int
+main(int    argc,
+     char **argv)
+{
+    if(argc < 2){
+        g_print("usage: %s file.pdf\n",
+                argv[0]);
+        return 1;
+    }
+    GError *err = NULL;
+    char *uri = g_filename_to_uri(argv[1],
+                                  NULL,
+                                  &err);
+    PopplerDocument *doc = uri ? poppler_document_new_from_file(uri,
+                                                                NULL,
+                                                                &err)
+                               : NULL;
+    g_free(uri);
+    if(!doc){
+        g_print("Failed to load document.\ndomain: %d, \ncode: %d, \nmessage: %s\n",
+                err->domain, err->code, err->message);
+        g_error_free(err);
+        return 1;
+    }
+    /* the whole document at once, pages separated by line breaks */
+    GString *text = g_string_new(NULL);
+    int num_pages = poppler_document_get_n_pages(doc);
+    for(int i = 0; i < num_pages; i++){
+        PopplerPage *page = poppler_document_get_page(doc,
+                                                      i);
+        char *page_text = poppler_page_get_text(page);
+        if(page_text){
+            g_string_append(text,
+                            page_text);
+            g_string_append_c(text,
+                              '\n');
+        }
+        g_free(page_text);
+        g_object_unref(page);
+    }
+    g_print("%d pages, %lu bytes of text\n",
+            num_pages,
+            (unsigned long)text->len);
+
+    unit_convertor_module_init();
+    unit_convertor_compare(text->str);
+    unit_convertor_module_destroy();
+    regex_registry_module_destroy();
+
+    g_string_free(text,
+                  TRUE);
+    g_object_unref(doc);
+    return 0;
+}
@@ -22,11 +22,20 @@
 #include <math.h>
 #include "find.h"
 #include "toc_synthesis.h"
+#include "toc_typography.h"
 #include "teleport_widget.h"
 #include "find_widget.h"
 #include "page_meta.h"
+#include "page_store.h"
+#include "memory_pressure.h"
+#include "page_surface.h"
+#include "surface_pool.h"
 #include "unit_convertor.h"
 #include "roman_numeral.h"
+#include "regex_registry.h"
+#include "figure_gallery.h"
+#include "page_strip.h"
+#include "render_pool.h"
 
 /* gainsboro: #DCDCDC, (220, 220, 220) */
 static const double gainsboro_r = 0.8627;
@@ -89,23 +98,51 @@ pose_page_widgets(void)
     ui.panel_rect->y2 = ui.panel_rect->y1 + panel_height;
 }
 
+typedef struct
+{
+    int page_num;
+    double page_width;
+    double page_height;
+    double width;
+    double height;
+    /* known on submission or found by the worker, see render_reading_page_job() */
+    enum PageColor color;
+    gboolean is_preview;
+}PageRenderJob;
+
+typedef struct
+{
+    int page_num;
+    int width;
+    int height;
+    enum PageColor color;
+    cairo_surface_t *image;
+}PrefetchedPage;
+
+/* neighbours of the current page rendered ahead of time, see prefetch_pages() */
+static GList *prefetched_pages = NULL;
+static gint prefetch_generation = 0;
+static guint64 num_prefetch_hits = 0;
+
 static cairo_surface_t *
-render_page (PageMeta *meta,
-             double width,
-             double height)
-{    
-    cairo_surface_t *image = cairo_image_surface_create(CAIRO_FORMAT_ARGB32,
-                                                        width,
-                                                        height);
+render_page_job(PopplerDocument *document,
+                gpointer         data)
+{
+    /* worker thread, painted white all over, no need to clear */
+    const PageRenderJob *job = data;
+    cairo_surface_t *image = surface_pool_create(CAIRO_FORMAT_ARGB32,
+                                                 job->width,
+                                                 job->height,
+                                                 FALSE);
     cairo_t *cr = cairo_create(image);
     cairo_scale(cr, 
-                width / meta->page_width,
-                height / meta->page_height);    
+                job->width / job->page_width,
+                job->height / job->page_height);    
     cairo_set_source_rgb(cr,
                          1, 1, 1);
     cairo_paint(cr);
-    PopplerPage *page = poppler_document_get_page(d.doc,
-                                                  meta->page_num);     
+    PopplerPage *page = poppler_document_get_page(document,
+                                                  job->page_num);     
     poppler_page_render(page,
                         cr);
     cairo_destroy(cr);
@@ -113,6 +150,530 @@ render_page (PageMeta *meta,
     return image;
 }
 
+static cairo_surface_t *
+render_now(RenderFunc render,
+           gpointer   data)
+{
+    /* falls back to the main document if the render pool couldn't open */
+    if(render_pool_is_open()){
+        return render_pool_render_sync(render,
+                                       data);
+    }
+    return render(d.doc,
+                  data);
+}
+
+static cairo_surface_t *
+render_page (PageMeta *meta,
+             double width,
+             double height)
+{    
+    PageRenderJob job = {meta->page_num,
+                         meta->page_width, meta->page_height,
+                         width, height,
+                         meta->color, FALSE};
+    return render_now(render_page_job,
+                      &job);
+}
+
+/*
+   the hovered TOC item's page, drawn on every frame of the TOC mode, so it
+   is rendered by the pool and shown once it arrives rather than waited for.
+*/
+typedef struct
+{
+    int page_num;
+    int width;
+    int height;
+    cairo_surface_t *image;
+    /* the one in the works, -1 for none */
+    int pending_page_num;
+    int pending_width;
+    int pending_height;
+}TocThumbnail;
+
+static TocThumbnail toc_thumbnail = {-1, 0, 0, NULL, -1, 0, 0};
+static gint toc_thumbnail_generation = 0;
+
+static void
+set_toc_thumbnail(cairo_surface_t *image,
+                  int              page_num,
+                  int              width,
+                  int              height)
+{
+    if(toc_thumbnail.image){
+        cairo_surface_destroy(toc_thumbnail.image);
+    }
+    toc_thumbnail.image = image;
+    toc_thumbnail.page_num = page_num;
+    toc_thumbnail.width = width;
+    toc_thumbnail.height = height;
+}
+
+static void
+on_toc_thumbnail_rendered(cairo_surface_t *image,
+                          gpointer         data)
+{
+    /* main thread */
+    const PageRenderJob *job = data;
+    toc_thumbnail.pending_page_num = -1;
+    if(image){
+        set_toc_thumbnail(image,
+                          job->page_num,
+                          job->width,
+                          job->height);
+        gtk_widget_queue_draw(ui.vellum);
+    }
+}
+
+static cairo_surface_t *
+lookup_toc_thumbnail(PageMeta *meta,
+                     int       width,
+                     int       height)
+{
+    /* borrowed, NULL while the page is being rendered */
+    if(toc_thumbnail.image &&
+       toc_thumbnail.page_num == meta->page_num &&
+       toc_thumbnail.width == width &&
+       toc_thumbnail.height == height)
+    {
+        return toc_thumbnail.image;
+    }
+    if(!render_pool_is_open()){
+        /* no workers, render in place */
+        set_toc_thumbnail(render_page(meta,
+                                      width,
+                                      height),
+                          meta->page_num,
+                          width,
+                          height);
+        return toc_thumbnail.image;
+    }
+    if(toc_thumbnail.pending_page_num == meta->page_num &&
+       toc_thumbnail.pending_width == width &&
+       toc_thumbnail.pending_height == height)
+    {
+        return NULL;
+    }
+    /* the item hovered before is of no interest anymore */
+    g_atomic_int_inc(&toc_thumbnail_generation);
+    PageRenderJob *job = g_malloc(sizeof(PageRenderJob));
+    *job = (PageRenderJob){meta->page_num,
+                           meta->page_width, meta->page_height,
+                           width, height,
+                           meta->color, FALSE};
+    toc_thumbnail.pending_page_num = meta->page_num;
+    toc_thumbnail.pending_width = width;
+    toc_thumbnail.pending_height = height;
+    render_pool_submit(RenderPriorityVisible,
+                       &toc_thumbnail_generation,
+                       render_page_job,
+                       on_toc_thumbnail_rendered,
+                       job,
+                       g_free);
+    return NULL;
+}
+
+static void
+drop_toc_thumbnail(void)
+{
+    g_atomic_int_inc(&toc_thumbnail_generation);
+    set_toc_thumbnail(NULL,
+                      -1,
+                      0,
+                      0);
+    toc_thumbnail.pending_page_num = -1;
+}
+
+static void
+prefetched_page_free(PrefetchedPage *prefetched)
+{
+    cairo_surface_destroy(prefetched->image);
+    g_free(prefetched);
+}
+
+static void
+drop_prefetched_pages(void)
+{
+    g_atomic_int_inc(&prefetch_generation);
+    g_list_free_full(prefetched_pages,
+                     (GDestroyNotify)prefetched_page_free);
+    prefetched_pages = NULL;
+}
+
+static cairo_surface_t *
+take_prefetched_page(int             page_num,
+                     int             width,
+                     int             height,
+                     enum PageColor *color)
+{
+    for(GList *list_p = prefetched_pages; list_p; list_p = list_p->next){
+        PrefetchedPage *prefetched = list_p->data;
+        if(prefetched->page_num == page_num &&
+           prefetched->width == width &&
+           prefetched->height == height)
+        {
+            cairo_surface_t *image = prefetched->image;
+            *color = prefetched->color;
+            prefetched_pages = g_list_delete_link(prefetched_pages,
+                                                  list_p);
+            g_free(prefetched);
+            num_prefetch_hits++;
+            return image;
+        }
+    }
+    return NULL;
+}
+
+static cairo_surface_t *
+render_reading_page_job(PopplerDocument *document,
+                        gpointer         data)
+{
+    /*
+       worker thread, monochrome pages are kept as a quarter sized A8 surface.
+       previews are too coarse to tell the color of a page.
+    */
+    PageRenderJob *job = data;
+    cairo_surface_t *image = render_page_job(document,
+                                             data);
+    if(job->color == PageColorUnknown && !job->is_preview){
+        job->color = page_surface_is_monochrome(image) ? PageColorMonochrome
+                                                       : PageColorColored;
+    }
+    if(job->color == PageColorMonochrome){
+        cairo_surface_t *mask = page_surface_to_a8(image);
+        if(mask){
+            cairo_surface_destroy(image);
+            image = mask;
+        }
+    }
+    return image;
+}
+
+static double
+page_render_scale(double width,
+                  double height)
+{
+    /*
+       under memory pressure a page much larger than the viewport, most of it
+       off-screen, is rendered coarser and drawn upscaled.
+    */
+    double max_screens;
+    switch(memory_pressure_get_level()){
+    case MemoryPressureMedium:
+        max_screens = 4.0;
+        break;
+    case MemoryPressureCritical:
+        max_screens = 1.5;
+        break;
+    default:
+        return 1.0;
+    }
+    double max_pixels = max_screens * 
+                        gtk_widget_get_allocated_width(ui.vellum) *
+                        gtk_widget_get_allocated_height(ui.vellum);
+    double pixels = width * height;
+    if(pixels <= max_pixels || max_pixels <= 0){
+        return 1.0;
+    }
+    return sqrt(max_pixels / pixels);
+}
+
+static void
+on_page_prefetched(cairo_surface_t *image,
+                   gpointer         data)
+{
+    /* main thread, only called for the latest prefetch_pages() */
+    const PageRenderJob *job = data;
+    if(!image){
+        return;
+    }
+    PrefetchedPage *prefetched = g_malloc(sizeof(PrefetchedPage));
+    prefetched->page_num = job->page_num;
+    prefetched->color = job->color;
+    prefetched->width = cairo_image_surface_get_width(image);
+    prefetched->height = cairo_image_surface_get_height(image);
+    prefetched->image = image;
+    prefetched_pages = g_list_prepend(prefetched_pages,
+                                      prefetched);
+}
+
+static void
+prefetch_pages(double image_width,
+               double image_height)
+{
+    /*
+       renders the pages either side of the current one at its zoom, the
+       next one first. whatever is still queued from before is cancelled.
+    */
+    const int page_nums[] = {d.cur_page_num + 1, d.cur_page_num - 1};
+    const enum RenderPriority priorities[] = {RenderPriorityNext, RenderPriorityPrefetch};
+    g_atomic_int_inc(&prefetch_generation);
+    if(memory_pressure_get_level() >= MemoryPressureMedium){
+        drop_prefetched_pages();
+        return;
+    }
+    GList *list_p = prefetched_pages;
+    while(list_p){
+        GList *next = list_p->next;
+        PrefetchedPage *prefetched = list_p->data;
+        if(prefetched->page_num != page_nums[0] &&
+           prefetched->page_num != page_nums[1])
+        {
+            prefetched_page_free(prefetched);
+            prefetched_pages = g_list_delete_link(prefetched_pages,
+                                                  list_p);
+        }
+        list_p = next;
+    }
+    for(int i = 0; i < G_N_ELEMENTS(page_nums); i++){
+        if(page_nums[i] < 0 || page_nums[i] >= d.num_pages){
+            continue;
+        }
+        PageMeta *meta = g_ptr_array_index(d.metae,
+                                           page_nums[i]);
+        double width, height;
+        if(d.zoom_level == PageFit){
+            height = image_height;
+            width = height / meta->aspect_ratio;
+        }
+        else{
+            width = image_width;
+            height = width * meta->aspect_ratio;
+        }
+        double render_scale = page_render_scale(width,
+                                                height);
+        width *= render_scale;
+        height *= render_scale;
+        gboolean is_prefetched = FALSE;
+        for(list_p = prefetched_pages; list_p; list_p = list_p->next){
+            PrefetchedPage *prefetched = list_p->data;
+            if(prefetched->page_num == page_nums[i]){
+                if(prefetched->width == (int)width && prefetched->height == (int)height){
+                    is_prefetched = TRUE;
+                }
+                else{
+                    /* the zoom changed */
+                    prefetched_page_free(prefetched);
+                    prefetched_pages = g_list_delete_link(prefetched_pages,
+                                                          list_p);
+                }
+                break;
+            }
+        }
+        if(is_prefetched){
+            continue;
+        }
+        PageRenderJob *job = g_malloc(sizeof(PageRenderJob));
+        job->page_num = page_nums[i];
+        job->page_width = meta->page_width;
+        job->page_height = meta->page_height;
+        job->width = width;
+        job->height = height;
+        job->color = meta->color;
+        job->is_preview = FALSE;
+        render_pool_submit(priorities[i],
+                           &prefetch_generation,
+                           render_reading_page_job,
+                           on_page_prefetched,
+                           job,
+                           g_free);
+    }
+}
+
+static void
+filter_page(void)
+{
+    /* filters work on a copy of the page, toggling them never re-renders */
+    cairo_surface_destroy(d.filtered_image);
+    d.filtered_image = NULL;
+    if(!d.image || !page_filter_is_needed(d.image,
+                                          ui.theme,
+                                          ui.is_contrast_boosted))
+    {
+        return;
+    }
+    cairo_surface_flush(d.image);
+    d.filtered_image = surface_pool_create(cairo_image_surface_get_format(d.image),
+                                           cairo_image_surface_get_width(d.image),
+                                           cairo_image_surface_get_height(d.image),
+                                           FALSE);
+    memcpy(cairo_image_surface_get_data(d.filtered_image),
+           cairo_image_surface_get_data(d.image),
+           (gsize)cairo_image_surface_get_stride(d.image) * cairo_image_surface_get_height(d.image));
+    cairo_surface_mark_dirty(d.filtered_image);
+    page_filter_apply(d.filtered_image,
+                      ui.theme,
+                      ui.is_contrast_boosted);
+}
+
+/*
+   the reading page is rendered asynchronously and only the latest navigation
+   counts. until its page arrives whatever is at hand stands in: a prefetched
+   render, the page strip's thumbnail or a coarse preview. the full render
+   waits for the input to settle, pages flipped through are never rendered
+   in full.
+*/
+#define PAGE_SETTLE_DELAY_MS 50
+#define PAGE_PREVIEW_SCALE 0.25
+
+static gint page_generation = 0;
+static guint settle_source_id = 0;
+/* submitted by settle_reading_page() */
+static PageRenderJob settle_job;
+static gint64 navigation_time = 0;
+static gboolean is_first_pixel_pending = FALSE;
+static guint64 num_navigations = 0;
+static guint64 num_page_previews = 0;
+static guint64 num_settled_pages = 0;
+static gint64 max_first_pixel_latency_us = 0;
+static gint64 settle_latency_us = 0;
+
+static void
+show_reading_image(cairo_surface_t *image,
+                   int              page_num,
+                   gboolean         is_settled)
+{
+    /* takes image, NULL leaves a blank page */
+    cairo_surface_destroy(d.image);
+    d.image = image;
+    d.image_page_num = page_num;
+    d.is_image_settled = is_settled;
+    gint64 latency = g_get_monotonic_time() - navigation_time;
+    if(image && is_first_pixel_pending){
+        max_first_pixel_latency_us = MAX(max_first_pixel_latency_us, latency);
+        is_first_pixel_pending = FALSE;
+    }
+    if(is_settled){
+        num_settled_pages++;
+        settle_latency_us += latency;
+    }
+    filter_page();
+    gtk_widget_queue_draw(ui.vellum);
+}
+
+static void
+on_reading_page_rendered(cairo_surface_t *image,
+                         gpointer         data)
+{
+    /* main thread, only called for the latest navigation */
+    const PageRenderJob *job = data;
+    if(!image){
+        return;
+    }
+    if(job->is_preview){
+        if(d.is_image_settled && d.image_page_num == job->page_num){
+            /* the full render won the race */
+            cairo_surface_destroy(image);
+            return;
+        }
+        num_page_previews++;
+        show_reading_image(image,
+                           job->page_num,
+                           FALSE);
+        return;
+    }
+    PageMeta *meta = g_ptr_array_index(d.metae,
+                                       job->page_num);
+    meta->color = job->color;
+    show_reading_image(image,
+                       job->page_num,
+                       TRUE);
+    prefetch_pages(d.image_width,
+                   d.image_height);
+}
+
+static gboolean
+settle_reading_page(gpointer data)
+{
+    settle_source_id = 0;
+    PageRenderJob *job = g_malloc(sizeof(PageRenderJob));
+    *job = settle_job;
+    render_pool_submit(RenderPriorityVisible,
+                       &page_generation,
+                       render_reading_page_job,
+                       on_reading_page_rendered,
+                       job,
+                       g_free);
+    return G_SOURCE_REMOVE;
+}
+
+static void
+cancel_reading_page(void)
+{
+    g_atomic_int_inc(&page_generation);
+    if(settle_source_id){
+        g_source_remove(settle_source_id);
+        settle_source_id = 0;
+    }
+}
+
+static void
+request_reading_page(PageMeta *meta,
+                     double    width,
+                     double    height)
+{
+    /* returns at once, the page shows up as its renders arrive */
+    cancel_reading_page();
+    num_navigations++;
+    navigation_time = g_get_monotonic_time();
+    if(d.image && d.is_image_settled && d.image_page_num == meta->page_num &&
+       cairo_image_surface_get_width(d.image) == (int)width &&
+       cairo_image_surface_get_height(d.image) == (int)height)
+    {
+        gtk_widget_queue_draw(ui.vellum);
+        return;
+    }
+    /* on a zoom the current image stands in, drawn scaled */
+    gboolean is_stand_in_needed = !d.image || d.image_page_num != meta->page_num;
+    is_first_pixel_pending = is_stand_in_needed;
+    PageRenderJob job = {meta->page_num,
+                         meta->page_width, meta->page_height,
+                         width, height,
+                         meta->color, FALSE};
+    enum PageColor color;
+    cairo_surface_t *image = take_prefetched_page(meta->page_num,
+                                                  width,
+                                                  height,
+                                                  &color);
+    if(image || !render_pool_is_open()){
+        if(!image){
+            /* no workers, render in place */
+            image = render_reading_page_job(d.doc,
+                                            &job);
+            color = job.color;
+        }
+        meta->color = color;
+        show_reading_image(image,
+                           meta->page_num,
+                           TRUE);
+        prefetch_pages(d.image_width,
+                       d.image_height);
+        return;
+    }
+    if(is_stand_in_needed){
+        cairo_surface_t *thumbnail = page_strip_lookup_thumbnail(meta->page_num);
+        show_reading_image(thumbnail ? cairo_surface_reference(thumbnail) : NULL,
+                           meta->page_num,
+                           FALSE);
+        PageRenderJob *preview = g_malloc(sizeof(PageRenderJob));
+        *preview = job;
+        preview->width = MAX(1, width * PAGE_PREVIEW_SCALE);
+        preview->height = MAX(1, height * PAGE_PREVIEW_SCALE);
+        preview->is_preview = TRUE;
+        render_pool_submit(RenderPriorityVisible,
+                           &page_generation,
+                           render_reading_page_job,
+                           on_reading_page_rendered,
+                           preview,
+                           g_free);
+    }
+    settle_job = job;
+    settle_source_id = g_timeout_add(PAGE_SETTLE_DELAY_MS,
+                                     settle_reading_page,
+                                     NULL);
+}
+
 static void
 scale_page (enum ZoomLevel zl,
             gboolean       in_out_disabled,            
@@ -135,14 +696,14 @@ scale_page (enum ZoomLevel zl,
         image_height = image_width * meta->aspect_ratio;
         break;
     case In:
-        image_width = cairo_image_surface_get_width(d.image);
+        image_width = d.image_width;
         if(!in_out_disabled){
             image_width *= 1.1;
         }
         image_height = image_width * meta->aspect_ratio;
         break;
     case Out:
-        image_width = cairo_image_surface_get_width(d.image);
+        image_width = d.image_width;
         if(!in_out_disabled){
             if(image_width / 1.1 > MIN_PAGE_WIDTH){
                 image_width /= 1.1;
@@ -171,12 +732,14 @@ scale_page (enum ZoomLevel zl,
         double hidden_height = image_height - widget_height;        
         d.image_origin_y = -MIN(fabs(progress_y * image_height), hidden_height);
     }
-    cairo_surface_destroy(d.image);
-    d.image = render_page(meta,
-                          image_width,
-                          image_height);    
+    d.image_width = image_width;
+    d.image_height = image_height;
     d.zoom_level = zl;
-    gtk_widget_queue_draw(ui.vellum);
+    double render_scale = page_render_scale(image_width,
+                                            image_height);
+    request_reading_page(meta,
+                         image_width * render_scale,
+                         image_height * render_scale);
 }
 
 static void
@@ -283,8 +846,8 @@ configure_callback (GtkWidget *widget,
 {   
     pose_page_widgets();
     if(ui.app_mode == ReadingMode){
-        double progress_x = fabs(d.image_origin_x) / cairo_image_surface_get_width(d.image);
-        double progress_y = fabs(d.image_origin_y) / cairo_image_surface_get_height(d.image);
+        double progress_x = fabs(d.image_origin_x) / d.image_width;
+        double progress_y = fabs(d.image_origin_y) / d.image_height;
         scale_page(d.zoom_level,
                    TRUE,
                    progress_x, progress_y);
@@ -292,6 +855,24 @@ configure_callback (GtkWidget *widget,
     return TRUE;
 }
 
+static double
+clamp_scroll(double delta,
+             double origin,
+             double hidden_portion)
+{
+    /*
+       the part of delta that keeps origin within [-hidden_portion, 0]. a
+       frame's worth of scroll steps(see on_frame_tick()) goes up to the edge
+       rather than stopping short of it.
+    */
+    double min_delta = -hidden_portion - origin,
+           max_delta = -origin;
+    if(hidden_portion <= 0 || min_delta > max_delta){
+        return 0;
+    }
+    return CLAMP(delta, min_delta, max_delta);
+}
+
 static void
 scroll_with_pixels(double dx,
                    double dy)
@@ -299,8 +880,8 @@ scroll_with_pixels(double dx,
     int widget_width = gtk_widget_get_allocated_width(ui.vellum);
     int widget_height = gtk_widget_get_allocated_height(ui.vellum);
     if(ui.app_mode == ReadingMode){
-        double image_width = cairo_image_surface_get_width(d.image);
-        double image_height = cairo_image_surface_get_height(d.image);
+        double image_width = d.image_width;
+        double image_height = d.image_height;
         double hidden_portion_width = image_width - widget_width;
         double hidden_portion_height = image_height - widget_height;
         double my_dx = dx,
@@ -312,35 +893,24 @@ scroll_with_pixels(double dx,
             case WidthFit:
                 /* vertical only */
                 my_dx = 0;
-                if(my_dy + d.image_origin_y > 0){
-                    my_dy = 0;
-                }
-                if(abs(my_dy + d.image_origin_y) > hidden_portion_height){
-                    my_dy = 0;
-                }
+                my_dy = clamp_scroll(my_dy,
+                                     d.image_origin_y,
+                                     hidden_portion_height);
                 break;
             default:
-                /* vertical */
-                if(my_dy + d.image_origin_y > 0){
-                    my_dy = 0;
-                }
-                if(abs(my_dy + d.image_origin_y) > hidden_portion_height){
-                    my_dy = 0;
-                }
-                /* horizontal */
-                if(my_dx + d.image_origin_x > 0){
-                    my_dx = 0;
-                }
-                if(abs(my_dx + d.image_origin_x) > hidden_portion_width){
-                    my_dx = 0;
-                }
+                my_dy = clamp_scroll(my_dy,
+                                     d.image_origin_y,
+                                     hidden_portion_height);
+                my_dx = clamp_scroll(my_dx,
+                                     d.image_origin_x,
+                                     hidden_portion_width);
                 break;
         }
         if(my_dx != 0.0 || my_dy != 0.0){
             d.image_origin_x += my_dx;
             d.image_origin_y += my_dy;
-            d.preserved_progress_x = (d.image_origin_x) / cairo_image_surface_get_width(d.image);
-            d.preserved_progress_y = (d.image_origin_y) / cairo_image_surface_get_height(d.image);
+            d.preserved_progress_x = (d.image_origin_x) / d.image_width;
+            d.preserved_progress_y = (d.image_origin_y) / d.image_height;
             gtk_widget_queue_draw(ui.vellum);
         }
         else{
@@ -353,6 +923,13 @@ scroll_with_pixels(double dx,
             }
         }
     }
+    else if(ui.app_mode == GalleryMode){
+        /* rows are tall, move faster than a page does */
+        figure_gallery_scroll(-dy * 4);
+    }
+    else if(ui.app_mode == PagesMode){
+        page_strip_scroll(-dy * 4);
+    }
     else if(ui.app_mode == TOCMode){
         if(d.toc.origin_x - dx >= 0){
             d.toc.origin_x -= dx;
@@ -366,28 +943,13 @@ scroll_with_pixels(double dx,
     }
 }
 
-static void
-load_text_layouts(PageMeta    *meta,
-                  PopplerPage *page)
+static Arena *
+page_arena(PageMeta *meta)
 {
-    meta->num_layouts = 0;
-    meta->physical_text_layouts = NULL;
-    PopplerRectangle *phys_layouts = NULL;
-    poppler_page_get_text_layout(page,
-                                 &phys_layouts,
-                                 &meta->num_layouts);
-    meta->mean_line_height = 0.0;
-    if(meta->num_layouts > 0){
-        meta->physical_text_layouts = g_ptr_array_sized_new(meta->num_layouts);
-        for(int r = 0; r < meta->num_layouts; r++){
-            Rect *phys_layout = rect_from_poppler_rectangle(&phys_layouts[r]);
-            meta->mean_line_height += phys_layout->y2 - phys_layout->y1;
-            g_ptr_array_add(meta->physical_text_layouts,
-                            phys_layout);
-        }
-        meta->mean_line_height /= meta->num_layouts;
-        g_free(phys_layouts);
+    if(!meta->arena){
+        meta->arena = arena_new(4096);
     }
+    return meta->arena;
 }
 
 static void
@@ -396,7 +958,6 @@ load_links()
     for(int page_num = 0; page_num < d.num_pages; page_num++){
         PageMeta *meta = g_ptr_array_index(d.metae,
                                            page_num);
-        meta->links = NULL;
         PopplerPage *page = poppler_document_get_page(d.doc,
                                                       page_num);
         GList *link_mappings = poppler_page_get_link_mapping(page);
@@ -404,8 +965,9 @@ load_links()
         GList *link_p = link_mappings;
         while(link_p){
             PopplerLinkMapping *link_mapping = link_p->data;
-            Link *link = g_malloc(sizeof(Link));
-            link->physical_layout = rect_new();
+            Arena *arena = page_arena(meta);
+            Link *link = arena_new0(arena, Link, 1);
+            link->physical_layout = arena_new0(arena, Rect, 1);
             link->physical_layout->x1 = link_mapping->area.x1;            
             link->physical_layout->y1 = meta->page_height - link_mapping->area.y2;
             link->physical_layout->x2 = link_mapping->area.x2;
@@ -427,12 +989,14 @@ load_links()
                                                               target.page_num);
                     if(target.page_num >= 0 && target.page_num < d.num_pages){
                         if(meta_target->page_label->label){
-                            link->tip = g_strdup_printf("Page '%s'",
-                                                        meta_target->page_label->label);
+                            link->tip = arena_adopt_string(arena,
+                                                           g_strdup_printf("Page '%s'",
+                                                                           meta_target->page_label->label));
                         }
                         else{
-                            link->tip = g_strdup_printf("Page(index): '%d'",
-                                                        target.page_num);
+                            link->tip = arena_adopt_string(arena,
+                                                           g_strdup_printf("Page(index): '%d'",
+                                                                           target.page_num));
                         }
                     }
                     break;
@@ -441,22 +1005,24 @@ load_links()
                 {
                     PopplerActionGotoRemote *remote_action = (PopplerActionGotoRemote*)
                         link_mapping->action;
-                    link->tip = g_markup_printf_escaped("Open '%s'",
-                                                       remote_action->file_name);
+                    link->tip = arena_adopt_string(arena,
+                                                   g_markup_printf_escaped("Open '%s'",
+                                                                           remote_action->file_name));
                     break;
                 }
                 case POPPLER_ACTION_URI:
                 {
                     PopplerActionUri *uri_action = (PopplerActionUri*)
                         link_mapping->action;
-                    link->tip = g_markup_printf_escaped("URI '%s'",
-                                                       uri_action->uri);
+                    link->tip = arena_adopt_string(arena,
+                                                   g_markup_printf_escaped("URI '%s'",
+                                                                           uri_action->uri));
                     break;
                 }
                 default:;
             }
-            meta->links = g_list_append(meta->links,
-                                        link);
+            g_ptr_array_add(meta->links,
+                            link);
             link_p = link_p->next;
         }
         poppler_page_free_link_mapping(link_mappings);
@@ -466,14 +1032,54 @@ load_links()
 static void
 load_units(void)
 {
+    /* reads every page's text, see page_store.h */
+    g_return_if_fail(page_store_is_eviction_suspended());
     for(int page_num = 0; page_num < d.num_pages; page_num++){ 
         PageMeta *meta = g_ptr_array_index(d.metae,
                                            page_num);
+        GList *converted_units = NULL;
         convert_units(meta->text,
-                      &meta->converted_units);
-        GList *list_p = meta->converted_units;
+                      &converted_units);
+        RectIndex *unit_index = rect_index_new();
+        GList *list_p = converted_units;
         while(list_p){
             ConvertedUnit *cv = list_p->data; 
+            /*
+               the scanner knows where each occurrence is, occurrences
+               overlapping an earlier unit's are dropped.
+            */
+            if(cv->match_offsets->len > 0 && meta->num_layouts > 0){
+                for(guint i = 0; i + 1 < cv->match_offsets->len; i += 2){
+                    int start = g_array_index(cv->match_offsets, int, i);
+                    int end = g_array_index(cv->match_offsets, int, i + 1);
+                    if(rect_index_intersects_range(unit_index,
+                                                   start,
+                                                   end))
+                    {
+                        continue;
+                    }
+                    FindResult *fr = find_result_from_text_range(meta,
+                                                                 start,
+                                                                 end);
+                    if(fr){
+                        cv->find_results = g_list_append(cv->find_results,
+                                                         fr);
+                        rect_index_add_range(unit_index,
+                                             start,
+                                             end);
+                    }
+                }
+                if(cv->find_results){
+                    g_ptr_array_add(meta->converted_units,
+                                    cv);
+                }
+                else{
+                    converted_unit_free(cv);
+                }
+                list_p = list_p->next;
+                continue;
+            }
+            /* no offsets to go by, search for it and compare rects */
             GList *find_results = find_text(d.doc,
                                             d.metae,
                                             cv->whole_match,
@@ -481,47 +1087,18 @@ load_units(void)
                                             1,
                                             FALSE,
                                             FALSE);
+            /* results overlapping an earlier unit's are dropped */
             GList *cur_result_p = find_results;
             while(cur_result_p){
-                gboolean intersects = FALSE;
                 FindResult *fr_cur = cur_result_p->data;
-                GList *rect_cur_p = fr_cur->physical_layouts;
-                while(rect_cur_p){
-                    Rect *rect_cur = rect_cur_p->data;
-                    GList *cv_prev_p = list_p->prev;
-                    while(cv_prev_p){
-                        ConvertedUnit *cv_prev = cv_prev_p->data;
-                        GList *prev_result_p = cv_prev->find_results;
-                        while(prev_result_p){
-                            FindResult *fr_prev = prev_result_p->data;
-                            GList *rect_prev_p = fr_prev->physical_layouts;
-                            while(rect_prev_p){
-                                Rect *rect_prev = rect_prev_p->data;
-                                if(rects_have_intersection(rect_prev,
-                                                           rect_cur))
-                                {
-                                    intersects = TRUE;
-                                    break;
-                                }
-                                rect_prev_p = rect_prev_p->next;
-                            }
-                            if(intersects){
-                                break;
-                            }
-                            prev_result_p = prev_result_p->next;
-                        }
-                        if(intersects){
-                            break;
-                        }
-                        cv_prev_p = cv_prev_p->prev;
-                    }
-                    if(intersects){
-                        break;
-                    }
-                    rect_cur_p = rect_cur_p->next;
+                gboolean is_overlapping = FALSE;
+                for(int r = 0; r < fr_cur->physical_layouts->len && !is_overlapping; r++){
+                    is_overlapping = rect_index_intersects(unit_index,
+                                                           g_ptr_array_index(fr_cur->physical_layouts,
+                                                                             r));
                 }
                 GList *next = cur_result_p->next;
-                if(!intersects){                      
+                if(!is_overlapping){
                     cv->find_results = g_list_append(cv->find_results,
                                                      fr_cur);
                     find_results = g_list_remove_link(find_results,
@@ -530,22 +1107,62 @@ load_units(void)
                 }
                 cur_result_p = next;
             }
+            /* a unit's own results don't shadow each other */
+            GList *result_p = cv->find_results;
+            while(result_p){
+                FindResult *fr = result_p->data;
+                for(int r = 0; r < fr->physical_layouts->len; r++){
+                    rect_index_add(unit_index,
+                                   g_ptr_array_index(fr->physical_layouts,
+                                                     r));
+                }
+                result_p = result_p->next;
+            }
             cur_result_p = find_results;
             while(cur_result_p){
                 find_result_free(cur_result_p->data);
                 cur_result_p = cur_result_p->next;
             }
             g_list_free(find_results);
-            GList *next = list_p->next;
-            if(!cv->find_results){
-                meta->converted_units = g_list_remove_link(meta->converted_units,
-                                                           list_p);
-                g_list_free(list_p);
+            if(cv->find_results){
+                g_ptr_array_add(meta->converted_units,
+                                cv);
+            }
+            else{
                 converted_unit_free(cv);
-            }            
-            list_p = next;
+            }
+            list_p = list_p->next;
         }
+        g_list_free(converted_units);
+        rect_index_free(unit_index);
+    }
+}
+
+static void
+install_toc(void);
+
+static void
+setup_text_completions(void);
+
+static void
+dump_stats(void);
+
+static void
+on_typography_toc(TOCItem *head_item)
+{
+    page_store_resume_eviction();
+    /* headings were detected after the document was shown */
+    if(!head_item || d.toc.head_item){
+        toc_destroy(head_item);
+        return;
     }
+    g_print("TOC synthesized from heading typography.\n");
+    d.toc.head_item = head_item;
+    install_toc();
+    TeleportIndex *old_index = d.teleport_index;
+    setup_text_completions();
+    teleport_index_free(old_index);
+    gtk_widget_queue_draw(ui.vellum);
 }
 
 static void 
@@ -562,10 +1179,21 @@ load_toc(void)
                                        d.page_label_num_hash,
                                        &d.toc.head_item);
     }
-    /* 3: scan all pages and create TOC */
+    /* 3: scan all pages and create TOC, in the background */
     if(!d.toc.head_item){
-    }
+        g_print("Document provides no contents' pages, detecting headings in the background.\n");
+        /* the detector reads every page */
+        page_store_suspend_eviction();
+        toc_typography_start(d.filename,
+                             d.metae,
+                             on_typography_toc);
+    }
+    install_toc();
+}
 
+static void
+install_toc(void)
+{
     if(d.toc.head_item){
         char *title = poppler_document_get_title(d.doc);
         d.toc.head_item->title = 
@@ -652,11 +1280,11 @@ merge_images(GList *image_mappings,
                 space_between_rects.y2 = img_center_y < o_img_center_y ? o_img->area.y1 : img->area.y1;
                 gboolean text_exists_between_rects = FALSE;
                 for(int li = 0; li < meta->num_layouts; li++){
-                    Rect *physical_layout = g_ptr_array_index(meta->physical_text_layouts,
-                                                              li);
                     if(rect_contains_point(&space_between_rects,
-                                           rect_center_x(physical_layout),
-                                           rect_center_y(physical_layout)))
+                                           text_layout_center_x(meta->text_layout,
+                                                                li),
+                                           text_layout_center_y(meta->text_layout,
+                                                                li)))
                     {
                         text_exists_between_rects = TRUE;
                         break;
@@ -676,26 +1304,54 @@ merge_images(GList *image_mappings,
     }
 }
 
+typedef struct
+{
+    int page_num;
+    int image_id;
+}EmbeddedImageJob;
+
 static cairo_surface_t *
-create_image_for_figure(PageMeta *meta,
+get_embedded_image(PopplerDocument *document,
+                   gpointer         data)
+{
+    /* worker thread */
+    const EmbeddedImageJob *job = data;
+    PopplerPage *page = poppler_document_get_page(document,
+                                                  job->page_num);
+    cairo_surface_t *image = poppler_page_get_image(page,
+                                                    job->image_id);
+    g_object_unref(page);
+    return image;
+}
+
+static cairo_surface_t *
+load_embedded_image(PageMeta *meta,
+                    int       image_id)
+{
+    EmbeddedImageJob job = {meta->page_num, image_id};
+    return render_now(get_embedded_image,
+                      &job);
+}
+
+static cairo_surface_t *
+render_image_for_figure(PageMeta *meta,
                         Figure   *figure)
 {
     /*
-      create the image that figure represents.
       render the target page to a suitable resolution and then crop the image
       out of it.
     */
     const double MIN_PAGE_WIDTH_PX = 640;
-    PopplerPage *page = poppler_document_get_page(d.doc,
-                                                  meta->page_num);
-    cairo_surface_t *first_image_surface = poppler_page_get_image(page,
-                                                                  figure->image_id);
-    g_object_unref(page);
-    double page_render_width = cairo_image_surface_get_width(first_image_surface) * 
-        (meta->page_width / rect_width(figure->image_physical_layout));
+    cairo_surface_t *first_image_surface = load_embedded_image(meta,
+                                                               figure->image_id);
+    double page_render_width = MIN_PAGE_WIDTH_PX;
+    if(first_image_surface){
+        page_render_width = cairo_image_surface_get_width(first_image_surface) * 
+            (meta->page_width / rect_width(figure->image_physical_layout));
+        cairo_surface_destroy(first_image_surface);
+    }
     page_render_width = MAX(MIN_PAGE_WIDTH_PX, page_render_width);
     double page_render_height = meta->aspect_ratio * page_render_width;
-    cairo_surface_destroy(first_image_surface);
     cairo_surface_t *rendered_page = render_page(meta,
                                                  page_render_width,
                                                  page_render_height);    
@@ -705,9 +1361,10 @@ create_image_for_figure(PageMeta *meta,
                                                    0, 0);    
     double image_width = rect_width(&image_layout);
     double image_height = rect_height(&image_layout);
-    cairo_surface_t *image = cairo_image_surface_create(CAIRO_FORMAT_ARGB32,
-                                                        image_width,
-                                                        image_height);
+    cairo_surface_t *image = surface_pool_create(CAIRO_FORMAT_ARGB32,
+                                                 image_width,
+                                                 image_height,
+                                                 TRUE);
     cairo_t *cr = cairo_create(image);
     double source_x = page_render_width * (figure->image_physical_layout->x1 / meta->page_width);
     double source_y = page_render_height * (figure->image_physical_layout->y1 / meta->page_height);
@@ -724,15 +1381,154 @@ create_image_for_figure(PageMeta *meta,
     return image;
 }
 
+static cairo_surface_t *
+extract_image_for_figure(PageMeta *meta,
+                         Figure   *figure)
+{
+    /*
+      take the embedded raster as is, only huge images get scaled down.
+      returns NULL if poppler can't hand the image over.
+    */
+    const double MAX_FIGURE_WIDTH_PX = 2048;
+    cairo_surface_t *embedded_image = load_embedded_image(meta,
+                                                          figure->image_id);
+    if(!embedded_image){
+        return NULL;
+    }
+    double width = cairo_image_surface_get_width(embedded_image),
+           height = cairo_image_surface_get_height(embedded_image);
+    if(width <= 0 || height <= 0){
+        cairo_surface_destroy(embedded_image);
+        return NULL;
+    }
+    if(width <= MAX_FIGURE_WIDTH_PX){
+        return embedded_image;
+    }
+    double scale = MAX_FIGURE_WIDTH_PX / width;
+    cairo_surface_t *image = surface_pool_create(CAIRO_FORMAT_ARGB32,
+                                                 width * scale,
+                                                 height * scale,
+                                                 TRUE);
+    cairo_t *cr = cairo_create(image);
+    cairo_scale(cr,
+                scale,
+                scale);
+    cairo_set_source_surface(cr,
+                             embedded_image,
+                             0, 0);
+    cairo_pattern_set_filter(cairo_get_source(cr),
+                             CAIRO_FILTER_FAST);
+    cairo_paint(cr);
+    cairo_destroy(cr);
+    cairo_surface_destroy(embedded_image);
+    return image;
+}
+
+static cairo_surface_t *
+create_image_for_figure(PageMeta *meta,
+                        Figure   *figure)
+{
+    /*
+      the image that figure represents, owned by d.figure_images.
+      raster figures come straight from the document, merged ones(see
+      merge_images()) and vector ones need the page rendered.
+    */
+    if(!d.figure_images){
+        d.figure_images = g_hash_table_new_full(g_direct_hash,
+                                                g_direct_equal,
+                                                NULL,
+                                                (GDestroyNotify)cairo_surface_destroy);
+    }
+    cairo_surface_t *image = g_hash_table_lookup(d.figure_images,
+                                                 figure);
+    if(image){
+        return image;
+    }
+    if(!figure->is_image_merged){
+        image = extract_image_for_figure(meta,
+                                         figure);
+    }
+    if(!image){
+        image = render_image_for_figure(meta,
+                                        figure);
+    }
+    g_hash_table_insert(d.figure_images,
+                        figure,
+                        image);
+    return image;
+}
+
+static void
+scan_page_captions(gpointer data,
+                   gpointer user_data)
+{
+    PageMeta *meta = data;
+    GList **captions_per_page = user_data;
+    /* each page owns its slot, no locking needed */
+    captions_per_page[meta->page_num] = extract_figure_captions(meta->text);
+}
+
+static GList **
+scan_figure_captions(void)
+{
+    /* caption candidates of every page, found from the text alone */
+    GList **captions_per_page = g_new0(GList *, d.num_pages);
+    GError *err = NULL;
+    GThreadPool *pool = g_thread_pool_new(scan_page_captions,
+                                          captions_per_page,
+                                          g_get_num_processors(),
+                                          TRUE,
+                                          &err);
+    if(!pool){
+        g_print("caption scan pool error.\ndomain: %d, \ncode: %d, \nmessage: %s\n",
+                err->domain, err->code, err->message);
+        g_error_free(err);
+        for(int page_num = 0; page_num < d.num_pages; page_num++){
+            scan_page_captions(g_ptr_array_index(d.metae,
+                                                 page_num),
+                               captions_per_page);
+        }
+        return captions_per_page;
+    }
+    for(int page_num = 0; page_num < d.num_pages; page_num++){
+        g_thread_pool_push(pool,
+                           g_ptr_array_index(d.metae,
+                                             page_num),
+                           NULL);
+    }
+    g_thread_pool_free(pool,
+                       FALSE,
+                       TRUE);
+    return captions_per_page;
+}
+
+static void
+free_caption_rects(gpointer key,
+                   gpointer value,
+                   gpointer user_data)
+{
+    g_list_free_full(value,
+                     (GDestroyNotify)rect_free);
+}
+
 static void
 load_figures(void)
 {        
+    /* reads every page's text and layouts, see page_store.h */
+    g_return_if_fail(page_store_is_eviction_suspended());
     gboolean labels_are_exclusive = FALSE,
              ids_are_complex = FALSE;
     GList *all_figures = NULL;
+    /* 1: only pages whose text has captions are worth their images */
+    GList **captions_per_page = scan_figure_captions();
     for(int page_num = 0; page_num < d.num_pages; page_num++){
         PageMeta *meta = g_ptr_array_index(d.metae,
                                            page_num);
+        GList *fig_list = captions_per_page[page_num];
+        if(!fig_list){
+            continue;
+        }
+        /* 2: images of the remaining pages */
         PopplerPage *page = poppler_document_get_page(d.doc,
                                                       page_num);
         GList *image_mappings = poppler_page_get_image_mapping(page);
@@ -753,14 +1549,25 @@ load_figures(void)
             image_mappings_p = next;
         }
         if(!image_mappings){
+            g_list_free_full(fig_list,
+                             (GDestroyNotify)figure_free);
             g_object_unref(page);
             continue;
         }
-        GList *fig_list = extract_figure_captions(meta->text);
-        if(!fig_list){
-            poppler_page_free_image_mapping(image_mappings);
-            g_object_unref(page);
-            continue;
+        /* images grown by merging can't be taken from the document as is */
+        GHashTable *original_areas = g_hash_table_new_full(g_direct_hash,
+                                                           g_direct_equal,
+                                                           NULL,
+                                                           g_free);
+        image_mappings_p = image_mappings;
+        while(image_mappings_p){
+            PopplerImageMapping *img = image_mappings_p->data;
+            PopplerRectangle *original_area = g_new(PopplerRectangle, 1);
+            *original_area = img->area;
+            g_hash_table_insert(original_areas,
+                                GINT_TO_POINTER(img->image_id),
+                                original_area);
+            image_mappings_p = image_mappings_p->next;
         }
         /* merge images that have non-null inresections */
         if(image_mappings->next){
@@ -797,6 +1604,31 @@ load_figures(void)
         }
         meta->figures = g_hash_table_new(g_str_hash,
                                          g_str_equal);
+        /* 3: locate every caption once, not once per image */
+        GHashTable *caption_rects = g_hash_table_new(g_direct_hash,
+                                                     g_direct_equal);
+        GList *fig_list_p = fig_list;
+        while(fig_list_p){
+            Figure *figure = fig_list_p->data;
+            GList *rects = NULL;
+            GList *results = poppler_page_find_text(page,
+                                                    figure->whole_match);
+            GList *results_p = results;
+            while(results_p){
+                PopplerRectangle *caption_rect = results_p->data;
+                caption_rect->y1 = meta->page_height - caption_rect->y1;
+                caption_rect->y2 = meta->page_height - caption_rect->y2;
+                rects = g_list_append(rects,
+                                      rect_from_poppler_rectangle(caption_rect));
+                poppler_rectangle_free(caption_rect);
+                results_p = results_p->next;
+            }
+            g_list_free(results);
+            g_hash_table_insert(caption_rects,
+                                figure,
+                                rects);
+            fig_list_p = fig_list_p->next;
+        }
         image_mappings_p = image_mappings;      
         while(image_mappings_p){
             PopplerImageMapping *img = image_mappings_p->data;
@@ -823,36 +1655,41 @@ load_figures(void)
                 new_figure->page_num = page_num;
                 new_figure->image_id = img->image_id;
                 new_figure->image_physical_layout = rect_from_poppler_rectangle(&img->area); 
-                GList *results = poppler_page_find_text(page,
-                                                        new_figure->whole_match);
-                GList *results_p = results;            
-                while(results_p){
-                    PopplerRectangle *caption_rect = results_p->data;
-                    caption_rect->y1 = meta->page_height - caption_rect->y1;
-                    caption_rect->y2 = meta->page_height - caption_rect->y2;
+                new_figure->is_image_merged = memcmp(&img->area,
+                                                     g_hash_table_lookup(original_areas,
+                                                                         GINT_TO_POINTER(img->image_id)),
+                                                     sizeof(PopplerRectangle)) != 0;
+                GList *rects_p = g_hash_table_lookup(caption_rects,
+                                                     figure);
+                while(rects_p){
+                    Rect *caption_rect = rects_p->data;
                     double cap_rect_center_x = caption_rect->x1 + (caption_rect->x2 - caption_rect->x1),
                            cap_rect_center_y = caption_rect->y1 + (caption_rect->y2 - caption_rect->y1);
                     Caption *caption = g_malloc(sizeof(Caption));                    
-                    caption->physical_layout = rect_from_poppler_rectangle(caption_rect);
+                    caption->physical_layout = rect_copy(caption_rect);
                     caption->distance_to_image = sqrt(pow(cap_rect_center_x - img_center_x, 2) + 
                                                       pow(cap_rect_center_y - img_center_y, 2));
                     new_figure->captions = g_list_append(new_figure->captions,
                                                          caption);
-                    results_p = results_p->next;
-                    poppler_rectangle_free(caption_rect);
+                    rects_p = rects_p->next;
                 }
-                g_list_free(results);
                 all_figures = g_list_append(all_figures,
                                             new_figure);
                 fig_list_p = fig_list_p->next;
             }                      
             image_mappings_p = image_mappings_p->next;        
         }        
+        g_hash_table_foreach(caption_rects,
+                             free_caption_rects,
+                             NULL);
+        g_hash_table_unref(caption_rects);
+        g_hash_table_unref(original_areas);
         g_list_free_full(fig_list,
                          (GDestroyNotify)figure_free);
         poppler_page_free_image_mapping(image_mappings);
         g_object_unref(page);
     }
+    g_free(captions_per_page);
     GList *figure_p = NULL;
     if(labels_are_exclusive){  
         figure_p = all_figures;
@@ -963,9 +1800,74 @@ load_figures(void)
     g_hash_table_unref(processed_figures_hash_table);
 }
 
+static void
+index_figures(void)
+{
+    d.figure_index = figure_index_new();
+    for(int page_num = 0; page_num < d.num_pages; page_num++){
+        PageMeta *meta = g_ptr_array_index(d.metae,
+                                           page_num);
+        if(!meta->figures){
+            continue;
+        }
+        GHashTableIter iter;
+        gpointer key, value;
+        g_hash_table_iter_init(&iter, meta->figures);
+        while(g_hash_table_iter_next(&iter, &key, &value)){
+            figure_index_add(d.figure_index,
+                             value);
+        }
+    }
+}
+
+static int
+compare_figures(const void *a,
+                const void *b)
+{
+    /* reading order: page, then top to bottom */
+    const Figure *figure_a = *(Figure * const *)a;
+    const Figure *figure_b = *(Figure * const *)b;
+    if(figure_a->page_num != figure_b->page_num){
+        return figure_a->page_num - figure_b->page_num;
+    }
+    if(figure_a->image_physical_layout->y1 < figure_b->image_physical_layout->y1){
+        return -1;
+    }
+    if(figure_a->image_physical_layout->y1 > figure_b->image_physical_layout->y1){
+        return +1;
+    }
+    return 0;
+}
+
+static void
+load_figure_gallery(void)
+{
+    GPtrArray *figures = g_ptr_array_new();
+    for(int page_num = 0; page_num < d.num_pages; page_num++){
+        PageMeta *meta = g_ptr_array_index(d.metae,
+                                           page_num);
+        if(!meta->figures){
+            continue;
+        }
+        GHashTableIter iter;
+        gpointer key, value;
+        g_hash_table_iter_init(&iter, meta->figures);
+        while(g_hash_table_iter_next(&iter, &key, &value)){
+            g_ptr_array_add(figures,
+                            value);
+        }
+    }
+    g_ptr_array_sort(figures,
+                     compare_figures);
+    figure_gallery_load(d.filename,
+                        figures);
+}
+
 static void
 resolve_referenced_figures(void)
 {
+    /* reads every page's text, see page_store.h */
+    g_return_if_fail(page_store_is_eviction_suspended());
     for(int page_num = 0; page_num < d.num_pages; page_num++){
         PageMeta *meta = g_ptr_array_index(d.metae,
                                            page_num);
@@ -973,49 +1875,27 @@ resolve_referenced_figures(void)
         GList *list_p = ref_figures;
         while(list_p){
             ReferencedFigure *ref_figure = list_p->data;
-            if(meta->figures && g_hash_table_contains(meta->figures,
-                                                      ref_figure->id))
-            {
-                g_free(ref_figure->label);
-                g_free(ref_figure->id);
-                g_free(ref_figure);
+            Figure *reference = figure_index_lookup(d.figure_index,
+                                                    ref_figure->label,
+                                                    ref_figure->id);
+            /* a caption is no reference to its own figure */
+            if(!reference || reference->page_num == page_num){
+                referenced_figure_free(ref_figure);
                 list_p = list_p->next;
                 continue;
-            }                    
-            for(int ref_page_num = 0; ref_page_num < d.num_pages; ref_page_num++){
-                if(ref_page_num == page_num){
-                    continue;
-                }
-                PageMeta *ref_meta = g_ptr_array_index(d.metae,
-                                                       ref_page_num);
-                if(!ref_meta->figures){
-                    continue;
-                }
-                Figure *reference = g_hash_table_lookup(ref_meta->figures,
-                                                        ref_figure->id);
-                if(reference){
-                    char *needle = g_strdup_printf("%s %s",
-                                                   ref_figure->label,
-                                                   ref_figure->id);
-                    ref_figure->find_results = find_text(d.doc,
-                                                         d.metae,
-                                                         needle,
-                                                         page_num,
-                                                         1,
-                                                         FALSE,
-                                                         FALSE);
-                    g_free(needle);
-                    ref_figure->reference = reference;                    
-                    meta->referenced_figures = g_list_append(meta->referenced_figures,
-                                                             ref_figure);
-                    break;
+            }
+            for(guint i = 0; i + 1 < ref_figure->match_offsets->len; i += 2){
+                FindResult *fr = find_result_from_text_range(meta,
+                                                             g_array_index(ref_figure->match_offsets, int, i),
+                                                             g_array_index(ref_figure->match_offsets, int, i + 1));
+                if(fr){
+                    ref_figure->find_results = g_list_append(ref_figure->find_results,
+                                                             fr);
                 }
             }
-            if(!ref_figure->reference){
-                g_free(ref_figure->label);
-                g_free(ref_figure->id);
-                g_free(ref_figure);
-            }            
+            ref_figure->reference = reference;
+            g_ptr_array_add(meta->referenced_figures,
+                            ref_figure);
             list_p = list_p->next;
         }
         g_list_free(ref_figures);
@@ -1025,9 +1905,12 @@ resolve_referenced_figures(void)
 static void
 load_metae(void)
 {
+    d.arena = arena_new(64 * 1024);
     d.metae = g_ptr_array_sized_new(d.num_pages);
+    page_store_init(d.doc,
+                    d.metae);
     for(int page_num = 0; page_num < d.num_pages; page_num++){
-        PageMeta *meta = g_malloc(sizeof(PageMeta));
+        PageMeta *meta = arena_new0(d.arena, PageMeta, 1);
         meta->page_num = page_num;
         PopplerPage *page = poppler_document_get_page(d.doc,
                                                       page_num); 
@@ -1035,21 +1918,44 @@ load_metae(void)
                               &meta->page_width,
                               &meta->page_height);
         meta->aspect_ratio = meta->page_height / meta->page_width;
-        meta->text = poppler_page_get_text(page);        
-        load_text_layouts(meta,
-                          page);
+        page_store_load(meta,
+                        page);
         g_object_unref(page);
-        meta->links = NULL;
-        meta->converted_units = NULL;
+        meta->links = g_ptr_array_new();
+        meta->converted_units = g_ptr_array_new_with_free_func((GDestroyNotify)converted_unit_free);
         meta->figures = NULL;
-        meta->referenced_figures = NULL;
+        meta->referenced_figures = g_ptr_array_new_with_free_func((GDestroyNotify)referenced_figure_free);
         meta->active_referenced_figure = NULL;
-        meta->find_results = NULL;
+        /* borrowed from d.find_details */
+        meta->find_results = g_ptr_array_new();
         g_ptr_array_add(d.metae,
                         meta);
     }
 }
 
+static void
+index_page_labels(void)
+{
+    /* 
+       actual labels go first so that roman/decimal aliases never shadow
+       them, e.g. '14' stays with page 14 even if page 'xiv' exists.
+    */
+    for(int page_num = 0; page_num < d.num_pages; page_num++){
+        PageMeta *meta = g_ptr_array_index(d.metae,
+                                           page_num);
+        page_label_index_insert(d.page_label_num_hash,
+                                meta->page_label->label,
+                                page_num);
+    }
+    for(int page_num = 0; page_num < d.num_pages; page_num++){
+        PageMeta *meta = g_ptr_array_index(d.metae,
+                                           page_num);
+        page_label_index_insert_aliases(d.page_label_num_hash,
+                                        meta->page_label->label,
+                                        page_num);
+    }
+}
+
 static void
 fix_page_labels(void)
 {
@@ -1069,10 +1975,10 @@ fix_page_labels(void)
         "# roman range: 1-99\n"
         "^((XC|XL|L?X{0,3})(IX|IV|V?I{0,3})|\\d+)\\b|\n"
         "\\b((XC|XL|L?X{0,3})(IX|IV|V?I{0,3})|\\d+)$";
-    page_label_regex = g_regex_new(pattern,
-                                   G_REGEX_CASELESS | G_REGEX_EXTENDED | G_REGEX_MULTILINE | G_REGEX_NO_AUTO_CAPTURE,
-                                   G_REGEX_MATCH_NOTEMPTY,
-                                   &err);
+    page_label_regex = regex_registry_lookup(pattern,
+                                             G_REGEX_CASELESS | G_REGEX_EXTENDED | G_REGEX_MULTILINE | G_REGEX_NO_AUTO_CAPTURE,
+                                             G_REGEX_MATCH_NOTEMPTY,
+                                             &err);
     if(!page_label_regex){
         g_print("page_label_regex error.\ndomain: %d, \ncode: %d, \nmessage: %s\n",
                 err->domain, err->code, err->message);
@@ -1085,7 +1991,7 @@ fix_page_labels(void)
                                            page_num);
         PopplerPage *page = poppler_document_get_page(d.doc,
                                                       page_num);
-        meta->page_label = g_malloc(sizeof(PageLabel));
+        meta->page_label = arena_new0(d.arena, PageLabel, 1);
         meta->page_label->label = NULL;
         meta->page_label->physical_layout = NULL;
 
@@ -1176,10 +2082,8 @@ fix_page_labels(void)
             g_free(meta->page_label->label);
             meta->page_label->label = g_strdup_printf("%d",
                                                       page_num + 1);
-            g_hash_table_insert(d.page_label_num_hash,
-                                meta->page_label->label,
-                                GINT_TO_POINTER(page_num));
         }
+        index_page_labels();
         g_print("Majority of the pages provide no labels, using page index instead.\n");
         return;
     }
@@ -1256,17 +2160,7 @@ fix_page_labels(void)
         meta->page_label->label = g_strdup_printf("%d",
                                                   page_num - actual_diff);
     }
-    for(int page_num = 0; page_num < d.num_pages; page_num++){
-        PageMeta *meta = g_ptr_array_index(d.metae,
-                                           page_num);
-        if(!meta->page_label->label){
-            continue;
-        }
-        g_hash_table_insert(d.page_label_num_hash,
-                            meta->page_label->label,
-                            GINT_TO_POINTER(page_num));
-    }
-
+    index_page_labels();
 }
 
 static void
@@ -1278,6 +2172,11 @@ zero_document(void)
     d.doc_info.book_info_data = NULL;
     d.metae = NULL;
     d.image = NULL;
+    d.image_page_num = -1;
+    d.is_image_settled = FALSE;
+    d.filtered_image = NULL;
+    d.image_width = 0.0;
+    d.image_height = 0.0;
     d.image_origin_x = 0.0;
     d.image_origin_y = 0.0;
     d.preserved_progress_x = 0.0;
@@ -1291,10 +2190,14 @@ zero_document(void)
     d.toc.where = NULL;
     d.toc.origin_x = 0;
     d.toc.origin_y = 0;
-    d.find_details.selected_p = NULL;
+    d.find_details.selected_index = -1;
     d.find_details.find_results = NULL;
     d.find_details.max_results = 0;
     d.find_details.max_results_page_num = -1;
+    d.teleport_index = NULL;
+    d.figure_index = NULL;
+    d.figure_images = NULL;
+    d.arena = NULL;
     ui.is_link_hovered = FALSE;
     ui.is_find_result_hovered = FALSE;
     ui.is_unit_hovered = FALSE;
@@ -1313,55 +2216,60 @@ zero_document(void)
 static void
 setup_text_completions(void)
 {
-    GList *text_list = NULL;
+    /*
+       every teleport target goes into a single ranked index, the teleport
+       widget and teleport() both query it.
+    */
+    TeleportIndex *index = teleport_index_new();
     /* page num/label */
     for(int page_num = 0; page_num < d.num_pages; page_num++){
         PageMeta *meta = g_ptr_array_index(d.metae,
                                            page_num);
-        text_list = g_list_append(text_list,
-                                  g_strdup(meta->page_label->label));
+        teleport_index_add(index,
+                           meta->page_label->label,
+                           "Page",
+                           GINT_TO_POINTER(page_num));
     }
-    teleport_widget_update_text_completions(text_list,
-                                            "Page");
-    g_list_free_full(text_list,
-                     (GDestroyNotify)g_free);
-    text_list = NULL;
     /* navigation commands */
-    text_list = g_list_append(text_list,
-                              g_strdup("next page")); 
-    text_list = g_list_append(text_list,
-                              g_strdup("previous page"));
+    teleport_index_add(index,
+                       "next page",
+                       "Navigation",
+                       NULL);
+    teleport_index_add(index,
+                       "previous page",
+                       "Navigation",
+                       NULL);
     GList *list_p = d.toc.labels;
     while(list_p){
         char *toc_label = list_p->data;
-        text_list = g_list_append(text_list,
-                                  g_strdup_printf("next %s",
-                                                  toc_label));
-        text_list = g_list_append(text_list,
-                                  g_strdup_printf("previous %s",
-                                                  toc_label));
+        char *text = g_strdup_printf("next %s",
+                                     toc_label);
+        teleport_index_add(index,
+                           text,
+                           "Navigation",
+                           NULL);
+        g_free(text);
+        text = g_strdup_printf("previous %s",
+                               toc_label);
+        teleport_index_add(index,
+                           text,
+                           "Navigation",
+                           NULL);
+        g_free(text);
         list_p = list_p->next;
     }
-    teleport_widget_update_text_completions(text_list,
-                                            "Navigation");
-    g_list_free_full(text_list,
-                     (GDestroyNotify)g_free);
-    text_list = NULL;
     /* toc items */
     list_p = d.toc.flattened_items;
     while(list_p){
         TOCItem *toc_item = list_p->data;
-        if(toc_item->depth > 0){            
-            text_list = g_list_append(text_list,
-                                      g_strdup(toc_item->title));
+        if(toc_item->depth > 0){
+            teleport_index_add(index,
+                               toc_item->title,
+                               "TOC",
+                               toc_item);
         }
         list_p = list_p->next;
     }
-    teleport_widget_update_text_completions(text_list,
-                                            "TOC");
-    g_list_free_full(text_list,
-                     (GDestroyNotify)g_free);
-    text_list = NULL;
     /* figures */
     for(int page_num = 0; page_num < d.num_pages; page_num++){
         PageMeta *meta = g_ptr_array_index(d.metae,
@@ -1369,23 +2277,23 @@ setup_text_completions(void)
         if(!meta->figures){
             continue;
         }
-        GList *figure_list = g_hash_table_get_values(meta->figures);
-        list_p = figure_list;
-        while(list_p){
-            Figure *figure = list_p->data;
+        GHashTableIter iter;
+        gpointer key, value;
+        g_hash_table_iter_init(&iter, meta->figures);
+        while(g_hash_table_iter_next(&iter, &key, &value)){
+            Figure *figure = value;
             char *text = g_strdup_printf("%s %s",
                                          figure->label ? figure->label : "Figure",
                                          figure->id);
-            text_list = g_list_append(text_list,
-                                      text);
-            list_p = list_p->next;
+            teleport_index_add(index,
+                               text,
+                               "Figure",
+                               figure);
+            g_free(text);
         }
-        g_list_free(figure_list);
     }
-    teleport_widget_update_text_completions(text_list,
-                                            "Figure");
-    g_list_free_full(text_list,
-                     (GDestroyNotify)g_free);
+    d.teleport_index = index;
+    teleport_widget_set_completion_index(d.teleport_index);
 }
 
 static void
@@ -1395,34 +2303,32 @@ destroy_document(void)
         return;
     }
     /*save_state();*/
+    figure_gallery_unload();
+    page_strip_unload();
+    cancel_reading_page();
+    drop_prefetched_pages();
+    drop_toc_thumbnail();
+    render_pool_close();
+    toc_typography_cancel();
+    page_store_destroy();
+    /*
+       only page metas, page labels and links live in arenas. find results,
+       units, figures, captions and referenced figures are freed one by one
+       while loading and searching, so they are still walked here.
+    */
     for(int page_num = 0; page_num < d.num_pages; page_num++){
         PageMeta *meta = g_ptr_array_index(d.metae,
                                            page_num);
         /* text layouts */
-        if(meta->num_layouts > 0){
-            for(int li = 0; li < meta->num_layouts; li++){
-                rect_free(g_ptr_array_index(meta->physical_text_layouts,
-                                            li));
-            }
-            g_ptr_array_unref(meta->physical_text_layouts);
-        }
+        text_layout_free(meta->text_layout);
         /* text */
         g_free(meta->text);
-        /* links */
-        GList *list_p = meta->links;
-        while(list_p){
-            Link *link = list_p->data;
-            rect_free(link->physical_layout);
-            g_free(link->tip);
-            g_free(link);
-            list_p = list_p->next;
-        }
-        g_list_free(meta->links);
+        /* links live in the page arena */
+        g_ptr_array_unref(meta->links);
         /* find resutlts */
-        g_list_free(meta->find_results);
+        g_ptr_array_unref(meta->find_results);
         /* units */
-        g_list_free_full(meta->converted_units,
-                         (GDestroyNotify)converted_unit_free);
+        g_ptr_array_unref(meta->converted_units);
         /* figures */
         if(meta->figures){
             GHashTableIter iter;
@@ -1435,28 +2341,21 @@ destroy_document(void)
             g_hash_table_unref(meta->figures);
         }
         /* referenced figures */
-        list_p = meta->referenced_figures;
-        while(list_p){
-            ReferencedFigure *ref_figure = list_p->data;
-            g_free(ref_figure->id);
-            g_free(ref_figure->label);
-            g_list_free_full(ref_figure->find_results,
-                             (GDestroyNotify)find_result_free);
-            g_free(ref_figure);
-            list_p = list_p->next;
-        }
-        g_list_free(meta->referenced_figures);
+        g_ptr_array_unref(meta->referenced_figures);
         if(meta->page_label){
             g_free(meta->page_label->label);        
             rect_free(meta->page_label->physical_layout);
         }
-        g_free(meta->page_label);
-        g_free(meta);
+        arena_free(meta->arena);
     }
     g_ptr_array_unref(d.metae);
+    /* page metas and page label records */
+    arena_free(d.arena);
     cairo_surface_destroy(d.image);
-    g_list_free_full(d.find_details.find_results,
-                     (GDestroyNotify)find_result_free);
+    cairo_surface_destroy(d.filtered_image);
+    if(d.find_details.find_results){
+        g_ptr_array_unref(d.find_details.find_results);
+    }
     toc_destroy(d.toc.head_item);
     g_list_free_full(d.toc.labels,
                      (GDestroyNotify)g_free);    
@@ -1476,6 +2375,13 @@ destroy_document(void)
     g_free(d.doc_info.book_info_data);
     g_object_unref(d.doc);
     teleport_widget_destroy_text_completions();
+    teleport_index_free(d.teleport_index);
+    if(d.figure_index){
+        g_hash_table_unref(d.figure_index);
+    }
+    if(d.figure_images){
+        g_hash_table_unref(d.figure_images);
+    }
     zero_document();
     gtk_widget_queue_draw(ui.vellum);
 }
@@ -1506,9 +2412,8 @@ import_pdf(void)
     gtk_widget_destroy(dialog);
 
     if(d.filename
-       && g_regex_match_simple(d.filename,
-                               fn,
-                               0, 0)){
+       && g_strcmp0(d.filename,
+                    fn) == 0){
         g_free(fn);
         return;
     }   
@@ -1530,6 +2435,9 @@ import_pdf(void)
         return;
     }
     d.filename = fn;
+    if(!render_pool_open(d.filename)){
+        g_print("Rendering on the main thread.\n");
+    }
     d.num_pages = poppler_document_get_n_pages(d.doc);
     char *num_pages_str = g_strdup_printf("%d",
                                       d.num_pages);
@@ -1568,8 +2476,15 @@ import_pdf(void)
     load_units();
     g_print("Loading figures...\n");
     load_figures();
+    index_figures();
     resolve_referenced_figures();
+    load_figure_gallery();
+    page_strip_load(d.filename,
+                    d.metae);
     setup_text_completions();
+    /* analysis is over, cold pages may give up their text */
+    page_store_resume_eviction();
+    dump_stats();
     g_print("Document is ready.\n");    
     ui.app_mode = ReadingMode;
     goto_page(0,
@@ -1581,8 +2496,8 @@ go_back_save(void)
 {
     GoBack *go_back = g_malloc(sizeof(GoBack));
     go_back->page_num = d.cur_page_num;
-    go_back->progress_x = fabs(d.image_origin_x) / cairo_image_surface_get_width(d.image);
-    go_back->progress_y = fabs(d.image_origin_y) / cairo_image_surface_get_height(d.image);
+    go_back->progress_x = fabs(d.image_origin_x) / d.image_width;
+    go_back->progress_y = fabs(d.image_origin_y) / d.image_height;
     g_queue_push_head(d.go_back_stack,
                       go_back);  
 }
@@ -1953,7 +2868,7 @@ teleport(const char *term)
     }
     /* object is a navigation request: next/prev page, part, chapter, etc... */
     GError *err = NULL;
-    GRegex *navigation_regex = g_regex_new(
+    GRegex *navigation_regex = regex_registry_lookup(
         "^(?<command>next|prev(ious)?)\\b\\s*(?<label>page|part|ch(apter)?|(sub)?sec(tion)?)$",
         G_REGEX_CASELESS | G_REGEX_NO_AUTO_CAPTURE,
         0,
@@ -1961,6 +2876,9 @@ teleport(const char *term)
     if(!navigation_regex){
         g_print("navigation regex error.\ndomain:  %d, \ncode: %d, \nmessage: %s\n",
                 err->domain, err->code, err->message);
+        g_error_free(err);
+        g_free(object_name);
+        return;
     }
     GMatchInfo *match_info = NULL;
     g_regex_match(navigation_regex,
@@ -1972,9 +2890,9 @@ teleport(const char *term)
         go_back_save();
         char *command = g_match_info_fetch_named(match_info,
                                                  "command");
-        gboolean go_next = g_regex_match_simple("next",
-                                                command,
-                                                0, 0);
+        gboolean go_next = regex_registry_match_simple("next",
+                                                       command,
+                                                       0, 0);
         g_free(command);
         char *label = g_match_info_fetch_named(match_info,
                                                "label");
@@ -2024,54 +2942,49 @@ teleport(const char *term)
         }
     }
     g_match_info_free(match_info);
+    g_regex_unref(navigation_regex);
     if(navigation_matches){
         teleport_widget_hide();
         return;
     }
     /* object is toc_item, e.g. chapter 1.2 */
-    if(d.toc.head_item){
-        const TOCItem *target_item = toc_search_by_title(d.toc.head_item,
-                                                         object_name);
-        if(target_item){
-            goto_toc_item_page(target_item);
-            g_free(object_name);
-            teleport_widget_hide();
-            return;
-        }
-    }    
+    const TeleportTarget *toc_target = teleport_index_lookup_exact(d.teleport_index,
+                                                                   object_name,
+                                                                   "TOC");
+    if(toc_target){
+        goto_toc_item_page(toc_target->data);
+        g_free(object_name);
+        teleport_widget_hide();
+        return;
+    }
     /* object is figure */
     GList *ref_figure_list = extract_figure_references(object_name);
     if(ref_figure_list){
         ReferencedFigure *ref_figure = ref_figure_list->data;
-        int page_num;
-        for(page_num = 0; page_num < d.num_pages; page_num++){
-            PageMeta *meta = g_ptr_array_index(d.metae,
-                                               page_num);
-            if(!meta || !meta->figures){
-                continue;
-            }
-            Figure *target_figure = g_hash_table_lookup(meta->figures,
-                                                        ref_figure->id);
-            if(target_figure && are_figure_labels_equal(ref_figure->label,
-                                                        target_figure->label))
-            {
-                go_back_save();
-                goto_figure_page(target_figure);
-                teleport_widget_hide();
-                break;
-            }
+        Figure *target_figure = figure_index_lookup(d.figure_index,
+                                                    ref_figure->label,
+                                                    ref_figure->id);
+        if(target_figure){
+            go_back_save();
+            goto_figure_page(target_figure);
+            teleport_widget_hide();
         }
-        GList *list_p = ref_figure_list;
-        while(list_p){
-            ReferencedFigure *ref_figure_del = list_p->data;
-            g_free(ref_figure_del->id);
-            g_free(ref_figure_del->label);
-            g_free(ref_figure_del);
-            list_p = list_p->next;
+        g_list_free_full(ref_figure_list,
+                         (GDestroyNotify)referenced_figure_free);
+        if(target_figure){
+            g_free(object_name);
+            return;
         }
-        g_list_free(ref_figure_list);
-        g_free(object_name);
     }
+    /* object is a partial toc title, e.g. 'ch 12 homol' */
+    toc_target = teleport_index_lookup_best(d.teleport_index,
+                                            object_name,
+                                            "TOC");
+    if(toc_target){
+        goto_toc_item_page(toc_target->data);
+        teleport_widget_hide();
+    }
+    g_free(object_name);
 }
 
 static void
@@ -2081,20 +2994,44 @@ on_teleport_request_received(GtkWidget *sender,
     teleport(user_data);
 }
 
+static gboolean
+find_result_contains_point(const PageMeta *meta,
+                           FindResult     *fr,
+                           double          image_width,
+                           double          image_height,
+                           double          x,
+                           double          y)
+{
+    /* x and y are in widget space */
+    for(int r = 0; r < fr->physical_layouts->len; r++){
+        Rect img_rect = map_physical_rect_to_image(g_ptr_array_index(fr->physical_layouts,
+                                                                     r),
+                                                   meta->page_width,
+                                                   meta->page_height,
+                                                   image_width,
+                                                   image_height,
+                                                   d.image_origin_x,
+                                                   d.image_origin_y);
+        if(rect_contains_point(&img_rect,
+                               x, y))
+        {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
 static void
 find_next(void)
 {    
-    if(!d.find_details.find_results){
+    if(!d.find_details.find_results || d.find_details.find_results->len == 0){
         return;
     }
-    if(d.find_details.selected_p){
-        d.find_details.selected_p = d.find_details.selected_p->next;
-    }
-    if(!d.find_details.selected_p){
-        d.find_details.selected_p = g_list_first(d.find_details.find_results);
-    }
-    FindResult *find_result = d.find_details.selected_p->data;            
-    Rect *first_rect = find_result->physical_layouts->data;
+    d.find_details.selected_index = (d.find_details.selected_index + 1) % d.find_details.find_results->len;
+    FindResult *find_result = g_ptr_array_index(d.find_details.find_results,
+                                                d.find_details.selected_index);
+    Rect *first_rect = g_ptr_array_index(find_result->physical_layouts,
+                                         0);
     PageMeta *meta = g_ptr_array_index(d.metae,
                                        find_result->page_num); 
     double progress_x = first_rect->x1 / meta->page_width;
@@ -2115,17 +3052,15 @@ find_next(void)
 static void
 find_previous(void)
 {    
-    if(!d.find_details.find_results){
+    if(!d.find_details.find_results || d.find_details.find_results->len == 0){
         return;
     }
-    if(d.find_details.selected_p){
-        d.find_details.selected_p = d.find_details.selected_p->prev;
-    }
-    if(!d.find_details.selected_p){
-        d.find_details.selected_p = g_list_last(d.find_details.find_results);
-    }
-    FindResult *find_result = d.find_details.selected_p->data;            
-    Rect *first_rect = find_result->physical_layouts->data;
+    d.find_details.selected_index = d.find_details.selected_index <= 0 ? d.find_details.find_results->len - 1
+                                                                        : d.find_details.selected_index - 1;
+    FindResult *find_result = g_ptr_array_index(d.find_details.find_results,
+                                                d.find_details.selected_index);
+    Rect *first_rect = g_ptr_array_index(find_result->physical_layouts,
+                                         0);
     PageMeta *meta = g_ptr_array_index(d.metae,
                                        find_result->page_num); 
     double progress_x = first_rect->x1 / meta->page_width;
@@ -2150,16 +3085,13 @@ destroy_find_results(void)
     for(int page_num = 0; page_num < d.num_pages; page_num++){
         PageMeta *meta = g_ptr_array_index(d.metae,
                                            page_num);
-        g_list_free(meta->find_results);
-        meta->find_results = NULL;  
+        g_ptr_array_set_size(meta->find_results,
+                             0);
     }
-    GList *result_p = d.find_details.find_results;
-    while(result_p){
-        find_result_free(result_p->data);
-        result_p = result_p->next;
+    if(d.find_details.find_results){
+        g_ptr_array_unref(d.find_details.find_results);
     }
-    g_list_free(d.find_details.find_results);
-    d.find_details.selected_p = NULL;
+    d.find_details.selected_index = -1;
     d.find_details.find_results = NULL;
     d.find_details.max_results = 0;
     d.find_details.max_results_page_num = -1;
@@ -2179,23 +3111,36 @@ on_find_request_received(GtkWidget *sender,
     FindRequestData *find_request = user_data;
     destroy_find_results();
     gtk_widget_queue_draw(ui.vellum);     
-    d.find_details.find_results = find_text(d.doc,
-                                            d.metae,
-                                            find_request->text,
-                                            0, d.num_pages,
-                                            find_request->is_dualpage_checked,
-                                            find_request->is_whole_words_checked);
-    int num_results = g_list_length(d.find_details.find_results);
-    if(num_results > 0){
-        d.find_details.find_results = g_list_sort(d.find_details.find_results,
-                                                  compare_find_results);
-        int i = 0;
-        GList *result_p = d.find_details.find_results;
-        while(result_p){
-            FindResult *fr = result_p->data;
+    GList *find_results = find_text(d.doc,
+                                    d.metae,
+                                    find_request->text,
+                                    0, d.num_pages,
+                                    find_request->is_dualpage_checked,
+                                    find_request->is_whole_words_checked);
+    find_results = g_list_sort(find_results,
+                               compare_find_results);
+    int num_results = g_list_length(find_results);
+    d.find_details.find_results = g_ptr_array_new_full(num_results,
+                                                       (GDestroyNotify)find_result_free);
+    GList *result_p = find_results;
+    while(result_p){
+        g_ptr_array_add(d.find_details.find_results,
+                        result_p->data);
+        result_p = result_p->next;
+    }
+    g_list_free(find_results);
+    if(num_results == 0){
+        g_ptr_array_unref(d.find_details.find_results);
+        d.find_details.find_results = NULL;
+    }
+    else{
+        for(int i = 0; i < num_results; i++){
+            FindResult *fr = g_ptr_array_index(d.find_details.find_results,
+                                               i);
             PageMeta *meta = g_ptr_array_index(d.metae,
                                                fr->page_num);
-            Rect *first_rect = fr->physical_layouts->data;
+            Rect *first_rect = g_ptr_array_index(fr->physical_layouts,
+                                                 0);
             if(fr->page_postfix){
                 fr->certainty = first_rect->y1 / meta->page_height;
             }
@@ -2209,18 +3154,13 @@ on_find_request_received(GtkWidget *sender,
                                       "  <span font='sans 8'>next(F3), previous(Shift+F3), clear(Ctrl+F3)</span>",
                                       i + 1, num_results,
                                       fr->certainty < 0.75 ? "low" : "high");
-            meta->find_results = g_list_append(meta->find_results,
-                                               fr);  
-            result_p = result_p->next;
-            i++;
+            g_ptr_array_add(meta->find_results,
+                            fr);
         }
-        for(i = 0; i < d.num_pages; i++){
+        for(int i = 0; i < d.num_pages; i++){
             PageMeta *meta = g_ptr_array_index(d.metae,
                                                i);
-            if(!meta->find_results){
-                continue;
-            }
-            int num_results = g_list_length(meta->find_results);
+            int num_results = meta->find_results->len;
             if(num_results > d.find_details.max_results){
                 d.find_details.max_results = num_results;
                 d.find_details.max_results_page_num = i;
@@ -2445,8 +3385,8 @@ draw_reading_mode(cairo_t *cr)
 {
     int widget_width = gtk_widget_get_allocated_width(ui.vellum);
     int widget_height = gtk_widget_get_allocated_height(ui.vellum);
-    double image_width = cairo_image_surface_get_width(d.image);
-    double image_height = cairo_image_surface_get_height(d.image);
+    double image_width = d.image_width;
+    double image_height = d.image_height;
     PageMeta *meta = g_ptr_array_index(d.metae,
                                        d.cur_page_num);
     /* page */
@@ -2454,20 +3394,39 @@ draw_reading_mode(cairo_t *cr)
                          1.0);
     int centered_origin_y = d.image_origin_y;
     centered_origin_y += image_height < widget_height ? (widget_height - image_height) / 2 : 0;
+    cairo_save(cr);
     cairo_rectangle(cr,
                     d.image_origin_x,
                     d.image_origin_y,
                     image_width,
                     image_height);
-    cairo_set_source_surface(cr,
-                             d.image,
-                             d.image_origin_x,
-                             d.image_origin_y);
-    cairo_fill(cr);
+    cairo_clip(cr);
+    cairo_translate(cr,
+                    d.image_origin_x,
+                    d.image_origin_y);
+    if(d.image){
+        cairo_scale(cr,
+                    image_width / cairo_image_surface_get_width(d.image),
+                    image_height / cairo_image_surface_get_height(d.image));
+        page_surface_paint(cr,
+                           d.filtered_image ? d.filtered_image : d.image,
+                           ui.theme);
+    }
+    else{
+        /* the page is on its way, see request_reading_page() */
+        double paper[3], ink[3];
+        page_filter_theme_colors(ui.theme,
+                                 paper,
+                                 ink);
+        cairo_set_source_rgb(cr,
+                             paper[0], paper[1], paper[2]);
+        cairo_paint(cr);
+    }
+    cairo_restore(cr);
     /* links */ 
-    GList *list_p = meta->links;   
-    while(list_p){
-        Link *link = list_p->data;
+    for(int i = 0; i < meta->links->len; i++){
+        Link *link = g_ptr_array_index(meta->links,
+                                       i);
         Rect img_rect = map_physical_rect_to_image(link->physical_layout,
                                                    meta->page_width,
                                                    meta->page_height,
@@ -2481,18 +3440,17 @@ draw_reading_mode(cairo_t *cr)
         cairo_set_source_rgba(cr,
                               blue_r, blue_g, blue_b, link->is_hovered ? 0.4 : 0.1);
         cairo_fill(cr);
-        list_p = list_p->next;
     }
     /* converted units */
-    list_p = meta->converted_units;
-    while(list_p){
-        ConvertedUnit *cv = list_p->data;
+    for(int i = 0; i < meta->converted_units->len; i++){
+        ConvertedUnit *cv = g_ptr_array_index(meta->converted_units,
+                                              i);
         GList *result_p = cv->find_results;
         while(result_p){
             FindResult *fr = result_p->data;
-            GList *rect_p = fr->physical_layouts;
-            while(rect_p){
-                Rect rect = map_physical_rect_to_image(rect_p->data,
+            for(int r = 0; r < fr->physical_layouts->len; r++){
+                Rect rect = map_physical_rect_to_image(g_ptr_array_index(fr->physical_layouts,
+                                                                         r),
                                                        meta->page_width,
                                                        meta->page_height,
                                                        image_width,
@@ -2502,25 +3460,23 @@ draw_reading_mode(cairo_t *cr)
                 cairo_rectangle(cr,
                                 rect.x1, rect.y1,
                                 rect_width(&rect), rect_height(&rect));
-                rect_p = rect_p->next;
             }
             result_p = result_p->next;
         }
-        list_p = list_p->next;
     }
     cairo_set_source_rgba(cr,
                          gotham_green_r, gotham_green_g, gotham_green_b, 0.2);
     cairo_fill(cr);
     /* referenced figures */
-    list_p = meta->referenced_figures;
-    while(list_p){
-        ReferencedFigure *ref_figure = list_p->data;
+    for(int i = 0; i < meta->referenced_figures->len; i++){
+        ReferencedFigure *ref_figure = g_ptr_array_index(meta->referenced_figures,
+                                                         i);
         GList *result_p = ref_figure->find_results;
         while(result_p){
             FindResult *find_result = result_p->data;
-            GList *rect_p = find_result->physical_layouts;
-            while(rect_p){
-                Rect rect = map_physical_rect_to_image(rect_p->data,
+            for(int r = 0; r < find_result->physical_layouts->len; r++){
+                Rect rect = map_physical_rect_to_image(g_ptr_array_index(find_result->physical_layouts,
+                                                                         r),
                                                        meta->page_width,
                                                        meta->page_height,
                                                        image_width,
@@ -2530,22 +3486,23 @@ draw_reading_mode(cairo_t *cr)
                 cairo_rectangle(cr,
                                 rect.x1, rect.y1,
                                 rect_width(&rect), rect_height(&rect));
-                rect_p = rect_p->next;
             }
             result_p = result_p->next;
         }
-        list_p = list_p->next;
     }
     cairo_set_source_rgba(cr,
                           1, 0, 1, 0.3);
     cairo_fill(cr);
     /* find results */
-    GList *result_p = meta->find_results;
-    while(result_p){
-        FindResult *find_result =  result_p->data;
-        GList *rect_p = find_result->physical_layouts;
-        while(rect_p){
-            Rect rect = map_physical_rect_to_image(rect_p->data,
+    FindResult *selected_result = d.find_details.selected_index >= 0 ? g_ptr_array_index(d.find_details.find_results,
+                                                                                         d.find_details.selected_index)
+                                                                     : NULL;
+    for(int i = 0; i < meta->find_results->len; i++){
+        FindResult *find_result = g_ptr_array_index(meta->find_results,
+                                                    i);
+        for(int r = 0; r < find_result->physical_layouts->len; r++){
+            Rect rect = map_physical_rect_to_image(g_ptr_array_index(find_result->physical_layouts,
+                                                                     r),
                                                    meta->page_width,
                                                    meta->page_height,
                                                    image_width,
@@ -2555,9 +3512,8 @@ draw_reading_mode(cairo_t *cr)
             cairo_rectangle(cr,
                             rect.x1, rect.y1,
                             rect_width(&rect), rect_height(&rect));
-            rect_p = rect_p->next;
         }        
-        if(d.find_details.selected_p && d.find_details.selected_p->data == find_result){
+        if(find_result == selected_result){
             cairo_set_source_rgba(cr,
                               giants_orange_r, giants_orange_g, giants_orange_b, 0.3);
         }
@@ -2566,7 +3522,6 @@ draw_reading_mode(cairo_t *cr)
                               giants_orange_r, giants_orange_g, giants_orange_b, 0.2);
         }
         cairo_fill(cr);
-        result_p = result_p->next;
     }
     /* active referenced figure */
     if(meta->active_referenced_figure){    
@@ -2584,6 +3539,8 @@ draw_reading_mode(cairo_t *cr)
         const double frame_padding = MIN(2, widget_width * 0.05);
         gboolean scale_figure = ref_image_width > ref_widget_width ||
                                 ref_image_height > ref_widget_height;
+        double ref_source_width = ref_image_width,
+               ref_source_height = ref_image_height;
         if(scale_figure){
             double scaled_width, scaled_height;
             double sx = ref_widget_width< ref_image_width ? ref_widget_width / ref_image_width : 1;
@@ -2596,27 +3553,14 @@ draw_reading_mode(cairo_t *cr)
                 scaled_width = ref_image_width * sx;
                 scaled_height = scaled_width * ref_ar;
             }
-            cairo_surface_t *surface_scaled = 
-                cairo_image_surface_create(CAIRO_FORMAT_ARGB32,                                             
-                                           scaled_width,
-                                           scaled_height);
-            cairo_t *cr_scaled = cairo_create(surface_scaled);
-            cairo_scale(cr_scaled,
-                        scaled_width / ref_image_width,
-                        scaled_height / ref_image_height);
-            cairo_set_source_surface(cr_scaled,
-                                     ref_surface,
-                                     0, 0);
-            cairo_paint(cr_scaled);   
-            cairo_destroy(cr_scaled);
-            cairo_surface_destroy(ref_surface);
-            ref_surface = surface_scaled;
-            ref_image_width = cairo_image_surface_get_width(ref_surface);
-            ref_image_height = cairo_image_surface_get_height(ref_surface);
+            /* scaled while painting, not into a copy on every draw */
+            ref_image_width = (int)scaled_width;
+            ref_image_height = (int)scaled_height;
         }
         /* pose referenced figure */
-        GList *find_results = meta->active_referenced_figure->activated_find_result->data;
-        Rect caption_rect = map_physical_rect_to_image(g_list_first(find_results)->data,
+        FindResult *activated_result = meta->active_referenced_figure->activated_find_result->data;
+        Rect caption_rect = map_physical_rect_to_image(g_ptr_array_index(activated_result->physical_layouts,
+                                                                         0),
                                                        meta->page_width, meta->page_height,
                                                        image_width, image_height,
                                                        d.image_origin_x, d.image_origin_y);
@@ -2638,14 +3582,21 @@ draw_reading_mode(cairo_t *cr)
         cairo_set_source_rgb(cr,
                              0.5, 0.5, 0.5);
         cairo_stroke(cr);
+        cairo_save(cr);
         cairo_rectangle(cr,
                         frame_x1 + frame_padding, frame_y1 + frame_padding,
                         ref_image_width, ref_image_height); 
+        cairo_clip(cr);
+        cairo_translate(cr,
+                        frame_x1 + frame_padding, frame_y1 + frame_padding);
+        cairo_scale(cr,
+                    ref_image_width / ref_source_width,
+                    ref_image_height / ref_source_height);
         cairo_set_source_surface(cr,
                                  ref_surface,
-                                 frame_x1 + frame_padding, frame_y1 + frame_padding);
-        cairo_fill(cr);  
-        cairo_surface_destroy(ref_surface);
+                                 0, 0);
+        cairo_paint(cr);
+        cairo_restore(cr);
     }
     /* panel */
     if(!ui.is_panel_hovered || meta->active_referenced_figure){
@@ -3004,14 +3955,14 @@ draw_reading_mode(cairo_t *cr)
         for(int i = 0; i < d.num_pages; i++){
             PageMeta *meta = g_ptr_array_index(d.metae,
                                                i);
-            if(!meta->find_results){
+            if(meta->find_results->len == 0){
                 continue;
             }
             cairo_rectangle(cr,
                             reading_progress_data_rect.x1 + i * page_bar_width,
                             reading_progress_data_rect.y2,
                             page_bar_width,
-                            -(double)g_list_length(meta->find_results) / d.find_details.max_results *
+                            -(double)meta->find_results->len / d.find_details.max_results *
                             data_box_height);            
         }
         cairo_set_source_rgba(cr,
@@ -3242,37 +4193,56 @@ draw_toc_mode(cairo_t *cr)
     if(d.toc.hovered_item){
         PageMeta *meta = g_ptr_array_index(d.metae,
                                            d.toc.hovered_item->page_num < 0 ? 0 : d.toc.hovered_item->page_num);        
-        double thumbnail_width = widget_width / 4.236; 
-        double thumbnail_height = thumbnail_width * (meta->aspect_ratio);
-        cairo_surface_t *page_thumbnail = render_page(meta,
-                                                      thumbnail_width, thumbnail_height);
+        int thumbnail_width = widget_width / 4.236; 
+        int thumbnail_height = thumbnail_width * (meta->aspect_ratio);
         double progress_y_start = (meta->page_height - d.toc.hovered_item->offset_y) / meta->page_height;
         if(progress_y_start >= 0.999){
             progress_y_start = 0;
         }
-        cairo_t *cr_progress = cairo_create(page_thumbnail);
-        cairo_rectangle(cr_progress,
-                        0, 0,
-                        thumbnail_width,
-                        thumbnail_height * progress_y_start);
-        cairo_set_source_rgba(cr_progress,
-                              dim_gray_r, dim_gray_r, dim_gray_r, 0.8);
-        cairo_fill(cr_progress);
-        cairo_destroy(cr_progress);
         double thumbnail_x = rect_center_x(d.toc.hovered_item->rect) - thumbnail_width / 2;
         thumbnail_x = thumbnail_x < 0 ? d.toc.hovered_item->rect->x1 : thumbnail_x;
         double padding_y = 4;
         double thumbnail_y = (d.toc.hovered_item->rect->y1 - padding_y > thumbnail_height)
                              ? d.toc.hovered_item->rect->y1 - padding_y - thumbnail_height
                              : d.toc.hovered_item->rect->y2 + padding_y; 
+        cairo_surface_t *page_thumbnail = lookup_toc_thumbnail(meta,
+                                                               thumbnail_width,
+                                                               thumbnail_height);
+        /* until it's rendered, the page strip's one if there is one */
+        cairo_surface_t *stand_in = page_thumbnail ? NULL
+                                                   : page_strip_lookup_thumbnail(meta->page_num);
+        cairo_save(cr);
         cairo_rectangle(cr,
                         thumbnail_x, thumbnail_y,
                         thumbnail_width, thumbnail_height);
-        cairo_set_source_surface(cr,
-                                 page_thumbnail,
-                                 thumbnail_x, thumbnail_y);
+        if(page_thumbnail){
+            cairo_set_source_surface(cr,
+                                     page_thumbnail,
+                                     thumbnail_x, thumbnail_y);
+        }
+        else if(stand_in){
+            cairo_translate(cr,
+                            thumbnail_x, thumbnail_y);
+            cairo_scale(cr,
+                        thumbnail_width / (double)cairo_image_surface_get_width(stand_in),
+                        thumbnail_height / (double)cairo_image_surface_get_height(stand_in));
+            cairo_set_source_surface(cr,
+                                     stand_in,
+                                     0, 0);
+        }
+        else{
+            cairo_set_source_rgb(cr,
+                                 silver_r, silver_r, silver_r);
+        }
+        cairo_fill(cr);
+        cairo_restore(cr);
+        cairo_rectangle(cr,
+                        thumbnail_x, thumbnail_y,
+                        thumbnail_width,
+                        thumbnail_height * progress_y_start);
+        cairo_set_source_rgba(cr,
+                              dim_gray_r, dim_gray_r, dim_gray_r, 0.8);
         cairo_fill(cr);
-        cairo_surface_destroy(page_thumbnail);        
     }
     if(d.toc.hovered_navigation_button){
     }
@@ -3312,6 +4282,9 @@ draw_help_mode(cairo_t *cr)
             "\t<span font='sans 10' foreground='#222'><i>Page fit</i>:</span><span font='sans 10' foreground='blue'> F</span>\n"
             "\t<span font='sans 10' foreground='#222'><i>Fit to width</i>:</span><span font='sans 10' foreground='blue'> W</span>\n"
             "\t<span font='sans 10' foreground='#222'><i>Zoom in/out</i>:</span><span font='sans 10' foreground='blue'> +/-</span>\n"
+        "\n<span font='sans 10' foreground='#444'>Theme</span>\n"
+            "\t<span font='sans 10' foreground='#222'><i>Day/night/sepia</i>:</span><span font='sans 10' foreground='blue'> Ctrl + D</span>\n"
+            "\t<span font='sans 10' foreground='#222'><i>Contrast boost</i>:</span><span font='sans 10' foreground='blue'> Ctrl + B</span>\n"
         "\n<span font='sans 10' foreground='#444'>Find</span>\n"        
             "\t<span font='sans 10' foreground='#222'><i>Next result</i>:</span><span font='sans 10' foreground='blue'> F3</span>\n"
             "\t<span font='sans 10' foreground='#222'><i>Previous result</i>:</span><span font='sans 10' foreground='blue'> Shift + F3</span>\n"
@@ -3415,16 +4388,52 @@ draw_help_mode(cairo_t *cr)
     draw_text(cr,
               "<span font='sans 10' foreground='#222'>"
               "* Use <span foreground='blue'>arrow keys</span> and <span foreground='blue'>touch strokes</span> to move within page or screens.\n"
+              "* Press <span foreground='blue'>G</span> to browse the figures of the book.\n"
+              "* Press <span foreground='blue'>O</span> to overview the pages of the book.\n"
               "* Press <span foreground='blue'>Escape</span> to to get back to reading mode</span>",
               PANGO_ALIGN_LEFT,
               PANGO_ALIGN_CENTER,
               &rect);
 }
+/*
+   pointer input is folded into one update per frame: motion keeps the latest
+   position, scroll sums its steps. the frame clock's tick handles them before
+   the frame is painted, so redraws coalesce as well.
+*/
+typedef struct
+{
+    guint tick_id;
+    gboolean has_motion;
+    double motion_x;
+    double motion_y;
+    gboolean has_scroll;
+    double scroll_dx;
+    double scroll_dy;
+    /* answer to the tooltip query of tooltip_frame */
+    gint64 tooltip_frame;
+    gboolean has_tooltip;
+    char *tooltip_markup;
+    /* received vs processed */
+    guint64 num_motion_events;
+    guint64 num_motions_processed;
+    guint64 num_scroll_events;
+    guint64 num_scrolls_processed;
+    guint64 num_tooltip_queries;
+    guint64 num_tooltips_processed;
+    guint64 num_frames_drawn;
+}PendingInput;
+
+static PendingInput pending_input = {.tooltip_frame = -1};
+
+static void
+schedule_input(void);
+
 static gboolean
 draw_callback (GtkWidget *widget,
                cairo_t   *cr,
                gpointer   data)
 {            
+    pending_input.num_frames_drawn++;
     cairo_set_source_rgb(cr, 
                          gainsboro_r, gainsboro_r, gainsboro_r);
     cairo_paint(cr);
@@ -3441,6 +4450,17 @@ draw_callback (GtkWidget *widget,
         case HelpMode:
             draw_help_mode(cr);
             break;
+        case GalleryMode:
+            figure_gallery_draw(cr,
+                                gtk_widget_get_allocated_width(ui.vellum),
+                                gtk_widget_get_allocated_height(ui.vellum));
+            break;
+        case PagesMode:
+            page_strip_draw(cr,
+                            gtk_widget_get_allocated_width(ui.vellum),
+                            gtk_widget_get_allocated_height(ui.vellum),
+                            d.cur_page_num);
+            break;
     }  
     return FALSE;
 }
@@ -3462,8 +4482,8 @@ switch_app_mode(enum AppMode new_mode)
     case ReadingMode:
         if(d.metae){
             ui.app_mode = ReadingMode;
-            double progress_x = fabs(d.image_origin_x) / cairo_image_surface_get_width(d.image);
-            double progress_y = fabs(d.image_origin_y) / cairo_image_surface_get_height(d.image);
+            double progress_x = fabs(d.image_origin_x) / d.image_width;
+            double progress_y = fabs(d.image_origin_y) / d.image_height;
             scale_page(d.zoom_level,
                        TRUE,
                        progress_x, progress_y);
@@ -3478,12 +4498,90 @@ switch_app_mode(enum AppMode new_mode)
     case HelpMode:
         ui.app_mode = HelpMode;
         break;
+    case GalleryMode:
+        if(d.metae){
+            find_widget_hide();
+            teleport_widget_hide();
+            ui.app_mode = GalleryMode;
+        }
+        break;
+    case PagesMode:
+        if(d.metae){
+            find_widget_hide();
+            teleport_widget_hide();
+            ui.app_mode = PagesMode;
+            page_strip_scroll_to_page(d.cur_page_num);
+        }
+        break;
     }
     gdk_window_set_cursor(gtk_widget_get_window(ui.vellum),
                           ui.default_cursor);
     gtk_widget_queue_draw(ui.vellum);
 }
 
+static void
+dump_stats(void)
+{
+    /* debugging aid, set READARATUS_STATS to see what caches and workers are up to */
+    if(!g_getenv("READARATUS_STATS")){
+        return;
+    }
+    regex_registry_dump_stats();
+    page_store_dump_stats();
+    surface_pool_dump_stats();
+    page_filter_dump_stats();
+    render_pool_dump_stats();
+    g_print("page navigations: %" G_GUINT64_FORMAT ", %" G_GUINT64_FORMAT " previews, "
+            "%" G_GUINT64_FORMAT " settled in %.2f ms each, first pixels within %.2f ms\n",
+            num_navigations,
+            num_page_previews,
+            num_settled_pages,
+            num_settled_pages ? settle_latency_us / 1000.0 / num_settled_pages : 0.0,
+            max_first_pixel_latency_us / 1000.0);
+    g_print("prefetched pages shown: %" G_GUINT64_FORMAT "\n",
+            num_prefetch_hits);
+    g_print("input: %" G_GUINT64_FORMAT "/%" G_GUINT64_FORMAT " motion, "
+            "%" G_GUINT64_FORMAT "/%" G_GUINT64_FORMAT " scroll, "
+            "%" G_GUINT64_FORMAT "/%" G_GUINT64_FORMAT " tooltip events processed, "
+            "%" G_GUINT64_FORMAT " frames drawn\n",
+            pending_input.num_motions_processed, pending_input.num_motion_events,
+            pending_input.num_scrolls_processed, pending_input.num_scroll_events,
+            pending_input.num_tooltips_processed, pending_input.num_tooltip_queries,
+            pending_input.num_frames_drawn);
+}
+
+static void
+on_memory_pressure(enum MemoryPressure level)
+{
+    /* every level sheds what the milder ones do, and more */
+    static const double budget_fractions[] = {1.0, 0.5, 0.25, 0.0};
+    static const int max_thumbnails[] = {G_MAXINT, 64, 16, 0};
+    g_print("memory pressure: %s\n",
+            memory_pressure_to_string(level));
+    page_store_set_budget_fraction(budget_fractions[level]);
+    figure_gallery_set_cache_limit(max_thumbnails[level]);
+    page_strip_set_cache_limit(max_thumbnails[level]);
+    if(level >= MemoryPressureMedium && d.figure_images){
+        /* recreated on demand by create_image_for_figure() */
+        g_hash_table_remove_all(d.figure_images);
+    }
+    if(level >= MemoryPressureMedium){
+        drop_prefetched_pages();
+    }
+    if(level > MemoryPressureNone){
+        surface_pool_trim(0);
+    }
+    if(d.metae && ui.app_mode == ReadingMode){
+        /* the page surface follows the current level, see page_render_scale() */
+        double progress_x = fabs(d.image_origin_x) / d.image_width;
+        double progress_y = fabs(d.image_origin_y) / d.image_height;
+        scale_page(d.zoom_level,
+                   TRUE,
+                   progress_x, progress_y);
+    }
+    dump_stats();
+}
+
 static gboolean
 key_press_callback(GtkWidget   *widget,
                    GdkEventKey *event,
@@ -3506,6 +4604,58 @@ key_press_callback(GtkWidget   *widget,
         case GDK_KEY_F11:
             toggle_fullscreen();
             break;
+        case GDK_KEY_d:
+        case GDK_KEY_D:
+            if(event->state & GDK_CONTROL_MASK){
+                ui.theme = (ui.theme + 1) % (PageThemeSepia + 1);
+                g_print("theme: %s\n",
+                        page_filter_theme_to_string(ui.theme));
+                filter_page();
+                gtk_widget_queue_draw(ui.vellum);
+            }
+            else{
+                handled = FALSE;
+            }
+            break;
+        case GDK_KEY_b:
+        case GDK_KEY_B:
+            if(event->state & GDK_CONTROL_MASK){
+                ui.is_contrast_boosted = !ui.is_contrast_boosted;
+                filter_page();
+                gtk_widget_queue_draw(ui.vellum);
+            }
+            else{
+                handled = FALSE;
+            }
+            break;
+        case GDK_KEY_m:
+        case GDK_KEY_M:
+            /* debugging aid: cycle through simulated memory pressure levels */
+            if(event->state & GDK_CONTROL_MASK){
+                memory_pressure_simulate((memory_pressure_get_level() + 1) % (MemoryPressureCritical + 1));
+            }
+            else{
+                handled = FALSE;
+            }
+            break;
+        case GDK_KEY_G:
+        case GDK_KEY_g:
+            if(ui.app_mode == GalleryMode){
+                switch_app_mode(ReadingMode);
+            }
+            else{
+                switch_app_mode(GalleryMode);
+            }
+            break;
+        case GDK_KEY_O:
+        case GDK_KEY_o:
+            if(ui.app_mode == PagesMode){
+                switch_app_mode(ReadingMode);
+            }
+            else{
+                switch_app_mode(PagesMode);
+            }
+            break;
         case GDK_KEY_Home:
             if(ui.app_mode == ReadingMode){
                 goto_page(0,
@@ -3516,12 +4666,21 @@ key_press_callback(GtkWidget   *widget,
                 d.toc.origin_y = 0;
                 gtk_widget_queue_draw(ui.vellum);                
             }
+            else if(ui.app_mode == GalleryMode){
+                figure_gallery_scroll_to_top();
+            }
+            else if(ui.app_mode == PagesMode){
+                page_strip_scroll_to_page(0);
+            }
             break;
         case GDK_KEY_End:
             if(ui.app_mode == ReadingMode){
                 goto_page(d.num_pages - 1,
                           0, 0);
             }
+            else if(ui.app_mode == PagesMode){
+                page_strip_scroll_to_page(d.num_pages - 1);
+            }
             break;
         case GDK_KEY_i:
         case GDK_KEY_I:
@@ -3586,25 +4745,33 @@ key_press_callback(GtkWidget   *widget,
             break;
         case 65364:
             // arrow down
-            if(ui.app_mode == ReadingMode || ui.app_mode == TOCMode){
+            if(ui.app_mode == ReadingMode || ui.app_mode == TOCMode ||
+               ui.app_mode == GalleryMode || ui.app_mode == PagesMode)
+            {
                 scroll_with_pixels(0, -10);                
             }
             break;
         case 65362:
             // arrow up
-            if(ui.app_mode == ReadingMode || ui.app_mode == TOCMode){
+            if(ui.app_mode == ReadingMode || ui.app_mode == TOCMode ||
+               ui.app_mode == GalleryMode || ui.app_mode == PagesMode)
+            {
                 scroll_with_pixels(0, 10);                
             }
             break;
         case 65361:
             // arrow left
-            if(ui.app_mode == ReadingMode || ui.app_mode == TOCMode){
+            if(ui.app_mode == ReadingMode || ui.app_mode == TOCMode ||
+               ui.app_mode == GalleryMode || ui.app_mode == PagesMode)
+            {
                 scroll_with_pixels(10, 0);                
             }
             break;
         case 65363:
             // arrow right
-            if(ui.app_mode == ReadingMode || ui.app_mode == TOCMode){
+            if(ui.app_mode == ReadingMode || ui.app_mode == TOCMode ||
+               ui.app_mode == GalleryMode || ui.app_mode == PagesMode)
+            {
                 scroll_with_pixels(-10, 0);                
             }
             break;        
@@ -3672,7 +4839,12 @@ scroll_event_callback(GtkWidget       *widget,
         default:
             dx = dy = 0;
     }
-    scroll_with_pixels(dx, dy);
+    /* summed up until the next frame */
+    pending_input.num_scroll_events++;
+    pending_input.has_scroll = TRUE;
+    pending_input.scroll_dx += dx;
+    pending_input.scroll_dy += dy;
+    schedule_input();
     return TRUE;
 }
 
@@ -3700,14 +4872,14 @@ button_press_callback (GtkWidget      *widget,
         }
     }
     else if(ui.app_mode == ReadingMode){
-        double image_width = cairo_image_surface_get_width(d.image);   
-        double image_height = cairo_image_surface_get_height(d.image);   
+        double image_width = d.image_width;   
+        double image_height = d.image_height;   
         PageMeta *meta = g_ptr_array_index(d.metae,
                                        d.cur_page_num);
         /* link */
-        GList *link_p = meta->links;
-        while(link_p){
-            Link *link = link_p->data;
+        for(int i = 0; i < meta->links->len; i++){
+            Link *link = g_ptr_array_index(meta->links,
+                                           i);
             Rect img_rect = map_physical_rect_to_image(link->physical_layout,
                                                        meta->page_width,
                                                        meta->page_height,
@@ -3721,7 +4893,6 @@ button_press_callback (GtkWidget      *widget,
                 activate_link(link);
                 break;
             }
-            link_p = link_p->next;
         }
         /* navigation widget */
         if(ui.is_panel_hovered && rect_contains_point(ui.prev_page_button_rect,
@@ -3830,54 +5001,60 @@ button_press_callback (GtkWidget      *widget,
             }
         }
     }
+    else if(ui.app_mode == GalleryMode){
+        Figure *figure = figure_gallery_hover(event->x,
+                                              event->y);
+        if(figure){
+            go_back_save();
+            switch_app_mode(ReadingMode);
+            goto_figure_page(figure);
+        }
+    }
+    else if(ui.app_mode == PagesMode){
+        int page_num = page_strip_hover(event->x,
+                                        event->y);
+        if(page_num >= 0){
+            go_back_save();
+            switch_app_mode(ReadingMode);
+            goto_page(page_num,
+                      0, 0);
+        }
+    }
     else{        
     }
     return TRUE;                     
 }
 
-static gboolean
-motion_event_callback (GtkWidget      *widget,
-                       GdkEventMotion *event,
-                       gpointer        data)
+static void
+handle_motion(double x,
+              double y)
 {
+    /* hit-testing for the pointer at (x, y), once a frame, see on_frame_tick() */
     gboolean is_cursor_set = FALSE;
     if(ui.app_mode == StartMode){
         ui.is_import_area_hovered = rect_contains_point(ui.import_area_rect,
-                                                        event->x, event->y);
+                                                        x, y);
         ui.is_continue_to_book_button_hovered =  rect_contains_point(ui.continue_to_book_button_rect,
-                                                                     event->x, event->y);
+                                                                     x, y);
         is_cursor_set = ui.is_import_area_hovered || ui.is_continue_to_book_button_hovered;
     }
     else if(ui.app_mode == ReadingMode){
         PageMeta *meta = g_ptr_array_index(d.metae,
                                            d.cur_page_num);
-        double image_width = cairo_image_surface_get_width(d.image);
-        double image_height = cairo_image_surface_get_height(d.image);       
+        double image_width = d.image_width;
+        double image_height = d.image_height;       
         /* show referenced figure */
         meta->active_referenced_figure = NULL;
-        GList *list_p = meta->referenced_figures;
-        while(list_p && !meta->active_referenced_figure){
-            ReferencedFigure *ref_figure = list_p->data;
+        for(int i = 0; i < meta->referenced_figures->len && !meta->active_referenced_figure; i++){
+            ReferencedFigure *ref_figure = g_ptr_array_index(meta->referenced_figures,
+                                                             i);
             GList *result_p = ref_figure->find_results;
             while(result_p && !meta->active_referenced_figure){
-                FindResult *find_result = result_p->data;
-                GList *rect_p = find_result->physical_layouts;
-                while(rect_p){
-                    Rect img_layout = map_physical_rect_to_image(rect_p->data,
-                                                                 meta->page_width,
-                                                                 meta->page_height,
-                                                                 image_width,
-                                                                 image_height,
-                                                                 d.image_origin_x,
-                                                                 d.image_origin_y);
-                    if(rect_contains_point(&img_layout,
-                                           event->x, event->y))
-                    {                    
-                        break;
-                    }
-                    rect_p = rect_p->next;
-                }
-                if(rect_p){
+                if(find_result_contains_point(meta,
+                                              result_p->data,
+                                              image_width, image_height,
+                                              x, y))
+                {
                     ref_figure->activated_find_result = result_p;
                     meta->active_referenced_figure = ref_figure;
                 }
@@ -3886,36 +5063,35 @@ motion_event_callback (GtkWidget      *widget,
                 }
                 result_p = result_p->next;
             }
-            list_p = list_p->next;            
         }        
         /* panel */
         ui.is_panel_hovered = !ui.is_link_hovered && !ui.is_find_result_hovered &&
                               !ui.is_unit_hovered &&!meta->active_referenced_figure &&
                               rect_contains_point(ui.panel_rect,
-                                                  event->x, event->y);
+                                                  x, y);
         if(ui.is_panel_hovered){
             ui.is_prev_page_button_hovered = d.cur_page_num > 0 &&
                                              rect_contains_point(ui.prev_page_button_rect,
-                                                                 event->x, event->y);
+                                                                 x, y);
             ui.is_next_page_button_hovered = d.cur_page_num < d.num_pages - 1 &&
                                              rect_contains_point(ui.next_page_button_rect,
-                                                                 event->x, event->y);
+                                                                 x, y);
             /* zoom widget */
             ui.is_zoom_widget_PF_hovered = rect_contains_point(ui.zoom_widget_PF_rect,
-                                                               event->x, event->y);    
+                                                               x, y);    
             ui.is_zoom_widget_WF_hovered = rect_contains_point(ui.zoom_widget_WF_rect,
-                                                               event->x, event->y);
+                                                               x, y);
             ui.is_zoom_widget_IN_hovered = rect_contains_point(ui.zoom_widget_IN_rect,
-                                                               event->x, event->y);
+                                                               x, y);
             ui.is_zoom_widget_OUT_hovered = rect_contains_point(ui.zoom_widget_OUT_rect,
-                                                                event->x, event->y);
+                                                                x, y);
             /* launchers */
             ui.is_teleport_launcher_hovered = rect_contains_point(ui.teleport_launcher_rect,
-                                                                  event->x, event->y);
+                                                                  x, y);
             ui.is_find_text_launcher_hovered = rect_contains_point(ui.find_text_launcher_rect,
-                                                                   event->x, event->y);
+                                                                   x, y);
             ui.is_toc_launcher_hovered = rect_contains_point(ui.toc_launcher_rect,
-                                                             event->x, event->y);
+                                                             x, y);
         }        
         is_cursor_set = ui.is_link_hovered ||
                         ui.is_prev_page_button_hovered || ui.is_next_page_button_hovered ||
@@ -3928,12 +5104,12 @@ motion_event_callback (GtkWidget      *widget,
         d.toc.hovered_item = NULL;
         d.toc.hovered_navigation_button = NULL;
         double widget_height = gtk_widget_get_allocated_height(ui.vellum);
-        if(event->y < widget_height - toc_navigation_panel_height){
+        if(y < widget_height - toc_navigation_panel_height){
             GList *item_p = d.toc.flattened_items;
             while(item_p){
                 TOCItem *toc_item = item_p->data;
                 if(rect_contains_point(toc_item->rect,
-                                       event->x, event->y))
+                                       x, y))
                 {
                     break;
                 }
@@ -3950,7 +5126,7 @@ motion_event_callback (GtkWidget      *widget,
             while(list_p){
                 Rect *button_rect = list_p->data;
                 if(rect_contains_point(button_rect,
-                                       event->x, event->y))
+                                       x, y))
                 {
                     break;
                 }
@@ -3962,66 +5138,110 @@ motion_event_callback (GtkWidget      *widget,
             }
         }
     }
+    else if(ui.app_mode == GalleryMode){
+        is_cursor_set = figure_gallery_hover(x,
+                                             y) != NULL;
+    }
+    else if(ui.app_mode == PagesMode){
+        is_cursor_set = page_strip_hover(x,
+                                         y) >= 0;
+    }
     else{        
     }
     gdk_window_set_cursor(gtk_widget_get_window(ui.vellum),
                           is_cursor_set ? ui.pointer_cursor : ui.default_cursor);
     gtk_widget_queue_draw(ui.vellum); 
-    return TRUE;
 }
 
 static gboolean
-tooltip_event_callback(GtkWidget  *widget,
-                       gint        x,
-                       gint        y,
-                       gboolean    keyboard_mode,
-                       GtkTooltip *tooltip,
-                       gpointer    user_data)
+on_frame_tick(GtkWidget     *widget,
+              GdkFrameClock *frame_clock,
+              gpointer       data)
 {
-    if(keyboard_mode){
-        return FALSE; 
+    /* scroll first, what's under the pointer depends on it */
+    pending_input.tick_id = 0;
+    if(pending_input.has_scroll){
+        pending_input.has_scroll = FALSE;
+        pending_input.num_scrolls_processed++;
+        scroll_with_pixels(pending_input.scroll_dx,
+                           pending_input.scroll_dy);
+        pending_input.scroll_dx = 0;
+        pending_input.scroll_dy = 0;
+    }
+    if(pending_input.has_motion){
+        pending_input.has_motion = FALSE;
+        pending_input.num_motions_processed++;
+        handle_motion(pending_input.motion_x,
+                      pending_input.motion_y);
+    }
+    return G_SOURCE_REMOVE;
+}
+
+static void
+schedule_input(void)
+{
+    if(!pending_input.tick_id){
+        pending_input.tick_id = gtk_widget_add_tick_callback(ui.vellum,
+                                                             on_frame_tick,
+                                                             NULL,
+                                                             NULL);
     }
+}
+
+static gboolean
+motion_event_callback (GtkWidget      *widget,
+                       GdkEventMotion *event,
+                       gpointer        data)
+{
+    /* only the latest position matters */
+    pending_input.num_motion_events++;
+    pending_input.has_motion = TRUE;
+    pending_input.motion_x = event->x;
+    pending_input.motion_y = event->y;
+    schedule_input();
+    return TRUE;
+}
+
+static void
+set_tooltip_markup(GtkTooltip *tooltip,
+                   const char *markup)
+{
+    /* remembered for the queries that follow in the same frame */
+    g_free(pending_input.tooltip_markup);
+    pending_input.tooltip_markup = g_strdup(markup);
+    gtk_tooltip_set_markup(tooltip,
+                           markup);
+}
+
+static gboolean
+query_tooltip(gint        x,
+              gint        y,
+              GtkTooltip *tooltip)
+{
     if(ui.app_mode == ReadingMode){
         ui.is_unit_hovered = FALSE;    
         /* units */
         char *unit_tip = NULL;  
         PageMeta *meta = g_ptr_array_index(d.metae,
                                            d.cur_page_num);
-        double image_width = cairo_image_surface_get_width(d.image);
-        double image_height = cairo_image_surface_get_height(d.image);
+        double image_width = d.image_width;
+        double image_height = d.image_height;
         ConvertedUnit *tooltip_cv = NULL;
-        GList *list_p = meta->converted_units;
-        while(list_p){
-            ConvertedUnit *cv = list_p->data;
+        for(int i = 0; i < meta->converted_units->len && !tooltip_cv; i++){
+            ConvertedUnit *cv = g_ptr_array_index(meta->converted_units,
+                                                  i);
             GList *result_p = cv->find_results;
             while(result_p){
-                FindResult *fr = result_p->data;
-                GList *rect_p = fr->physical_layouts;
-                while(rect_p){
-                    Rect img_rect = map_physical_rect_to_image(rect_p->data,
-                                                               meta->page_width,
-                                                               meta->page_height,
-                                                               image_width,
-                                                               image_height,
-                                                               d.image_origin_x,
-                                                               d.image_origin_y);
-                    if(rect_contains_point(&img_rect,
-                                           x, y))
-                    {
-                        tooltip_cv = cv;
-                        break;
-                    }
-                    rect_p = rect_p->next;
-                }
-                if(tooltip_cv){
+                if(find_result_contains_point(meta,
+                                              result_p->data,
+                                              image_width, image_height,
+                                              x, y))
+                {
+                    tooltip_cv = cv;
                     break;
                 }
                 result_p = result_p->next;
             }
-            if(tooltip_cv){
-                break;
-            }
-            list_p = list_p->next;
         }
         if(tooltip_cv){
             unit_tip = g_strdup_printf("<span font='sans 10' >~= %s</span>",
@@ -4031,32 +5251,20 @@ tooltip_event_callback(GtkWidget  *widget,
         /* find results */
         ui.is_find_result_hovered = FALSE;    
         char *find_tip = NULL;
-        list_p = meta->find_results;
-        while(list_p){
-            FindResult *fr = list_p->data;
-            GList *rect_p = fr->physical_layouts;
-            while(rect_p){
-                Rect img_rect = map_physical_rect_to_image(rect_p->data,
-                                                           meta->page_width,
-                                                           meta->page_height,
-                                                           image_width,
-                                                           image_height,
-                                                           d.image_origin_x,
-                                                           d.image_origin_y);
-                if(rect_contains_point(&img_rect,
-                                       x, y))
-                {
-                    break;
-                }
-                rect_p = rect_p->next;
-            }
-            if(rect_p){
-                break;
+        FindResult *hovered_result = NULL;
+        for(int i = 0; i < meta->find_results->len && !hovered_result; i++){
+            FindResult *fr = g_ptr_array_index(meta->find_results,
+                                               i);
+            if(find_result_contains_point(meta,
+                                          fr,
+                                          image_width, image_height,
+                                          x, y))
+            {
+                hovered_result = fr;
             }
-            list_p = list_p->next;
         }
-        if(list_p){
-            FindResult *fr = list_p->data;
+        if(hovered_result){
+            FindResult *fr = hovered_result;
             find_tip = g_strdup_printf("<span font='sans 10' >%s</span>",
                                        fr->tip);
             ui.is_find_result_hovered = TRUE;
@@ -4064,9 +5272,9 @@ tooltip_event_callback(GtkWidget  *widget,
         /* links */
         char *link_tip = NULL;
         ui.is_link_hovered = FALSE;
-        list_p = meta->links;
-        while(list_p){
-            Link *link = list_p->data;
+        for(int i = 0; i < meta->links->len; i++){
+            Link *link = g_ptr_array_index(meta->links,
+                                           i);
             Rect img_rect = map_physical_rect_to_image(link->physical_layout,
                                                        meta->page_width,
                                                        meta->page_height,
@@ -4081,7 +5289,6 @@ tooltip_event_callback(GtkWidget  *widget,
                                            link->tip ? link->tip : "Not available.");
                 ui.is_link_hovered = TRUE;
             }
-            list_p = list_p->next;
         }
         char *tip_markup = NULL;
         if(unit_tip || find_tip || link_tip){   
@@ -4091,8 +5298,8 @@ tooltip_event_callback(GtkWidget  *widget,
                                            (unit_tip || find_tip) && link_tip ? "\n\n" : "",
                                            link_tip ? link_tip : "",
                                            NULL);
-            gtk_tooltip_set_markup(GTK_TOOLTIP(tooltip),
-                                   tip_markup); 
+            set_tooltip_markup(tooltip,
+                               tip_markup);
             g_free(unit_tip);
             g_free(find_tip);
             g_free(link_tip);
@@ -4122,8 +5329,8 @@ tooltip_event_callback(GtkWidget  *widget,
             tip_markup = "<span font='sans 10' >Shows table of contents(CTRL + T)</span>";
         }
         if(ui.is_panel_hovered && tip_markup){
-            gtk_tooltip_set_markup(GTK_TOOLTIP(tooltip),
-                                   tip_markup); 
+            set_tooltip_markup(tooltip,
+                               tip_markup);
             return TRUE;
         }
     }
@@ -4136,8 +5343,8 @@ tooltip_event_callback(GtkWidget  *widget,
             tip_markup = "<span font='sans 10' >Hit to continue reading book(R or Escape)</span>";
         }
         if(tip_markup){
-            gtk_tooltip_set_markup(GTK_TOOLTIP(tooltip),
-                                   tip_markup); 
+            set_tooltip_markup(tooltip,
+                               tip_markup);
             return TRUE;
         }
     }
@@ -4148,6 +5355,38 @@ tooltip_event_callback(GtkWidget  *widget,
     return FALSE; 
 }
 
+static gboolean
+tooltip_event_callback(GtkWidget  *widget,
+                       gint        x,
+                       gint        y,
+                       gboolean    keyboard_mode,
+                       GtkTooltip *tooltip,
+                       gpointer    user_data)
+{
+    /* gtk asks on every motion while a tip is up, answer once a frame */
+    if(keyboard_mode){
+        return FALSE; 
+    }
+    pending_input.num_tooltip_queries++;
+    GdkFrameClock *frame_clock = gtk_widget_get_frame_clock(widget);
+    gint64 frame = frame_clock ? gdk_frame_clock_get_frame_counter(frame_clock) : -1;
+    if(frame >= 0 && frame == pending_input.tooltip_frame){
+        if(pending_input.has_tooltip){
+            gtk_tooltip_set_markup(tooltip,
+                                   pending_input.tooltip_markup);
+        }
+        return pending_input.has_tooltip;
+    }
+    pending_input.num_tooltips_processed++;
+    g_free(pending_input.tooltip_markup);
+    pending_input.tooltip_markup = NULL;
+    pending_input.has_tooltip = query_tooltip(x,
+                                              y,
+                                              tooltip);
+    pending_input.tooltip_frame = frame;
+    return pending_input.has_tooltip;
+}
+
 static void
 destroy_app()
 {
@@ -4176,9 +5415,21 @@ destroy_app()
     toc_module_destroy();
     unit_convertor_module_destroy();
     figure_module_destroy();
+    memory_pressure_module_destroy();
+    dump_stats();
+    if(pending_input.tick_id){
+        gtk_widget_remove_tick_callback(ui.vellum,
+                                        pending_input.tick_id);
+        pending_input.tick_id = 0;
+    }
+    g_free(pending_input.tooltip_markup);
+    regex_registry_module_destroy();
 
     teleport_widget_destroy();
     find_widget_destroy();
+    figure_gallery_module_destroy();
+    page_strip_module_destroy();
+    surface_pool_module_destroy();
     readaratus_unregister_resource();
     /* g_list_free_full(ui.icons,
                       (GDestroyNotify)gdk_pixbuf_unref);*/
@@ -4230,11 +5481,15 @@ init_app(GtkApplication *app)
     gtk_widget_set_events(ui.main_window, 
                           GDK_STRUCTURE_MASK);
     ui.is_fullscreen = FALSE;
+    ui.theme = PageThemeDay;
+    ui.is_contrast_boosted = FALSE;
     g_signal_connect(G_OBJECT(ui.main_window), "window_state_event",
                      G_CALLBACK(window_state_callback), NULL);
     readaratus_register_resource(); 
     load_icons();
     ui.vellum = gtk_drawing_area_new();
+    figure_gallery_module_init(ui.vellum);
+    page_strip_module_init(ui.vellum);
     gtk_widget_set_size_request(ui.vellum,
                                 widget_width, widget_height);
     gtk_widget_set_has_tooltip(ui.vellum,
@@ -4314,8 +5569,10 @@ init_app(GtkApplication *app)
     ui.find_text_launcher_rect = rect_new();
     ui.toc_launcher_rect = rect_new();
 
-    d.page_label_num_hash = g_hash_table_new(g_str_hash,
-                                             g_str_equal);
+    d.page_label_num_hash = g_hash_table_new_full(g_str_hash,
+                                                  g_str_equal,
+                                                  g_free,
+                                                  NULL);
     d.go_back_stack = g_queue_new();
 
     gtk_container_add(GTK_CONTAINER(ui.main_window), ui.vellum);    
@@ -4329,6 +5586,7 @@ init_app(GtkApplication *app)
     toc_module_init();
     unit_convertor_module_init();
     figure_module_init();
+    memory_pressure_module_init(on_memory_pressure);
     ui.teleport_widget = teleport_widget_init(ui.main_window);
     g_signal_connect(G_OBJECT(ui.teleport_widget), "teleport_request_event",
                      G_CALLBACK(on_teleport_request_received), NULL);
@@ -22,10 +22,13 @@
 #include <poppler/glib/poppler.h>
 #include "rect.h"
 #include "toc.h"
+#include "teleport_index.h"
+#include "arena.h"
+#include "page_filter.h"
 
 enum AppMode
 {
-    StartMode, ReadingMode, TOCMode, HelpMode
+    StartMode, ReadingMode, TOCMode, HelpMode, GalleryMode, PagesMode
 };
 
 enum ZoomLevel
@@ -44,6 +47,9 @@ struct Ui
     GdkCursor *pointer_cursor;
     /* app mode */
     enum AppMode app_mode;
+    /* reading theme */
+    enum PageTheme theme;
+    gboolean is_contrast_boosted;
     /* start mode widgets */
     gboolean is_import_area_hovered;
     Rect *import_area_rect;
@@ -106,8 +112,9 @@ struct TOC
 
 struct FindDetails
 {
-    GList *find_results;
-    GList *selected_p;
+    /* sorted by page and position, NULL when there is no search */
+    GPtrArray *find_results;
+    int selected_index;
     int max_results;
     int max_results_page_num;
 };
@@ -134,6 +141,14 @@ struct Document
     GPtrArray *metae;
         
     cairo_surface_t *image;
+    /* the page d.image shows, it is a stand-in until settled, see request_reading_page() */
+    int image_page_num;
+    gboolean is_image_settled;
+    /* size of the page on screen, the surface may be coarser, see page_render_scale() */
+    double image_width;
+    double image_height;
+    /* d.image with the theme and contrast boost applied, NULL when not needed */
+    cairo_surface_t *filtered_image;
     double image_origin_x;
     double image_origin_y;
     double preserved_progress_x;
@@ -148,6 +163,13 @@ struct Document
     struct FindDetails find_details;
     struct TOC toc;
     GQueue *go_back_stack;
+    TeleportIndex *teleport_index;
+    /* 'label class#id' > Figure, see figure_index_new() */
+    GHashTable *figure_index;
+    /* Figure > cairo_surface_t, images made by create_image_for_figure() */
+    GHashTable *figure_images;
+    /* document-lifetime objects: page metas, page label records, ... */
+    Arena *arena;
 }d;
 
 void 
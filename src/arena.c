@@ -0,0 +1,159 @@
+/*
+ * Copyright © 2020 Reza Hasanzadeh
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 3.0 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "arena.h"
+#include <string.h>
+
+/*
+   a bump allocator: objects that live as long as a document or a page are
+   carved out of chunks and released all at once, there is no per object
+   free. chunks start small and double up to the arena's chunk size, so a
+   page with a single link doesn't pay for a full chunk.
+*/
+
+#define ARENA_ALIGNMENT 16
+#define ARENA_FIRST_CHUNK_SIZE 256
+
+typedef struct ArenaChunk ArenaChunk;
+struct ArenaChunk
+{
+    ArenaChunk *next;
+    gsize size;
+    gsize used;
+    /* chunk memory follows, aligned */
+};
+
+struct Arena
+{
+    ArenaChunk *chunks;
+    /* the largest chunk, large objects are measured against it */
+    gsize chunk_size;
+    gsize next_chunk_size;
+    gsize total_size;
+};
+
+#define CHUNK_HEADER_SIZE ((sizeof(ArenaChunk) + ARENA_ALIGNMENT - 1) & ~(gsize)(ARENA_ALIGNMENT - 1))
+
+static ArenaChunk *
+arena_chunk_new(Arena *arena,
+                gsize  size)
+{
+    ArenaChunk *chunk = g_malloc(CHUNK_HEADER_SIZE + size);
+    chunk->next = arena->chunks;
+    chunk->size = size;
+    chunk->used = 0;
+    arena->chunks = chunk;
+    arena->total_size += CHUNK_HEADER_SIZE + size;
+    return chunk;
+}
+
+Arena *
+arena_new(gsize chunk_size)
+{
+    Arena *arena = g_malloc(sizeof(Arena));
+    arena->chunks = NULL;
+    arena->chunk_size = MAX(chunk_size, ARENA_ALIGNMENT);
+    arena->next_chunk_size = MIN(arena->chunk_size, ARENA_FIRST_CHUNK_SIZE);
+    arena->total_size = sizeof(Arena);
+    return arena;
+}
+
+void
+arena_free(Arena *arena)
+{
+    if(!arena){
+        return;
+    }
+    ArenaChunk *chunk = arena->chunks;
+    while(chunk){
+        ArenaChunk *next = chunk->next;
+        g_free(chunk);
+        chunk = next;
+    }
+    g_free(arena);
+}
+
+gpointer
+arena_alloc(Arena *arena,
+            gsize  size)
+{
+    size = (size + ARENA_ALIGNMENT - 1) & ~(gsize)(ARENA_ALIGNMENT - 1);
+    ArenaChunk *chunk = arena->chunks;
+    if(!chunk || chunk->size - chunk->used < size){
+        if(size > arena->chunk_size / 4){
+            /* large objects get a chunk of their own, behind the current one */
+            ArenaChunk *current = arena->chunks;
+            ArenaChunk *large = arena_chunk_new(arena,
+                                                size);
+            if(current){
+                arena->chunks = current;
+                large->next = current->next;
+                current->next = large;
+            }
+            large->used = size;
+            return (char *)large + CHUNK_HEADER_SIZE;
+        }
+        chunk = arena_chunk_new(arena,
+                                MAX(arena->next_chunk_size, size));
+        arena->next_chunk_size = MIN(arena->next_chunk_size * 2,
+                                     arena->chunk_size);
+    }
+    gpointer p = (char *)chunk + CHUNK_HEADER_SIZE + chunk->used;
+    chunk->used += size;
+    return p;
+}
+
+gpointer
+arena_alloc0(Arena *arena,
+             gsize  size)
+{
+    gpointer p = arena_alloc(arena,
+                             size);
+    memset(p, 0, size);
+    return p;
+}
+
+char *
+arena_strdup(Arena      *arena,
+             const char *string)
+{
+    if(!string){
+        return NULL;
+    }
+    gsize length = strlen(string) + 1;
+    char *copy = arena_alloc(arena,
+                             length);
+    memcpy(copy, string, length);
+    return copy;
+}
+
+char *
+arena_adopt_string(Arena *arena,
+                   char  *string)
+{
+    /* moves a g_malloc'ed string into the arena */
+    char *copy = arena_strdup(arena,
+                              string);
+    g_free(string);
+    return copy;
+}
+
+gsize
+arena_size(const Arena *arena)
+{
+    return arena ? arena->total_size : 0;
+}
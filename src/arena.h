@@ -0,0 +1,52 @@
+/*
+ * Copyright © 2020 Reza Hasanzadeh
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 3.0 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <glib.h>
+
+typedef struct Arena Arena;
+
+#define arena_new0(arena, type, n) ((type *)arena_alloc0((arena), sizeof(type) * (n)))
+
+Arena *
+arena_new(gsize chunk_size);
+
+void
+arena_free(Arena *arena);
+
+gpointer
+arena_alloc(Arena *arena,
+            gsize  size);
+
+gpointer
+arena_alloc0(Arena *arena,
+             gsize  size);
+
+char *
+arena_strdup(Arena      *arena,
+             const char *string);
+
+char *
+arena_adopt_string(Arena *arena,
+                   char  *string);
+
+gsize
+arena_size(const Arena *arena);
+
+#endif
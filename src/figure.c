@@ -16,6 +16,9 @@
  */
 
 #include "figure.h"
+#include "find.h"
+#include "regex_registry.h"
+#include <string.h>
 
 static GRegex *text_preprocessor_regex = NULL;
 static GRegex *figure_caption_regex = NULL;
@@ -27,7 +30,7 @@ void
 figure_module_init(void)
 {
     GError *err = NULL;
-    text_preprocessor_regex = g_regex_new(
+    text_preprocessor_regex = regex_registry_lookup(
         "[0-9]+,[0-9]+",
         G_REGEX_CASELESS | G_REGEX_EXTENDED | G_REGEX_NO_AUTO_CAPTURE,
         0,
@@ -37,7 +40,7 @@ figure_module_init(void)
                 err->domain, err->code, err->message);
     }    
 
-    figure_caption_regex = g_regex_new(
+    figure_caption_regex = regex_registry_lookup(
         "# label\n"
         "^(?<label>fig(ure)?|pic(ture)?|image|img|photo|map|box|illustration)?\\s?(\\.|-|_)?\\s?(\\(|\\[|\\{)?\\s?\n"
         "(?<id>\n"
@@ -54,7 +57,7 @@ figure_module_init(void)
                 err->domain, err->code, err->message);
     }
 
-    figure_reference_regex = g_regex_new(
+    figure_reference_regex = regex_registry_lookup(
         "# label\n"
         "\\b(?<label>fig(ure)?|pic(ture)?|image|img|photo|map|box|illustration)\\s?(-\\R+)?(\\.|-|_)?\\s?(\\(|\\[|\\{)?\\s?\n"
         "(?<id>\n"
@@ -71,7 +74,7 @@ figure_module_init(void)
                 err->domain, err->code, err->message);
     }    
 
-    whole_match_cleaner_regex = g_regex_new(
+    whole_match_cleaner_regex = regex_registry_lookup(
         "^(\\.|-|_)*|(\\.|-|_)*$|\\R$",
          G_REGEX_CASELESS | G_REGEX_EXTENDED | G_REGEX_NO_AUTO_CAPTURE,
          0,
@@ -81,7 +84,7 @@ figure_module_init(void)
                 err->domain, err->code, err->message);
     }   
 
-    id_cleaner_regex = g_regex_new(
+    id_cleaner_regex = regex_registry_lookup(
         "^(\\.|-|_)*|(\\.|-|_)*$",
          G_REGEX_CASELESS | G_REGEX_EXTENDED | G_REGEX_NO_AUTO_CAPTURE,
          0,
@@ -115,6 +118,7 @@ figure_new(void)
     new_fig->page_num = -1;
     new_fig->image_id = -1;
     new_fig->image_physical_layout = NULL;
+    new_fig->is_image_merged = FALSE;
     new_fig->captions = NULL;
     new_fig->reference = NULL;
     return new_fig;
@@ -179,10 +183,10 @@ extract_figure_captions (const char *text)
                                                     0,
                                                     NULL);
         g_free(whole_match);        
-        if(g_regex_match_simple("\\R",
-                                cleaned_whole_match,
-                                0,
-                                0))
+        if(regex_registry_match_simple("\\R",
+                                       cleaned_whole_match,
+                                       0,
+                                       0))
         {
             g_free(cleaned_whole_match);
             g_match_info_next(match_info,
@@ -195,10 +199,10 @@ extract_figure_captions (const char *text)
                                                "label");
         if(strlen(label) > 0){
             fig->label =  label;
-            fig->is_label_exclusive = g_regex_match_simple("fig(ure)?|pic(ture)?|image|img|photo|illustration",
-                                                           fig->label,
-                                                           G_REGEX_CASELESS,
-                                                           0);
+            fig->is_label_exclusive = regex_registry_match_simple("fig(ure)?|pic(ture)?|image|img|photo|illustration",
+                                                                  fig->label,
+                                                                  G_REGEX_CASELESS,
+                                                                  0);
         }
         else{
             fig->label = NULL;
@@ -215,10 +219,10 @@ extract_figure_captions (const char *text)
                                   0,
                                   NULL);
         g_free(id);        
-        fig->is_id_complex = g_regex_match_simple("\\.|-|_",
-                                                  fig->id,
-                                                  0,
-                                                  0);
+        fig->is_id_complex = regex_registry_match_simple("\\.|-|_",
+                                                         fig->id,
+                                                         0,
+                                                         0);
         figures = g_list_append(figures,
                                 fig);
         g_match_info_next(match_info,
@@ -234,14 +238,22 @@ GList *
 extract_figure_references (const char *text)
 {
     GList *referenced_figures = NULL;
-    GHashTable *id_hash = g_hash_table_new(g_str_hash,
-                                           g_str_equal);
+    /* label#id > ReferencedFigure */
+    GHashTable *id_hash = g_hash_table_new_full(g_str_hash,
+                                                g_str_equal,
+                                                g_free,
+                                                NULL);
     GMatchInfo *match_info = NULL;
     g_regex_match(figure_reference_regex,
                   text,
                   0,
                   &match_info);
     while(g_match_info_matches(match_info)){
+        int start, end;
+        g_match_info_fetch_pos(match_info,
+                               0,
+                               &start,
+                               &end);
         char *label = g_match_info_fetch_named(match_info,
                                                "label");
         char *id = g_match_info_fetch_named(match_info,
@@ -257,16 +269,21 @@ extract_figure_references (const char *text)
         char *key = g_strdup_printf("%s#%s",
                                     label,
                                     clean_id);
-        if(!g_hash_table_contains(id_hash,
-                                  key))
-        {
-            g_hash_table_add(id_hash,
-                             key);
-            ReferencedFigure *ref_figure = g_malloc(sizeof(ReferencedFigure));
+        ReferencedFigure *ref_figure = g_hash_table_lookup(id_hash,
+                                                           key);
+        if(!ref_figure){
+            ref_figure = g_malloc(sizeof(ReferencedFigure));
             ref_figure->label = label;
             ref_figure->id = clean_id;
+            ref_figure->match_offsets = g_array_new(FALSE,
+                                                    FALSE,
+                                                    sizeof(int));
             ref_figure->find_results = NULL;
+            ref_figure->activated_find_result = NULL;
             ref_figure->reference = NULL;
+            g_hash_table_insert(id_hash,
+                                key,
+                                ref_figure);
             referenced_figures = g_list_append(referenced_figures,
                                                ref_figure);
         }
@@ -275,20 +292,32 @@ extract_figure_references (const char *text)
             g_free(label);
             g_free(clean_id);
         }
+        g_array_append_val(ref_figure->match_offsets,
+                           start);
+        g_array_append_val(ref_figure->match_offsets,
+                           end);
         g_match_info_next(match_info,
                           NULL);
     }
     g_match_info_free(match_info);
-    GHashTableIter iter;
-    gpointer key, value;
-    g_hash_table_iter_init (&iter, id_hash);
-    while(g_hash_table_iter_next(&iter, &key, &value)){        
-        g_free((char*)key);
-    }
     g_hash_table_unref(id_hash);
     return referenced_figures;
 }
 
+void
+referenced_figure_free(ReferencedFigure *ref_figure)
+{
+    if(!ref_figure){
+        return;
+    }
+    g_free(ref_figure->label);
+    g_free(ref_figure->id);
+    g_array_unref(ref_figure->match_offsets);
+    g_list_free_full(ref_figure->find_results,
+                     (GDestroyNotify)find_result_free);
+    g_free(ref_figure);
+}
+
 gboolean
 are_figure_labels_equal(const char *l1,
                         const char *l2)
@@ -296,96 +325,197 @@ are_figure_labels_equal(const char *l1,
     if(!l1 && !l2){
         return TRUE;
     }
-    if((!l1 && g_regex_match_simple("fig(ure)?|pic(ture)?|image|img|photo|illustration",
-                                                           l2,
-                                                           G_REGEX_CASELESS,
-                                                           0)) ||
-       (!l2 && g_regex_match_simple("fig(ure)?|pic(ture)?|image|img|photo|illustration",
-                                                           l1,
-                                                           G_REGEX_CASELESS,
-                                                           0)))
+    if((!l1 && regex_registry_match_simple("fig(ure)?|pic(ture)?|image|img|photo|illustration",
+                                                                  l2,
+                                                                  G_REGEX_CASELESS,
+                                                                  0)) ||
+       (!l2 && regex_registry_match_simple("fig(ure)?|pic(ture)?|image|img|photo|illustration",
+                                                                  l1,
+                                                                  G_REGEX_CASELESS,
+                                                                  0)))
     {
         return TRUE;
     }
     if(!l1 || !l2){
         return FALSE;
     }
-    if(g_regex_match_simple("fig(ure)?",
-                            l1,
-                            G_REGEX_CASELESS,
-                            0) &&
-       g_regex_match_simple("fig(ure)?",
-                            l2,
-                            G_REGEX_CASELESS,
-                            0))
+    if(regex_registry_match_simple("fig(ure)?",
+                                   l1,
+                                   G_REGEX_CASELESS,
+                                   0) &&
+       regex_registry_match_simple("fig(ure)?",
+                                   l2,
+                                   G_REGEX_CASELESS,
+                                   0))
     {
         return TRUE;
     }
-    if(g_regex_match_simple("pic(ture)?",
-                            l1,
-                            G_REGEX_CASELESS,
-                            0) &&
-       g_regex_match_simple("pic(ture)?",
-                            l2,
-                            G_REGEX_CASELESS,
-                            0))
+    if(regex_registry_match_simple("pic(ture)?",
+                                   l1,
+                                   G_REGEX_CASELESS,
+                                   0) &&
+       regex_registry_match_simple("pic(ture)?",
+                                   l2,
+                                   G_REGEX_CASELESS,
+                                   0))
     {
         return TRUE;
     }
-    if(g_regex_match_simple("image|img",
-                            l1,
-                            G_REGEX_CASELESS,
-                            0) &&
-       g_regex_match_simple("image|img",
-                            l2,
-                            G_REGEX_CASELESS,
-                            0))
+    if(regex_registry_match_simple("image|img",
+                                   l1,
+                                   G_REGEX_CASELESS,
+                                   0) &&
+       regex_registry_match_simple("image|img",
+                                   l2,
+                                   G_REGEX_CASELESS,
+                                   0))
     {
         return TRUE;
     }
-    if(g_regex_match_simple("photo",
-                            l1,
-                            G_REGEX_CASELESS,
-                            0) &&
-       g_regex_match_simple("photo",
-                            l2,
-                            G_REGEX_CASELESS,
-                            0))
+    if(regex_registry_match_simple("photo",
+                                   l1,
+                                   G_REGEX_CASELESS,
+                                   0) &&
+       regex_registry_match_simple("photo",
+                                   l2,
+                                   G_REGEX_CASELESS,
+                                   0))
     {
         return TRUE;
     }
-    if(g_regex_match_simple("illustration",
-                            l1,
-                            G_REGEX_CASELESS,
-                            0) &&
-       g_regex_match_simple("illustration",
-                            l2,
-                            G_REGEX_CASELESS,
-                            0))
+    if(regex_registry_match_simple("illustration",
+                                   l1,
+                                   G_REGEX_CASELESS,
+                                   0) &&
+       regex_registry_match_simple("illustration",
+                                   l2,
+                                   G_REGEX_CASELESS,
+                                   0))
     {
         return TRUE;
     }
-    if(g_regex_match_simple("map",
-                            l1,
-                            G_REGEX_CASELESS,
-                            0) &&
-       g_regex_match_simple("map",
-                            l2,
-                            G_REGEX_CASELESS,
-                            0))
+    if(regex_registry_match_simple("map",
+                                   l1,
+                                   G_REGEX_CASELESS,
+                                   0) &&
+       regex_registry_match_simple("map",
+                                   l2,
+                                   G_REGEX_CASELESS,
+                                   0))
     {
         return TRUE;
     }
-    if(g_regex_match_simple("box",
-                            l1,
-                            G_REGEX_CASELESS,
-                            0) &&
-       g_regex_match_simple("box",
-                            l2,
-                            G_REGEX_CASELESS,
-                            0))
+    if(regex_registry_match_simple("box",
+                                   l1,
+                                   G_REGEX_CASELESS,
+                                   0) &&
+       regex_registry_match_simple("box",
+                                   l2,
+                                   G_REGEX_CASELESS,
+                                   0))
     {
         return TRUE;
     }
     return FALSE;    
 }
+
+static const char *
+figure_label_class(const char *label)
+{
+    /* 'Fig.' and 'Figure', 'img' and 'Image' name the same thing */
+    static const char *classes[][2] = {
+        {"fig", "figure"},
+        {"pic", "picture"},
+        {"im", "image"},
+        {"photo", "photo"},
+        {"map", "map"},
+        {"box", "box"},
+        {"illustration", "illustration"},
+        {NULL, NULL}
+    };
+    if(!label){
+        return "";
+    }
+    for(int i = 0; classes[i][0]; i++){
+        if(g_ascii_strncasecmp(label,
+                               classes[i][0],
+                               strlen(classes[i][0])) == 0)
+        {
+            return classes[i][1];
+        }
+    }
+    return NULL;
+}
+
+static char *
+make_figure_index_key(const char *label,
+                      const char *id)
+{
+    const char *label_class = figure_label_class(label);
+    if(label_class){
+        return g_strdup_printf("%s#%s",
+                               label_class,
+                               id);
+    }
+    char *lowered_label = g_ascii_strdown(label,
+                                          -1);
+    char *key = g_strdup_printf("%s#%s",
+                                lowered_label,
+                                id);
+    g_free(lowered_label);
+    return key;
+}
+
+GHashTable *
+figure_index_new(void)
+{
+    /* 'label class#id' > Figure, figures are not owned */
+    return g_hash_table_new_full(g_str_hash,
+                                 g_str_equal,
+                                 g_free,
+                                 NULL);
+}
+
+void
+figure_index_add(GHashTable *figure_index,
+                 Figure     *figure)
+{
+    /* the first figure to claim a label and id wins */
+    char *key = make_figure_index_key(figure->label,
+                                      figure->id);
+    if(g_hash_table_contains(figure_index,
+                             key))
+    {
+        g_free(key);
+        return;
+    }
+    g_hash_table_insert(figure_index,
+                        key,
+                        figure);
+}
+
+Figure *
+figure_index_lookup(GHashTable *figure_index,
+                    const char *label,
+                    const char *id)
+{
+    if(!figure_index || !id){
+        return NULL;
+    }
+    char *key = make_figure_index_key(label,
+                                      id);
+    Figure *figure = g_hash_table_lookup(figure_index,
+                                         key);
+    g_free(key);
+    /* unlabeled captions stand for any picture-like label */
+    if(!figure && are_figure_labels_equal(label,
+                                          NULL))
+    {
+        key = make_figure_index_key(NULL,
+                                    id);
+        figure = g_hash_table_lookup(figure_index,
+                                     key);
+        g_free(key);
+    }
+    return figure;
+}
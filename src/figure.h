@@ -40,6 +40,8 @@ struct Figure
     int page_num;
     int image_id; /* index given by poppler to images */
     Rect *image_physical_layout;
+    /* the layout spans several images or was grown to take them in */
+    gboolean is_image_merged;
 
     GList *captions;
 
@@ -51,6 +53,8 @@ struct ReferencedFigure
 {
     char *label;
     char *id;
+    /* start/end byte offsets of every mention in the text, pairwise */
+    GArray *match_offsets;
     GList *find_results;
     GList *activated_find_result;
     Figure *reference;
@@ -77,8 +81,23 @@ extract_figure_captions (const char *);
 GList * 
 extract_figure_references (const char *);
 
+void
+referenced_figure_free(ReferencedFigure *ref_figure);
+
 gboolean
 are_figure_labels_equal(const char *l1,
                         const char *l2);
 
+GHashTable *
+figure_index_new(void);
+
+void
+figure_index_add(GHashTable *figure_index,
+                 Figure     *figure);
+
+Figure *
+figure_index_lookup(GHashTable *figure_index,
+                    const char *label,
+                    const char *id);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,258 @@
+/*
+ * Copyright © 2020 Reza Hasanzadeh
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 3.0 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "figure_gallery.h"
+#include "thumbnail_grid.h"
+#include <poppler/glib/poppler.h>
+
+#define THUMBNAIL_SIZE 160
+#define CELL_PADDING 12
+#define LABEL_HEIGHT 20
+
+typedef struct
+{
+    int page_num;
+    int image_id;
+    gboolean is_image_merged;
+    Rect image_layout;
+}ThumbnailJob;
+
+/* figures of the loaded document in reading order, not owned */
+static GPtrArray *figures = NULL;
+static ThumbnailGrid grid;
+
+static gpointer
+thumbnail_job_new(int    index,
+                  char **cache_name)
+{
+    const Figure *figure = g_ptr_array_index(figures,
+                                             index);
+    ThumbnailJob *job = g_malloc(sizeof(ThumbnailJob));
+    job->page_num = figure->page_num;
+    job->image_id = figure->image_id;
+    job->is_image_merged = figure->is_image_merged;
+    job->image_layout = *figure->image_physical_layout;
+    *cache_name = g_strdup_printf("%d-%d",
+                                  figure->page_num,
+                                  figure->image_id);
+    return job;
+}
+
+static cairo_surface_t *
+render_thumbnail(PopplerDocument *document,
+                 gpointer         data)
+{
+    /* worker thread */
+    const ThumbnailJob *job = data;
+    PopplerPage *page = poppler_document_get_page(document,
+                                                  job->page_num);
+    if(!page){
+        return NULL;
+    }
+    double layout_width = rect_width((Rect *)&job->image_layout),
+           layout_height = rect_height((Rect *)&job->image_layout);
+    if(layout_width <= 0 || layout_height <= 0){
+        g_object_unref(page);
+        return NULL;
+    }
+    double scale = THUMBNAIL_SIZE / MAX(layout_width, layout_height);
+    int width = MAX(1, layout_width * scale),
+        height = MAX(1, layout_height * scale);
+    cairo_surface_t *thumbnail = cairo_image_surface_create(CAIRO_FORMAT_ARGB32,
+                                                            width,
+                                                            height);
+    cairo_t *cr = cairo_create(thumbnail);
+    cairo_surface_t *embedded_image = job->is_image_merged ? NULL
+                                                           : poppler_page_get_image(page,
+                                                                                    job->image_id);
+    if(embedded_image){
+        cairo_scale(cr,
+                    width / (double)cairo_image_surface_get_width(embedded_image),
+                    height / (double)cairo_image_surface_get_height(embedded_image));
+        cairo_set_source_surface(cr,
+                                 embedded_image,
+                                 0, 0);
+        cairo_pattern_set_filter(cairo_get_source(cr),
+                                 CAIRO_FILTER_GOOD);
+        cairo_paint(cr);
+        cairo_surface_destroy(embedded_image);
+    }
+    else{
+        /* vector and merged figures: render only their part of the page */
+        cairo_set_source_rgb(cr,
+                             1, 1, 1);
+        cairo_paint(cr);
+        cairo_scale(cr,
+                    scale,
+                    scale);
+        cairo_translate(cr,
+                        -job->image_layout.x1,
+                        -job->image_layout.y1);
+        poppler_page_render(page,
+                            cr);
+    }
+    cairo_destroy(cr);
+    g_object_unref(page);
+    return thumbnail;
+}
+
+static void
+draw_cell(cairo_t         *cr,
+          int              index,
+          double           cell_x,
+          double           cell_y,
+          cairo_surface_t *thumbnail)
+{
+    const Figure *figure = g_ptr_array_index(figures,
+                                             index);
+    double box_x = cell_x + CELL_PADDING,
+           box_y = cell_y + CELL_PADDING;
+    if(thumbnail){
+        int thumbnail_width = cairo_image_surface_get_width(thumbnail),
+            thumbnail_height = cairo_image_surface_get_height(thumbnail);
+        double x = box_x + (THUMBNAIL_SIZE - thumbnail_width) / 2.0,
+               y = box_y + (THUMBNAIL_SIZE - thumbnail_height) / 2.0;
+        cairo_set_source_surface(cr,
+                                 thumbnail,
+                                 x, y);
+        cairo_rectangle(cr,
+                        x, y,
+                        thumbnail_width, thumbnail_height);
+        cairo_fill(cr);
+    }
+    else{
+        /* placeholder */
+        cairo_rectangle(cr,
+                        box_x, box_y,
+                        THUMBNAIL_SIZE, THUMBNAIL_SIZE);
+        cairo_set_source_rgb(cr,
+                             0.7529, 0.7529, 0.7529);
+        cairo_fill(cr);
+    }
+    char *markup = g_markup_printf_escaped("<span font='sans 9' foreground='#222222'>%s %s - p. %d</span>",
+                                           figure->label ? figure->label : "Figure",
+                                           figure->id,
+                                           figure->page_num + 1);
+    thumbnail_grid_draw_label(cr,
+                              markup,
+                              cell_x,
+                              box_y + THUMBNAIL_SIZE + 4,
+                              THUMBNAIL_SIZE + 2 * CELL_PADDING);
+    g_free(markup);
+}
+
+static const ThumbnailGridMode gallery_mode = {
+    "thumbnails",
+    THUMBNAIL_SIZE,
+    CELL_PADDING,
+    LABEL_HEIGHT,
+    thumbnail_job_new,
+    g_free,
+    render_thumbnail,
+    draw_cell
+};
+
+void
+figure_gallery_module_init(GtkWidget *widget)
+{
+    thumbnail_grid_init(&grid,
+                        widget,
+                        &gallery_mode);
+}
+
+void
+figure_gallery_module_destroy(void)
+{
+    figure_gallery_unload();
+    thumbnail_grid_destroy(&grid);
+}
+
+void
+figure_gallery_load(const char *filename,
+                    GPtrArray  *document_figures)
+{
+    /* takes ownership of document_figures, not of the figures */
+    figure_gallery_unload();
+    figures = document_figures;
+    thumbnail_grid_load(&grid,
+                        filename,
+                        figures ? figures->len : 0);
+}
+
+void
+figure_gallery_unload(void)
+{
+    thumbnail_grid_unload(&grid);
+    if(figures){
+        g_ptr_array_unref(figures);
+        figures = NULL;
+    }
+}
+
+void
+figure_gallery_draw(cairo_t *cr,
+                    double   width,
+                    double   height)
+{
+    if(!figures || figures->len == 0){
+        thumbnail_grid_draw_label(cr,
+                                  "<span font='sans 18' foreground='#222222'>No figures were found in this book.</span>",
+                                  0, height / 2,
+                                  width);
+        return;
+    }
+    thumbnail_grid_draw(&grid,
+                        cr,
+                        width,
+                        height);
+}
+
+void
+figure_gallery_scroll(double dy)
+{
+    thumbnail_grid_scroll(&grid,
+                          dy);
+}
+
+void
+figure_gallery_scroll_to_top(void)
+{
+    thumbnail_grid_scroll_to(&grid,
+                             0);
+}
+
+void
+figure_gallery_set_cache_limit(int max_thumbnails)
+{
+    thumbnail_grid_set_cache_limit(&grid,
+                                   max_thumbnails);
+}
+
+Figure *
+figure_gallery_hover(double x,
+                     double y)
+{
+    /* figure under (x, y) as of the last draw, NULL if none */
+    int index = thumbnail_grid_hover(&grid,
+                                     x,
+                                     y);
+    if(index < 0){
+        return NULL;
+    }
+    return g_ptr_array_index(figures,
+                             index);
+}
@@ -0,0 +1,55 @@
+/*
+ * Copyright © 2020 Reza Hasanzadeh
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 3.0 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef FIGURE_GALLERY_H
+#define FIGURE_GALLERY_H
+
+#include <gtk/gtk.h>
+#include "figure.h"
+
+void
+figure_gallery_module_init(GtkWidget *widget);
+
+void
+figure_gallery_module_destroy(void);
+
+void
+figure_gallery_load(const char *filename,
+                    GPtrArray  *figures);
+
+void
+figure_gallery_unload(void);
+
+void
+figure_gallery_draw(cairo_t *cr,
+                    double   width,
+                    double   height);
+
+void
+figure_gallery_scroll(double dy);
+
+void
+figure_gallery_scroll_to_top(void);
+
+void
+figure_gallery_set_cache_limit(int max_thumbnails);
+
+Figure *
+figure_gallery_hover(double x,
+                     double y);
+
+#endif
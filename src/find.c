@@ -16,6 +16,8 @@
  */
 
 #include "find.h"
+#include "regex_registry.h"
+#include "page_store.h"
 #include <math.h>
 
 FindResult *
@@ -23,7 +25,7 @@ find_result_new()
 {
     FindResult *fr = g_malloc(sizeof(FindResult));
     fr->page_num = -1;
-    fr->physical_layouts = NULL;
+    fr->physical_layouts = g_ptr_array_new_with_free_func((GDestroyNotify)rect_free);
     fr->match = NULL;
     fr->page_prefix = NULL;
     fr->page_postfix = NULL;
@@ -38,12 +40,7 @@ find_result_free(FindResult *fr)
     if(!fr){
         return;
     }
-    GList *list_p = fr->physical_layouts;
-    while(list_p){
-        rect_free(list_p->data);
-        list_p = list_p->next;
-    }
-    g_list_free(fr->physical_layouts);
+    g_ptr_array_unref(fr->physical_layouts);
     g_free(fr->match);
     g_free(fr->tip);
     g_free(fr);
@@ -79,8 +76,10 @@ compare_find_results(const void *a,
     const FindResult *fr_b = b;
     int comp = fr_a->page_num - fr_b->page_num;
     if(comp == 0){
-        const Rect *rect_a = fr_a->physical_layouts->data;
-        const Rect *rect_b = fr_b->physical_layouts->data;
+        const Rect *rect_a = g_ptr_array_index(fr_a->physical_layouts,
+                                               0);
+        const Rect *rect_b = g_ptr_array_index(fr_b->physical_layouts,
+                                               0);
         /* asc y, asc  x */
         if((rect_a->y1 < rect_b->y1) ||
            (rect_a->y1 == rect_b->y1 &&
@@ -95,6 +94,56 @@ compare_find_results(const void *a,
     return comp;    
 }
 
+FindResult *
+find_result_from_text_range(const PageMeta *meta,
+                            int             start,
+                            int             end)
+{
+    /*
+       build a result out of the character layouts of meta->text[start, end),
+       byte offsets, one rect per line. there is one layout per character of
+       the text, so no search is needed.
+    */
+    if(!meta->text || meta->num_layouts == 0 || start >= end){
+        return NULL;
+    }
+    FindResult *fr = find_result_new();
+    fr->page_num = meta->page_num;
+    fr->match = g_strndup(meta->text + start,
+                          end - start);
+    Rect *line_rect = NULL;
+    const char *p = meta->text + start;
+    long char_index = g_utf8_pointer_to_offset(meta->text,
+                                               p);
+    while(p < meta->text + end && char_index < meta->num_layouts){
+        gunichar c = g_utf8_get_char(p);
+        if(!g_unichar_isspace(c)){
+            Rect layout = text_layout_get(meta->text_layout,
+                                          char_index);
+            if(line_rect &&
+               fabs(rect_center_y(&layout) - rect_center_y(line_rect)) < meta->mean_line_height * 0.5)
+            {
+                line_rect->x1 = MIN(line_rect->x1, layout.x1);
+                line_rect->y1 = MIN(line_rect->y1, layout.y1);
+                line_rect->x2 = MAX(line_rect->x2, layout.x2);
+                line_rect->y2 = MAX(line_rect->y2, layout.y2);
+            }
+            else{
+                line_rect = rect_copy(&layout);
+                g_ptr_array_add(fr->physical_layouts,
+                                line_rect);
+            }
+        }
+        p = g_utf8_next_char(p);
+        char_index++;
+    }
+    if(fr->physical_layouts->len == 0){
+        find_result_free(fr);
+        return NULL;
+    }
+    return fr;
+}
+
 static void
 match_found_rects(GList  *list_p,
                   Rect   *prev_rect,
@@ -159,10 +208,10 @@ find_rects_of_text(PopplerDocument *document,
     while(g_match_info_matches(match_info)){
         char *match = g_match_info_fetch(match_info,
                                          0);
-        char **tokens = g_regex_split_simple("\\R",
-                                             match,
-                                             0,
-                                             0);
+        char **tokens = regex_registry_split_simple("\\R",
+                                                    match,
+                                                    0,
+                                                    0);
         int num_tokens = g_strv_length(tokens);
         /* a: flatten match */
         if(!is_flattend){
@@ -181,39 +230,22 @@ find_rects_of_text(PopplerDocument *document,
                 double rect_cy = rect_center_y(rect);
                 if(is_dualpage){
                     gboolean is_valid = TRUE;
-                    /* prefix: rect must be rightmost */
-                    if(pattern[0] != '^'){
-                        for(int i = 0; i < meta->num_layouts; i++){
-                            Rect *text_rect = g_ptr_array_index(meta->physical_text_layouts,
-                                                                i);
-                            double text_cy = rect_center_y(text_rect);
-                            if(fabs(text_cy - rect_cy) < (meta->mean_line_height * 0.05) &&
-                               text_rect->x1 >= rect->x2)
-                            {
-                                is_valid = FALSE;
-                                break;
-                            }
-                            if(text_cy - rect_cy > 2 * meta->mean_line_height){
-                                break;
-                            }
-                        }                        
-                    }
-                    /* postfix: rect must be leftmost */
-                    else{
-                        for(int i = 0; i < meta->num_layouts; i++){
-                            Rect *text_rect = g_ptr_array_index(meta->physical_text_layouts,
-                                                                i);
-                            double text_cy = rect_center_y(text_rect);
-                            if(fabs(text_cy - rect_cy) < (meta->mean_line_height * 0.05) &&
-                               text_rect->x1 < rect->x1)
-                            {
-                                is_valid = FALSE;
-                                break;
-                            }
-                            if(text_cy - rect_cy > 2 * meta->mean_line_height){
-                                break;
-                            }
-                        } 
+                    double line_min_x1, line_max_x1;
+                    if(meta->text_layout &&
+                       text_layout_line_extent(meta->text_layout,
+                                               rect_cy,
+                                               meta->mean_line_height * 0.05,
+                                               &line_min_x1,
+                                               &line_max_x1))
+                    {
+                        /* prefix: rect must be rightmost */
+                        if(pattern[0] != '^'){
+                            is_valid = line_max_x1 < rect->x2;
+                        }
+                        /* postfix: rect must be leftmost */
+                        else{
+                            is_valid = line_min_x1 >= rect->x1;
+                        }
                     }
                     if(!is_valid){
                         rect_free(rect);
@@ -224,8 +256,8 @@ find_rects_of_text(PopplerDocument *document,
                 FindResult *find_result = find_result_new();
                 find_result->page_num = meta->page_num;
                 find_result->match = g_strdup(flattened_match);
-                find_result->physical_layouts = g_list_append(find_result->physical_layouts,
-                                                              rect);
+                g_ptr_array_add(find_result->physical_layouts,
+                                rect);
                 *find_results = g_list_append(*find_results,
                                               find_result);
                 already_matched_rects = g_list_append(already_matched_rects,
@@ -407,21 +439,16 @@ find_rects_of_text(PopplerDocument *document,
                 double rect_cy = rect_center_y(rect);                   
                 /* make sure the first rect is right-most except for multipage postfix rects */
                 gboolean is_rightmost = TRUE;
-                if((num_tokens > 1) && !(is_dualpage && pattern[0] == '^')){
-                    for(int i = 0; i < meta->num_layouts; i++){
-                        Rect *text_rect = g_ptr_array_index(meta->physical_text_layouts,
-                                                            i);
-                        double text_cy = rect_center_y(text_rect);
-                        if(fabs(text_cy - rect_cy) < (meta->mean_line_height * 0.05) &&
-                           text_rect->x1 >= rect->x2)
-                        {
-                            is_rightmost = FALSE;
-                            break;
-                        }
-                        if(text_cy - rect_cy > 2 * meta->mean_line_height){
-                            break;
-                        }
-                    }
+                double line_min_x1, line_max_x1;
+                if((num_tokens > 1) && !(is_dualpage && pattern[0] == '^') &&
+                   meta->text_layout &&
+                   text_layout_line_extent(meta->text_layout,
+                                           rect_cy,
+                                           meta->mean_line_height * 0.05,
+                                           &line_min_x1,
+                                           &line_max_x1))
+                {
+                    is_rightmost = line_max_x1 < rect->x2;
                 }           
                 if(!is_rightmost){
                     rect_p = rect_p->next;
@@ -441,8 +468,8 @@ find_rects_of_text(PopplerDocument *document,
                     GList *ma_rect_p = matched_rects;        
                     while(ma_rect_p){
                         Rect *fr_rect = ma_rect_p->data;
-                        find_result->physical_layouts = g_list_append(find_result->physical_layouts,
-                                                                      rect_copy(fr_rect));
+                        g_ptr_array_add(find_result->physical_layouts,
+                                        rect_copy(fr_rect));
                         ma_rect_p = ma_rect_p->next;
                     }       
                     *find_results = g_list_append(*find_results,
@@ -504,7 +531,7 @@ find_text(PopplerDocument *document,
         return NULL;
     }   
     GError *err = NULL;  
-    GRegex *nl_ws_regex = g_regex_new(
+    GRegex *nl_ws_regex = regex_registry_lookup(
         "\\s+|\\R+",
         0, 0,
         &err);
@@ -519,7 +546,7 @@ find_text(PopplerDocument *document,
                                           " ",
                                           0,
                                           NULL);
-    GRegex *trimmer_regex = g_regex_new(
+    GRegex *trimmer_regex = regex_registry_lookup(
         "^\\s+|\\s+$",
         0,
         0,
@@ -538,9 +565,9 @@ find_text(PopplerDocument *document,
     g_free(no_nl_ws_term);
     g_regex_unref(nl_ws_regex);
     g_regex_unref(trimmer_regex);
-    gboolean term_has_whitespace = g_regex_match_simple("\\s",
-                                                        cleaned_term,
-                                                        0, 0);
+    gboolean term_has_whitespace = regex_registry_match_simple("\\s",
+                                                               cleaned_term,
+                                                               0, 0);
     char *temp = cleaned_term;
     cleaned_term = g_regex_escape_string(temp,
                                          -1);
@@ -566,7 +593,7 @@ find_text(PopplerDocument *document,
             }
         }        
     }       
-    GRegex *whitespace_regex = g_regex_new(
+    GRegex *whitespace_regex = regex_registry_lookup(
         "\\s+",
         0,
         0,
@@ -597,11 +624,11 @@ find_text(PopplerDocument *document,
         g_free(temp);
     }
     err = NULL;
-    GRegex *multiline_regex = g_regex_new(
-        pattern,
-        G_REGEX_CASELESS,
-        0,
-        &err);
+    /* built from the term, compiled here rather than kept in the registry */
+    GRegex *multiline_regex = g_regex_new(pattern,
+                                          G_REGEX_CASELESS | G_REGEX_OPTIMIZE,
+                                          0,
+                                          &err);
     if(!multiline_regex){
         g_print("multiline_regex error.\ndomain:  %d, \ncode: %d, \nmessage: %s\n",
                 err->domain, err->code, err->message);
@@ -618,6 +645,7 @@ find_text(PopplerDocument *document,
               if 'adios pegasus camus' is requested, we try to find
               {'adios\npegasus camus', 'adios\npegasus\ncamus', 'adios pegasus\ncamus'}
         */  
+        page_store_acquire(meta);
         if(strlen(meta->text) >= term_len){
             GList *results = NULL;
             find_rects_of_text(document,
@@ -629,6 +657,7 @@ find_text(PopplerDocument *document,
             find_results = g_list_concat(find_results,
                                          results);
         }
+        page_store_release(meta);
     } 
     g_regex_unref(multiline_regex);
     g_free(pattern);    
@@ -636,12 +665,12 @@ find_text(PopplerDocument *document,
         g_free(cleaned_term);
         return find_results;
     } 
-    GList *multipage_prefix_regex_list = NULL;
-    GList *multipage_postfix_regex_list = NULL;
-    char **tokens = g_regex_split_simple("\\s+",
-                                         cleaned_term,
-                                         0,
-                                         0);
+    GPtrArray *multipage_prefix_regexes = g_ptr_array_new_with_free_func((GDestroyNotify)g_regex_unref);
+    GPtrArray *multipage_postfix_regexes = g_ptr_array_new_with_free_func((GDestroyNotify)g_regex_unref);
+    char **tokens = regex_registry_split_simple("\\s+",
+                                                cleaned_term,
+                                                0,
+                                                0);
     int num_tokens = g_strv_length(tokens);
     for(int i = 0; i < num_tokens - 1; i++){
         GString *prefix_pattern = g_string_new("");
@@ -660,17 +689,16 @@ find_text(PopplerDocument *document,
         prefix_pattern = g_string_append(prefix_pattern,
                                          "$");
         err = NULL;
-        GRegex *prefix_regex = g_regex_new(
-            prefix_pattern->str,
-            G_REGEX_CASELESS | G_REGEX_MULTILINE,
-            0,
-            &err);
+        GRegex *prefix_regex = g_regex_new(prefix_pattern->str,
+                                           G_REGEX_CASELESS | G_REGEX_MULTILINE | G_REGEX_OPTIMIZE,
+                                           0,
+                                           &err);
         if(!prefix_regex){
             g_print("prefix_regex error.\ndomain:  %d, \ncode: %d, \nmessage: %s\n",
                     err->domain, err->code, err->message);
         }    
-        multipage_prefix_regex_list = g_list_append(multipage_prefix_regex_list,
-                                                    prefix_regex);
+        g_ptr_array_add(multipage_prefix_regexes,
+                        prefix_regex);
         g_string_free(prefix_pattern,
                       FALSE);  
 
@@ -688,21 +716,20 @@ find_text(PopplerDocument *document,
                                               "\\b");
         }
         err = NULL;
-        GRegex *postfix_regex = g_regex_new(
-            postfix_pattern->str,
-            G_REGEX_CASELESS | G_REGEX_MULTILINE,
-            0,
-            &err);
+        GRegex *postfix_regex = g_regex_new(postfix_pattern->str,
+                                            G_REGEX_CASELESS | G_REGEX_MULTILINE | G_REGEX_OPTIMIZE,
+                                            0,
+                                            &err);
         if(!postfix_regex){
             g_print("postfix_regex error.\ndomain:  %d, \ncode: %d, \nmessage: %s\n",
                     err->domain, err->code, err->message);
         }
-        multipage_postfix_regex_list = g_list_append(multipage_postfix_regex_list,
-                                                     postfix_regex);
+        g_ptr_array_add(multipage_postfix_regexes,
+                        postfix_regex);
         g_string_free(postfix_pattern,
                       FALSE);
     }   
-    if(g_list_length(multipage_prefix_regex_list) != g_list_length(multipage_postfix_regex_list)){
+    if(multipage_prefix_regexes->len != multipage_postfix_regexes->len){
         g_print("the number of prefix and postfix regexes are not the same.\n");
     }
     /* 3: multipage search. a page might end with some terms and the next page begin with the 
@@ -710,15 +737,18 @@ find_text(PopplerDocument *document,
           if 'adios pegasus camus' is requested, we try to find the first set of terms in the
           current page and the rest of the terms in the next page.
     */
-    int multipage_regex_num = g_list_length(multipage_prefix_regex_list);
+    int multipage_regex_num = MIN(multipage_prefix_regexes->len,
+                                  multipage_postfix_regexes->len);
     for(int page_num = start_page; page_num < start_page + pages_length - 1; page_num++){
         PageMeta *meta_prefix = g_ptr_array_index(metae,
                                                   page_num);
         PageMeta *meta_postfix = g_ptr_array_index(metae,
                                                    page_num + 1);
+        page_store_acquire(meta_prefix);
+        page_store_acquire(meta_postfix);
         for(int i = 0; i < multipage_regex_num; i++){
-            GRegex *prefix_regex = g_list_nth_data(multipage_prefix_regex_list,
-                                                   i);
+            GRegex *prefix_regex = g_ptr_array_index(multipage_prefix_regexes,
+                                                     i);
             GList *find_results_prefix = NULL;       
             find_rects_of_text(document,
                                meta_prefix,
@@ -733,8 +763,8 @@ find_text(PopplerDocument *document,
                 while(already_p){
                     FindResult *fr_already = already_p->data;
                     if((fr_already->page_num == meta_prefix->page_num) &&
-                       rect_lists_intersect(fr_already->physical_layouts,
-                                            find_result_prefix->physical_layouts))
+                       rect_arrays_intersect(fr_already->physical_layouts,
+                                             find_result_prefix->physical_layouts))
                     {
                         break;
                     }
@@ -746,8 +776,8 @@ find_text(PopplerDocument *document,
                     continue;
                 }            
 
-                GRegex *postfix_regex = g_list_nth_data(multipage_postfix_regex_list,
-                                                        i);
+                GRegex *postfix_regex = g_ptr_array_index(multipage_postfix_regexes,
+                                                          i);
                 GList *find_results_postfix = NULL;
                 find_rects_of_text(document,
                                    meta_postfix,
@@ -762,8 +792,8 @@ find_text(PopplerDocument *document,
                     while(already_p){
                         FindResult *fr_already = already_p->data;
                         if((fr_already->page_num == meta_postfix->page_num) &&
-                           rect_lists_intersect(fr_already->physical_layouts,
-                                                find_result_postfix->physical_layouts))
+                           rect_arrays_intersect(fr_already->physical_layouts,
+                                                 find_result_postfix->physical_layouts))
                         {
                             break;
                         }
@@ -794,19 +824,11 @@ find_text(PopplerDocument *document,
                 }
             }
         }
+        page_store_release(meta_prefix);
+        page_store_release(meta_postfix);
     }
-    GList *list_p = multipage_prefix_regex_list;
-    while(list_p){
-        g_regex_unref(list_p->data);
-        list_p = list_p->next;
-    }
-    g_list_free(multipage_prefix_regex_list);
-    list_p = multipage_postfix_regex_list;
-    while(list_p){
-        g_regex_unref(list_p->data);
-        list_p = list_p->next;
-    }
-    g_list_free(multipage_postfix_regex_list);
+    g_ptr_array_unref(multipage_prefix_regexes);
+    g_ptr_array_unref(multipage_postfix_regexes);
     g_free(cleaned_term);        
     return find_results;
 }
@@ -26,7 +26,7 @@ struct FindResult
 {
     int page_num;
     char *match;  
-    GList *physical_layouts;
+    GPtrArray *physical_layouts; /* Rect, owned */
     FindResult *page_prefix;
     FindResult *page_postfix;
     double certainty;
@@ -50,6 +50,11 @@ compare_poppler_rects(const void *a,
 int
 compare_find_results(const void *a,
                      const void *b);
+FindResult *
+find_result_from_text_range(const PageMeta *meta,
+                            int             start,
+                            int             end);
+
 GList *
 find_text(PopplerDocument *document,
           const GPtrArray *metae,
@@ -0,0 +1,142 @@
+/*
+ * Copyright © 2020 Reza Hasanzadeh
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 3.0 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "memory_pressure.h"
+
+/*
+   the system only warns when memory runs low, it never says when things are
+   fine again. the level steps down by one after a quiet interval.
+*/
+
+#define RELAX_INTERVAL_SECONDS 30
+
+#if GLIB_CHECK_VERSION(2, 64, 0)
+static GMemoryMonitor *monitor = NULL;
+#endif
+static MemoryPressureFunc pressure_func = NULL;
+static enum MemoryPressure level = MemoryPressureNone;
+static guint relax_source_id = 0;
+
+static void
+set_level(enum MemoryPressure new_level);
+
+static gboolean
+relax(gpointer data)
+{
+    relax_source_id = 0;
+    if(level > MemoryPressureNone){
+        set_level(level - 1);
+    }
+    return G_SOURCE_REMOVE;
+}
+
+static void
+set_level(enum MemoryPressure new_level)
+{
+    if(relax_source_id){
+        g_source_remove(relax_source_id);
+        relax_source_id = 0;
+    }
+    if(new_level > MemoryPressureNone){
+        relax_source_id = g_timeout_add_seconds(RELAX_INTERVAL_SECONDS,
+                                                relax,
+                                                NULL);
+    }
+    level = new_level;
+    if(pressure_func){
+        pressure_func(level);
+    }
+}
+
+#if GLIB_CHECK_VERSION(2, 64, 0)
+static void
+on_low_memory_warning(GMemoryMonitor            *memory_monitor,
+                      GMemoryMonitorWarningLevel warning_level,
+                      gpointer                   user_data)
+{
+    enum MemoryPressure new_level = MemoryPressureLow;
+    if(warning_level >= G_MEMORY_MONITOR_WARNING_LEVEL_CRITICAL){
+        new_level = MemoryPressureCritical;
+    }
+    else if(warning_level >= G_MEMORY_MONITOR_WARNING_LEVEL_MEDIUM){
+        new_level = MemoryPressureMedium;
+    }
+    /* a milder warning doesn't undo a severe one, it only keeps it going */
+    set_level(MAX(new_level, level));
+}
+#endif
+
+void
+memory_pressure_module_init(MemoryPressureFunc func)
+{
+    pressure_func = func;
+#if GLIB_CHECK_VERSION(2, 64, 0)
+    monitor = g_memory_monitor_dup_default();
+    if(monitor){
+        g_signal_connect(monitor, "low-memory-warning",
+                         G_CALLBACK(on_low_memory_warning), NULL);
+    }
+#endif
+}
+
+void
+memory_pressure_module_destroy(void)
+{
+#if GLIB_CHECK_VERSION(2, 64, 0)
+    if(monitor){
+        g_signal_handlers_disconnect_by_func(monitor,
+                                             on_low_memory_warning,
+                                             NULL);
+        g_object_unref(monitor);
+        monitor = NULL;
+    }
+#endif
+    if(relax_source_id){
+        g_source_remove(relax_source_id);
+        relax_source_id = 0;
+    }
+    pressure_func = NULL;
+    level = MemoryPressureNone;
+}
+
+enum MemoryPressure
+memory_pressure_get_level(void)
+{
+    return level;
+}
+
+void
+memory_pressure_simulate(enum MemoryPressure new_level)
+{
+    /* behaves like a warning from the system, relaxing included */
+    set_level(CLAMP(new_level, MemoryPressureNone, MemoryPressureCritical));
+}
+
+const char *
+memory_pressure_to_string(enum MemoryPressure pressure)
+{
+    switch(pressure){
+    case MemoryPressureLow:
+        return "low";
+    case MemoryPressureMedium:
+        return "medium";
+    case MemoryPressureCritical:
+        return "critical";
+    default:
+        return "none";
+    }
+}
@@ -0,0 +1,48 @@
+/*
+ * Copyright © 2020 Reza Hasanzadeh
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 3.0 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef MEMORY_PRESSURE_H
+#define MEMORY_PRESSURE_H
+
+#include <gio/gio.h>
+
+enum MemoryPressure
+{
+    MemoryPressureNone = 0,
+    MemoryPressureLow,
+    MemoryPressureMedium,
+    MemoryPressureCritical
+};
+
+typedef void (*MemoryPressureFunc)(enum MemoryPressure level);
+
+void
+memory_pressure_module_init(MemoryPressureFunc func);
+
+void
+memory_pressure_module_destroy(void);
+
+enum MemoryPressure
+memory_pressure_get_level(void);
+
+void
+memory_pressure_simulate(enum MemoryPressure new_level);
+
+const char *
+memory_pressure_to_string(enum MemoryPressure pressure);
+
+#endif
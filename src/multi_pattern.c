@@ -0,0 +1,235 @@
+/*
+ * Copyright © 2020 Reza Hasanzadeh
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 3.0 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "multi_pattern.h"
+#include <string.h>
+
+/*
+   an aho-corasick automaton over bytes: all patterns are found in a single
+   pass over the text. edges are kept as child/sibling lists since pattern
+   sets here are small and sparse.
+*/
+
+typedef struct
+{
+    int first_child;
+    int next_sibling;
+    int fail;
+    int dict_link; /* nearest node on the fail chain that ends a pattern */
+    int first_pattern; /* patterns ending at this node */
+    int depth;
+    guchar byte;
+}MultiPatternNode;
+
+typedef struct
+{
+    gpointer data;
+    int next_pattern;
+}MultiPatternEntry;
+
+struct MultiPattern
+{
+    GArray *nodes;
+    GArray *patterns;
+    gboolean is_compiled;
+};
+
+static int
+node_new(MultiPattern *mp,
+         guchar        byte,
+         int           depth)
+{
+    MultiPatternNode node = {-1, -1, 0, -1, -1, depth, byte};
+    g_array_append_val(mp->nodes,
+                       node);
+    return mp->nodes->len - 1;
+}
+
+static int
+node_child(MultiPattern *mp,
+           int           node_index,
+           guchar        byte)
+{
+    int child = g_array_index(mp->nodes, MultiPatternNode, node_index).first_child;
+    while(child >= 0){
+        MultiPatternNode *node = &g_array_index(mp->nodes, MultiPatternNode, child);
+        if(node->byte == byte){
+            return child;
+        }
+        child = node->next_sibling;
+    }
+    return -1;
+}
+
+MultiPattern *
+multi_pattern_new(void)
+{
+    MultiPattern *mp = g_malloc(sizeof(MultiPattern));
+    mp->nodes = g_array_new(FALSE,
+                            FALSE,
+                            sizeof(MultiPatternNode));
+    mp->patterns = g_array_new(FALSE,
+                               FALSE,
+                               sizeof(MultiPatternEntry));
+    mp->is_compiled = FALSE;
+    /* root */
+    node_new(mp,
+             0,
+             0);
+    return mp;
+}
+
+void
+multi_pattern_free(MultiPattern *mp)
+{
+    if(!mp){
+        return;
+    }
+    g_array_free(mp->nodes,
+                 TRUE);
+    g_array_free(mp->patterns,
+                 TRUE);
+    g_free(mp);
+}
+
+void
+multi_pattern_add(MultiPattern *mp,
+                  const char   *pattern,
+                  int           length,
+                  gpointer      pattern_data)
+{
+    if(!pattern){
+        return;
+    }
+    if(length < 0){
+        length = strlen(pattern);
+    }
+    if(length == 0){
+        return;
+    }
+    int node_index = 0;
+    for(int i = 0; i < length; i++){
+        guchar byte = pattern[i];
+        int child = node_child(mp,
+                               node_index,
+                               byte);
+        if(child < 0){
+            child = node_new(mp,
+                             byte,
+                             i + 1);
+            /* node_new() may move the array, so look the parent up again */
+            MultiPatternNode *parent = &g_array_index(mp->nodes, MultiPatternNode, node_index);
+            g_array_index(mp->nodes, MultiPatternNode, child).next_sibling = parent->first_child;
+            parent->first_child = child;
+        }
+        node_index = child;
+    }
+    MultiPatternNode *node = &g_array_index(mp->nodes, MultiPatternNode, node_index);
+    MultiPatternEntry entry = {pattern_data, node->first_pattern};
+    g_array_append_val(mp->patterns,
+                       entry);
+    node->first_pattern = mp->patterns->len - 1;
+    mp->is_compiled = FALSE;
+}
+
+void
+multi_pattern_compile(MultiPattern *mp)
+{
+    /* breadth-first, so fail links always point to finished nodes */
+    int *queue = g_new(int, mp->nodes->len);
+    int head = 0, tail = 0;
+    int child = g_array_index(mp->nodes, MultiPatternNode, 0).first_child;
+    while(child >= 0){
+        MultiPatternNode *node = &g_array_index(mp->nodes, MultiPatternNode, child);
+        node->fail = 0;
+        node->dict_link = -1;
+        queue[tail++] = child;
+        child = node->next_sibling;
+    }
+    while(head < tail){
+        int parent_index = queue[head++];
+        child = g_array_index(mp->nodes, MultiPatternNode, parent_index).first_child;
+        while(child >= 0){
+            MultiPatternNode *node = &g_array_index(mp->nodes, MultiPatternNode, child);
+            int fail = g_array_index(mp->nodes, MultiPatternNode, parent_index).fail;
+            int target = node_child(mp,
+                                    fail,
+                                    node->byte);
+            while(target < 0 && fail != 0){
+                fail = g_array_index(mp->nodes, MultiPatternNode, fail).fail;
+                target = node_child(mp,
+                                    fail,
+                                    node->byte);
+            }
+            node->fail = target >= 0 ? target : 0;
+            MultiPatternNode *fail_node = &g_array_index(mp->nodes, MultiPatternNode, node->fail);
+            node->dict_link = fail_node->first_pattern >= 0 ? node->fail
+                                                            : fail_node->dict_link;
+            queue[tail++] = child;
+            child = node->next_sibling;
+        }
+    }
+    g_free(queue);
+    mp->is_compiled = TRUE;
+}
+
+void
+multi_pattern_scan(MultiPattern    *mp,
+                   const char      *text,
+                   int              length,
+                   MultiPatternFunc func,
+                   gpointer         user_data)
+{
+    if(!text || mp->patterns->len == 0){
+        return;
+    }
+    if(!mp->is_compiled){
+        multi_pattern_compile(mp);
+    }
+    if(length < 0){
+        length = strlen(text);
+    }
+    int state = 0;
+    for(int i = 0; i < length; i++){
+        guchar byte = text[i];
+        int next = node_child(mp,
+                              state,
+                              byte);
+        while(next < 0 && state != 0){
+            state = g_array_index(mp->nodes, MultiPatternNode, state).fail;
+            next = node_child(mp,
+                              state,
+                              byte);
+        }
+        state = next >= 0 ? next : 0;
+        int output = g_array_index(mp->nodes, MultiPatternNode, state).first_pattern >= 0 ? state
+                   : g_array_index(mp->nodes, MultiPatternNode, state).dict_link;
+        while(output >= 0){
+            MultiPatternNode *node = &g_array_index(mp->nodes, MultiPatternNode, output);
+            int pattern_index = node->first_pattern;
+            while(pattern_index >= 0){
+                MultiPatternEntry *entry = &g_array_index(mp->patterns, MultiPatternEntry, pattern_index);
+                func(i + 1 - node->depth,
+                     i + 1,
+                     entry->data,
+                     user_data);
+                pattern_index = entry->next_pattern;
+            }
+            output = node->dict_link;
+        }
+    }
+}
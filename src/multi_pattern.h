@@ -0,0 +1,53 @@
+/*
+ * Copyright © 2020 Reza Hasanzadeh
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 3.0 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef MULTI_PATTERN_H
+#define MULTI_PATTERN_H
+
+#include <glib.h>
+
+typedef struct MultiPattern MultiPattern;
+
+/* called for every occurrence of a pattern, text[start, end) */
+typedef void (*MultiPatternFunc)(int      start,
+                                 int      end,
+                                 gpointer pattern_data,
+                                 gpointer user_data);
+
+MultiPattern *
+multi_pattern_new(void);
+
+void
+multi_pattern_free(MultiPattern *mp);
+
+void
+multi_pattern_add(MultiPattern *mp,
+                  const char   *pattern,
+                  int           length,
+                  gpointer      pattern_data);
+
+void
+multi_pattern_compile(MultiPattern *mp);
+
+void
+multi_pattern_scan(MultiPattern    *mp,
+                   const char      *text,
+                   int              length,
+                   MultiPatternFunc func,
+                   gpointer         user_data);
+
+#endif
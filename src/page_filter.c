@@ -0,0 +1,354 @@
+/*
+ * Copyright © 2020 Reza Hasanzadeh
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 3.0 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "page_filter.h"
+
+/*
+   colour themes and contrast boost, applied in place to rendered pages.
+   ARGB32 pages are opaque, so every kernel works on plain bytes and leaves
+   alpha at 255. A8 pages(see page_surface.c) only take the contrast boost,
+   their theme is the paper and ink they are painted with.
+   each kernel has a scalar, an SSE2 and an AVX2 version, the widest one the
+   CPU supports is picked once.
+*/
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+/* contrast boost stretches [CONTRAST_LOW, 255 - CONTRAST_LOW] to [0, 255] */
+#define CONTRAST_LOW 32
+/* 128 * 255 / (255 - 2 * CONTRAST_LOW), rounded up so that 255 stays 255 */
+#define CONTRAST_GAIN 171
+
+enum Kernel
+{
+    KernelInvert = 0,
+    KernelTint,
+    KernelContrast,
+    NumKernels
+};
+
+typedef void (*KernelFunc)(guint8 *data,
+                           gsize   length);
+
+static const char *kernel_names[NumKernels] = {"night", "sepia", "contrast"};
+/* sepia multipliers of B, G, R and A, over 256 */
+static const guint16 tint_factors[4] = {200, 236, 256, 256};
+
+static KernelFunc kernels[NumKernels];
+static const char *kernel_isa = "scalar";
+
+G_LOCK_DEFINE_STATIC(stats);
+static guint64 kernel_bytes[NumKernels];
+static gint64 kernel_time_us[NumKernels];
+
+/* scalar */
+
+static void
+invert_scalar(guint8 *data,
+              gsize   length)
+{
+    /* RGB only, alpha is the high byte */
+    guint32 *pixels = (guint32 *)data;
+    for(gsize i = 0; i < length / 4; i++){
+        pixels[i] ^= 0x00ffffff;
+    }
+}
+
+static void
+tint_scalar(guint8 *data,
+            gsize   length)
+{
+    for(gsize i = 0; i < length; i++){
+        data[i] = (data[i] * tint_factors[i & 3]) >> 8;
+    }
+}
+
+static void
+contrast_scalar(guint8 *data,
+                gsize   length)
+{
+    for(gsize i = 0; i < length; i++){
+        guint v = data[i] > CONTRAST_LOW ? data[i] - CONTRAST_LOW : 0;
+        v = (v * CONTRAST_GAIN) >> 7;
+        data[i] = MIN(v, 255);
+    }
+}
+
+#ifdef HAVE_X86_KERNELS
+
+/* SSE2, 16 bytes at a time */
+
+__attribute__((target("sse2"))) static void
+invert_sse2(guint8 *data,
+            gsize   length)
+{
+    const __m128i mask = _mm_set1_epi32(0x00ffffff);
+    gsize i = 0;
+    for(; i + 16 <= length; i += 16){
+        __m128i v = _mm_loadu_si128((const __m128i *)(data + i));
+        _mm_storeu_si128((__m128i *)(data + i),
+                         _mm_xor_si128(v, mask));
+    }
+    invert_scalar(data + i,
+                  length - i);
+}
+
+__attribute__((target("sse2"))) static void
+tint_sse2(guint8 *data,
+          gsize   length)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i factors = _mm_setr_epi16(tint_factors[0], tint_factors[1],
+                                           tint_factors[2], tint_factors[3],
+                                           tint_factors[0], tint_factors[1],
+                                           tint_factors[2], tint_factors[3]);
+    gsize i = 0;
+    for(; i + 16 <= length; i += 16){
+        __m128i v = _mm_loadu_si128((const __m128i *)(data + i));
+        __m128i lo = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(v, zero), factors), 8);
+        __m128i hi = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(v, zero), factors), 8);
+        _mm_storeu_si128((__m128i *)(data + i),
+                         _mm_packus_epi16(lo, hi));
+    }
+    /* 16 is a multiple of 4, the factors stay in phase */
+    tint_scalar(data + i,
+                length - i);
+}
+
+__attribute__((target("sse2"))) static void
+contrast_sse2(guint8 *data,
+              gsize   length)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i low = _mm_set1_epi8(CONTRAST_LOW);
+    const __m128i gain = _mm_set1_epi16(CONTRAST_GAIN);
+    gsize i = 0;
+    for(; i + 16 <= length; i += 16){
+        __m128i v = _mm_subs_epu8(_mm_loadu_si128((const __m128i *)(data + i)), low);
+        __m128i lo = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(v, zero), gain), 7);
+        __m128i hi = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(v, zero), gain), 7);
+        _mm_storeu_si128((__m128i *)(data + i),
+                         _mm_packus_epi16(lo, hi));
+    }
+    contrast_scalar(data + i,
+                    length - i);
+}
+
+/* AVX2, 32 bytes at a time. unpack and pack work within 128 bit lanes, so
+   the byte order survives the round trip */
+
+__attribute__((target("avx2"))) static void
+invert_avx2(guint8 *data,
+            gsize   length)
+{
+    const __m256i mask = _mm256_set1_epi32(0x00ffffff);
+    gsize i = 0;
+    for(; i + 32 <= length; i += 32){
+        __m256i v = _mm256_loadu_si256((const __m256i *)(data + i));
+        _mm256_storeu_si256((__m256i *)(data + i),
+                            _mm256_xor_si256(v, mask));
+    }
+    invert_scalar(data + i,
+                  length - i);
+}
+
+__attribute__((target("avx2"))) static void
+tint_avx2(guint8 *data,
+          gsize   length)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i factors = _mm256_setr_epi16(tint_factors[0], tint_factors[1],
+                                              tint_factors[2], tint_factors[3],
+                                              tint_factors[0], tint_factors[1],
+                                              tint_factors[2], tint_factors[3],
+                                              tint_factors[0], tint_factors[1],
+                                              tint_factors[2], tint_factors[3],
+                                              tint_factors[0], tint_factors[1],
+                                              tint_factors[2], tint_factors[3]);
+    gsize i = 0;
+    for(; i + 32 <= length; i += 32){
+        __m256i v = _mm256_loadu_si256((const __m256i *)(data + i));
+        __m256i lo = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(v, zero), factors), 8);
+        __m256i hi = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(v, zero), factors), 8);
+        _mm256_storeu_si256((__m256i *)(data + i),
+                            _mm256_packus_epi16(lo, hi));
+    }
+    tint_scalar(data + i,
+                length - i);
+}
+
+__attribute__((target("avx2"))) static void
+contrast_avx2(guint8 *data,
+              gsize   length)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i low = _mm256_set1_epi8(CONTRAST_LOW);
+    const __m256i gain = _mm256_set1_epi16(CONTRAST_GAIN);
+    gsize i = 0;
+    for(; i + 32 <= length; i += 32){
+        __m256i v = _mm256_subs_epu8(_mm256_loadu_si256((const __m256i *)(data + i)), low);
+        __m256i lo = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(v, zero), gain), 7);
+        __m256i hi = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(v, zero), gain), 7);
+        _mm256_storeu_si256((__m256i *)(data + i),
+                            _mm256_packus_epi16(lo, hi));
+    }
+    contrast_scalar(data + i,
+                    length - i);
+}
+
+#endif
+
+static gpointer
+select_kernels(gpointer data)
+{
+    kernels[KernelInvert] = invert_scalar;
+    kernels[KernelTint] = tint_scalar;
+    kernels[KernelContrast] = contrast_scalar;
+#ifdef HAVE_X86_KERNELS
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2")){
+        kernels[KernelInvert] = invert_avx2;
+        kernels[KernelTint] = tint_avx2;
+        kernels[KernelContrast] = contrast_avx2;
+        kernel_isa = "avx2";
+    }
+    else if(__builtin_cpu_supports("sse2")){
+        kernels[KernelInvert] = invert_sse2;
+        kernels[KernelTint] = tint_sse2;
+        kernels[KernelContrast] = contrast_sse2;
+        kernel_isa = "sse2";
+    }
+#endif
+    return NULL;
+}
+
+static void
+run_kernel(enum Kernel kernel,
+           guint8     *data,
+           gsize       length)
+{
+    static GOnce kernels_once = G_ONCE_INIT;
+    g_once(&kernels_once,
+           select_kernels,
+           NULL);
+    gint64 start_time = g_get_monotonic_time();
+    kernels[kernel](data,
+                    length);
+    gint64 elapsed_time = g_get_monotonic_time() - start_time;
+    G_LOCK(stats);
+    kernel_bytes[kernel] += length;
+    kernel_time_us[kernel] += elapsed_time;
+    G_UNLOCK(stats);
+}
+
+gboolean
+page_filter_is_needed(cairo_surface_t *surface,
+                      enum PageTheme   theme,
+                      gboolean         is_contrast_boosted)
+{
+    if(cairo_image_surface_get_format(surface) == CAIRO_FORMAT_A8){
+        return is_contrast_boosted;
+    }
+    return is_contrast_boosted || theme != PageThemeDay;
+}
+
+void
+page_filter_apply(cairo_surface_t *surface,
+                  enum PageTheme   theme,
+                  gboolean         is_contrast_boosted)
+{
+    cairo_format_t format = cairo_image_surface_get_format(surface);
+    if(format != CAIRO_FORMAT_ARGB32 && format != CAIRO_FORMAT_RGB24 &&
+       format != CAIRO_FORMAT_A8)
+    {
+        return;
+    }
+    cairo_surface_flush(surface);
+    guint8 *data = cairo_image_surface_get_data(surface);
+    gsize length = (gsize)cairo_image_surface_get_stride(surface) *
+                   cairo_image_surface_get_height(surface);
+    if(is_contrast_boosted){
+        run_kernel(KernelContrast,
+                   data,
+                   length);
+    }
+    if(format != CAIRO_FORMAT_A8){
+        if(theme == PageThemeNight){
+            run_kernel(KernelInvert,
+                       data,
+                       length);
+        }
+        else if(theme == PageThemeSepia){
+            run_kernel(KernelTint,
+                       data,
+                       length);
+        }
+    }
+    cairo_surface_mark_dirty(surface);
+}
+
+void
+page_filter_theme_colors(enum PageTheme theme,
+                         double         paper[3],
+                         double         ink[3])
+{
+    /* what white and black turn into, matches the ARGB kernels */
+    paper[0] = paper[1] = paper[2] = 1.0;
+    ink[0] = ink[1] = ink[2] = 0.0;
+    if(theme == PageThemeNight){
+        paper[0] = paper[1] = paper[2] = 0.0;
+        ink[0] = ink[1] = ink[2] = 1.0;
+    }
+    else if(theme == PageThemeSepia){
+        paper[0] = tint_factors[2] / 256.0;
+        paper[1] = tint_factors[1] / 256.0;
+        paper[2] = tint_factors[0] / 256.0;
+    }
+}
+
+const char *
+page_filter_theme_to_string(enum PageTheme theme)
+{
+    switch(theme){
+    case PageThemeNight:
+        return "night";
+    case PageThemeSepia:
+        return "sepia";
+    default:
+        return "day";
+    }
+}
+
+void
+page_filter_dump_stats(void)
+{
+    G_LOCK(stats);
+    g_print("page filters(%s):",
+            kernel_isa);
+    for(int kernel = 0; kernel < NumKernels; kernel++){
+        g_print(" %s %.2f MiB at %.2f GB/s%s",
+                kernel_names[kernel],
+                kernel_bytes[kernel] / (1024.0 * 1024.0),
+                kernel_time_us[kernel] > 0 ? (double)kernel_bytes[kernel] / kernel_time_us[kernel] / 1000.0
+                                           : 0.0,
+                kernel < NumKernels - 1 ? "," : "\n");
+    }
+    G_UNLOCK(stats);
+}
@@ -0,0 +1,52 @@
+/*
+ * Copyright © 2020 Reza Hasanzadeh
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 3.0 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef PAGE_FILTER_H
+#define PAGE_FILTER_H
+
+#include <glib.h>
+#include <cairo.h>
+
+enum PageTheme
+{
+    PageThemeDay = 0,
+    PageThemeNight,
+    PageThemeSepia
+};
+
+gboolean
+page_filter_is_needed(cairo_surface_t *surface,
+                      enum PageTheme   theme,
+                      gboolean         is_contrast_boosted);
+
+void
+page_filter_apply(cairo_surface_t *surface,
+                  enum PageTheme   theme,
+                  gboolean         is_contrast_boosted);
+
+void
+page_filter_theme_colors(enum PageTheme theme,
+                         double         paper[3],
+                         double         ink[3]);
+
+const char *
+page_filter_theme_to_string(enum PageTheme theme);
+
+void
+page_filter_dump_stats(void);
+
+#endif
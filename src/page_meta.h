@@ -21,6 +21,8 @@
 #include <gmodule.h>
 #include <poppler/glib/poppler.h>
 #include "rect.h"
+#include "text_layout.h"
+#include "arena.h"
 #include "figure.h"
 
 typedef struct
@@ -39,6 +41,13 @@ typedef struct
     Rect *physical_layout; /* for future use */
 }PageLabel;
 
+enum PageColor
+{
+    PageColorUnknown = 0,
+    PageColorMonochrome,
+    PageColorColored
+};
+
 typedef struct
 {
 	char *text;
@@ -49,19 +58,28 @@ typedef struct
 	double page_width;
 	double page_height;
     double aspect_ratio;
+    /* detected on the first render, see render_reading_page() */
+    enum PageColor color;
 
     unsigned int num_layouts;
-	GPtrArray *physical_text_layouts;
+    TextLayout *text_layout;
 	double mean_line_height;
 
-	GList *links;
-	GList *converted_units;
+    /* overlays, walked on every draw and motion event */
+    GPtrArray *links;
+    GPtrArray *converted_units;
 
     GHashTable *figures;
-	GList *referenced_figures;
+    GPtrArray *referenced_figures;
     ReferencedFigure *active_referenced_figure;
 
-    GList *find_results;
+    GPtrArray *find_results;
+
+    /*
+       the page's links, their rects and tips, created on first use. other
+       analysis objects are still g_malloc'ed and freed one by one.
+    */
+    Arena *arena;
 }PageMeta;
 
 #endif
\ No newline at end of file
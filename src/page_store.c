@@ -0,0 +1,370 @@
+/*
+ * Copyright © 2020 Reza Hasanzadeh
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 3.0 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "page_store.h"
+#include <string.h>
+#include "find.h"
+#include "unit_convertor.h"
+#include "figure.h"
+
+#define DEFAULT_PAGE_BUDGET_MB 256
+#define MEBIBYTE (1024.0 * 1024.0)
+
+typedef struct
+{
+    /* link in 'resident_pages', NULL while evicted */
+    GList *node;
+    gsize size;
+    int num_holders;
+}PageEntry;
+
+static PopplerDocument *document = NULL;
+/* not owned */
+static GPtrArray *metae = NULL;
+static PageEntry *entries = NULL;
+/* PageMeta, most recently used first */
+static GQueue resident_pages = G_QUEUE_INIT;
+static gsize resident_size = 0;
+static gsize budget = 0;
+/* lowered under memory pressure, outlives documents */
+static double budget_fraction = 1.0;
+/* analysis passes read the pages directly, nothing is evicted meanwhile */
+static int num_suspensions = 0;
+static guint64 num_evictions = 0;
+static guint64 num_rehydrations = 0;
+static gint64 rehydration_time_us = 0;
+
+static gsize
+read_budget(void)
+{
+    const char *budget_str = g_getenv("READARATUS_PAGE_BUDGET_MB");
+    gint64 budget_mb = budget_str ? g_ascii_strtoll(budget_str,
+                                                    NULL,
+                                                    10)
+                                  : 0;
+    if(budget_mb <= 0){
+        budget_mb = DEFAULT_PAGE_BUDGET_MB;
+    }
+    return (gsize)budget_mb * 1024 * 1024;
+}
+
+static gsize
+string_size(const char *string)
+{
+    return string ? strlen(string) + 1 : 0;
+}
+
+static gsize
+page_size(const PageMeta *meta)
+{
+    return string_size(meta->text) + text_layout_size(meta->text_layout);
+}
+
+static void
+extract_page(PageMeta    *meta,
+             PopplerPage *page)
+{
+    meta->text = poppler_page_get_text(page);
+    meta->num_layouts = 0;
+    meta->text_layout = NULL;
+    PopplerRectangle *phys_layouts = NULL;
+    poppler_page_get_text_layout(page,
+                                 &phys_layouts,
+                                 &meta->num_layouts);
+    meta->mean_line_height = 0.0;
+    if(meta->num_layouts > 0){
+        meta->text_layout = text_layout_new(phys_layouts,
+                                            meta->num_layouts);
+        meta->mean_line_height = meta->text_layout->mean_height;
+        g_free(phys_layouts);
+    }
+}
+
+static void
+make_resident(PageMeta *meta)
+{
+    PageEntry *entry = &entries[meta->page_num];
+    entry->size = page_size(meta);
+    g_queue_push_head(&resident_pages,
+                      meta);
+    entry->node = resident_pages.head;
+    resident_size += entry->size;
+}
+
+static void
+evict_page(PageMeta *meta)
+{
+    PageEntry *entry = &entries[meta->page_num];
+    g_free(meta->text);
+    meta->text = NULL;
+    text_layout_free(meta->text_layout);
+    meta->text_layout = NULL;
+    meta->num_layouts = 0;
+    meta->mean_line_height = 0.0;
+    g_queue_delete_link(&resident_pages,
+                        entry->node);
+    entry->node = NULL;
+    resident_size -= entry->size;
+    entry->size = 0;
+    num_evictions++;
+}
+
+static void
+trim(void)
+{
+    if(num_suspensions > 0){
+        return;
+    }
+    /* coldest first, pages in use stay */
+    GList *list_p = resident_pages.tail;
+    gsize effective_budget = budget * budget_fraction;
+    while(list_p && resident_size > effective_budget){
+        GList *prev = list_p->prev;
+        PageMeta *meta = list_p->data;
+        if(entries[meta->page_num].num_holders == 0){
+            evict_page(meta);
+        }
+        list_p = prev;
+    }
+}
+
+void
+page_store_init(PopplerDocument *doc,
+                GPtrArray       *page_meta_list)
+{
+    page_store_destroy();
+    document = g_object_ref(doc);
+    metae = page_meta_list;
+    entries = g_new0(PageEntry, poppler_document_get_n_pages(doc));
+    budget = read_budget();
+    /* the document is analysed right after loading, see page_store_resume_eviction() */
+    num_suspensions = 1;
+}
+
+void
+page_store_destroy(void)
+{
+    /* the pages' text is freed along with the page metas */
+    if(document){
+        g_object_unref(document);
+        document = NULL;
+    }
+    metae = NULL;
+    g_free(entries);
+    entries = NULL;
+    g_queue_clear(&resident_pages);
+    resident_size = 0;
+    num_suspensions = 0;
+    num_evictions = 0;
+    num_rehydrations = 0;
+    rehydration_time_us = 0;
+}
+
+void
+page_store_load(PageMeta    *meta,
+                PopplerPage *page)
+{
+    extract_page(meta,
+                 page);
+    make_resident(meta);
+}
+
+void
+page_store_acquire(PageMeta *meta)
+{
+    PageEntry *entry = &entries[meta->page_num];
+    if(entry->node){
+        g_queue_unlink(&resident_pages,
+                       entry->node);
+        g_queue_push_head_link(&resident_pages,
+                               entry->node);
+    }
+    else{
+        gint64 start_time = g_get_monotonic_time();
+        PopplerPage *page = poppler_document_get_page(document,
+                                                      meta->page_num);
+        extract_page(meta,
+                     page);
+        g_object_unref(page);
+        make_resident(meta);
+        num_rehydrations++;
+        rehydration_time_us += g_get_monotonic_time() - start_time;
+    }
+    entry->num_holders++;
+}
+
+void
+page_store_release(PageMeta *meta)
+{
+    PageEntry *entry = &entries[meta->page_num];
+    if(entry->num_holders > 0){
+        entry->num_holders--;
+    }
+    trim();
+}
+
+void
+page_store_suspend_eviction(void)
+{
+    num_suspensions++;
+}
+
+void
+page_store_resume_eviction(void)
+{
+    if(num_suspensions > 0){
+        num_suspensions--;
+    }
+    trim();
+}
+
+gboolean
+page_store_is_eviction_suspended(void)
+{
+    return num_suspensions > 0;
+}
+
+void
+page_store_set_budget_fraction(double fraction)
+{
+    budget_fraction = CLAMP(fraction, 0.0, 1.0);
+    if(entries){
+        trim();
+    }
+}
+
+static gsize
+find_result_size(const FindResult *fr)
+{
+    return sizeof(FindResult) +
+           string_size(fr->match) +
+           string_size(fr->tip) +
+           sizeof(GPtrArray) +
+           fr->physical_layouts->len * (sizeof(Rect) + sizeof(gpointer));
+}
+
+static gsize
+find_result_list_size(GList *find_results)
+{
+    gsize size = 0;
+    GList *list_p = find_results;
+    while(list_p){
+        size += sizeof(GList) + find_result_size(list_p->data);
+        list_p = list_p->next;
+    }
+    return size;
+}
+
+static gsize
+converted_unit_size(const ConvertedUnit *cu)
+{
+    return sizeof(ConvertedUnit) +
+           string_size(cu->whole_match) +
+           string_size(cu->old_value) +
+           string_size(cu->multiplier) +
+           string_size(cu->old_unit) +
+           string_size(cu->unit) +
+           string_size(cu->value_str) +
+           cu->match_offsets->len * g_array_get_element_size(cu->match_offsets) +
+           find_result_list_size(cu->find_results);
+}
+
+static gsize
+figure_size(const Figure *figure)
+{
+    return sizeof(Figure) +
+           string_size(figure->whole_match) +
+           string_size(figure->label) +
+           string_size(figure->id) +
+           (figure->caption_physical_layout ? sizeof(Rect) : 0) +
+           (figure->image_physical_layout ? sizeof(Rect) : 0) +
+           g_list_length(figure->captions) * (sizeof(GList) + sizeof(Caption));
+}
+
+static gsize
+referenced_figure_size(const ReferencedFigure *ref_figure)
+{
+    return sizeof(ReferencedFigure) +
+           string_size(ref_figure->label) +
+           string_size(ref_figure->id) +
+           ref_figure->match_offsets->len * g_array_get_element_size(ref_figure->match_offsets) +
+           find_result_list_size(ref_figure->find_results);
+}
+
+void
+page_store_dump_stats(void)
+{
+    if(!metae){
+        return;
+    }
+    gsize text_size = 0,
+          layout_size = 0,
+          link_size = 0,
+          unit_size = 0,
+          figure_total_size = 0,
+          reference_size = 0,
+          find_size = 0;
+    for(unsigned int page_num = 0; page_num < metae->len; page_num++){
+        PageMeta *meta = g_ptr_array_index(metae,
+                                           page_num);
+        text_size += string_size(meta->text);
+        layout_size += text_layout_size(meta->text_layout);
+        /* links and their tips live in the page arena */
+        link_size += arena_size(meta->arena) + meta->links->len * sizeof(gpointer);
+        for(unsigned int i = 0; i < meta->converted_units->len; i++){
+            unit_size += converted_unit_size(g_ptr_array_index(meta->converted_units,
+                                                               i));
+        }
+        if(meta->figures){
+            GHashTableIter iter;
+            gpointer key, value;
+            g_hash_table_iter_init(&iter, meta->figures);
+            while(g_hash_table_iter_next(&iter, &key, &value)){
+                figure_total_size += figure_size(value);
+            }
+        }
+        for(unsigned int i = 0; i < meta->referenced_figures->len; i++){
+            reference_size += referenced_figure_size(g_ptr_array_index(meta->referenced_figures,
+                                                                       i));
+        }
+        for(unsigned int i = 0; i < meta->find_results->len; i++){
+            find_size += find_result_size(g_ptr_array_index(meta->find_results,
+                                                            i));
+        }
+    }
+    g_print("page store: %u of %u pages resident, %.1f of %.1f MiB budget, "
+            "%" G_GUINT64_FORMAT " evictions, "
+            "%" G_GUINT64_FORMAT " rehydrations in %.2f ms\n",
+            resident_pages.length,
+            metae->len,
+            resident_size / MEBIBYTE,
+            budget * budget_fraction / MEBIBYTE,
+            num_evictions,
+            num_rehydrations,
+            rehydration_time_us / 1000.0);
+    g_print("  text: %.2f MiB, layouts: %.2f MiB, links: %.2f MiB, units: %.2f MiB, "
+            "figures: %.2f MiB, references: %.2f MiB, find results: %.2f MiB, "
+            "page records: %.2f MiB\n",
+            text_size / MEBIBYTE,
+            layout_size / MEBIBYTE,
+            link_size / MEBIBYTE,
+            unit_size / MEBIBYTE,
+            figure_total_size / MEBIBYTE,
+            reference_size / MEBIBYTE,
+            find_size / MEBIBYTE,
+            metae->len * sizeof(PageMeta) / MEBIBYTE);
+}
@@ -0,0 +1,66 @@
+/*
+ * Copyright © 2020 Reza Hasanzadeh
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 3.0 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef PAGE_STORE_H
+#define PAGE_STORE_H
+
+#include <gmodule.h>
+#include <poppler/glib/poppler.h>
+#include "page_meta.h"
+
+/*
+   the text and character layouts of the pages are the bulk of a document's
+   memory. they are kept under a budget, READARATUS_PAGE_BUDGET_MB or
+   DEFAULT_PAGE_BUDGET_MB, and the least recently used pages give them up.
+   evicted pages are re-extracted from the document when acquired.
+   analysis passes that read every page go without acquiring them, they
+   suspend eviction instead and check that it is. main thread only.
+*/
+
+void
+page_store_init(PopplerDocument *doc,
+                GPtrArray       *page_meta_list);
+
+void
+page_store_destroy(void);
+
+void
+page_store_load(PageMeta    *meta,
+                PopplerPage *page);
+
+void
+page_store_acquire(PageMeta *meta);
+
+void
+page_store_release(PageMeta *meta);
+
+void
+page_store_suspend_eviction(void);
+
+void
+page_store_resume_eviction(void);
+
+gboolean
+page_store_is_eviction_suspended(void);
+
+void
+page_store_set_budget_fraction(double fraction);
+
+void
+page_store_dump_stats(void);
+
+#endif
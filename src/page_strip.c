@@ -0,0 +1,243 @@
+/*
+ * Copyright © 2020 Reza Hasanzadeh
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 3.0 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "page_strip.h"
+#include "thumbnail_grid.h"
+#include <poppler/glib/poppler.h>
+
+/* a grid of page thumbnails, see thumbnail_grid.h */
+
+#define THUMBNAIL_SIZE 128
+#define CELL_PADDING 10
+#define LABEL_HEIGHT 18
+
+/* page metas of the loaded document, not owned, read on the main thread only */
+static GPtrArray *metae = NULL;
+static ThumbnailGrid grid;
+/* highlighted as of the draw in progress */
+static int current_page_num = -1;
+
+static gpointer
+thumbnail_job_new(int    page_num,
+                  char **cache_name)
+{
+    *cache_name = g_strdup_printf("%d",
+                                  page_num);
+    return GINT_TO_POINTER(page_num);
+}
+
+static cairo_surface_t *
+render_thumbnail(PopplerDocument *document,
+                 gpointer         data)
+{
+    /* worker thread */
+    PopplerPage *page = poppler_document_get_page(document,
+                                                  GPOINTER_TO_INT(data));
+    if(!page){
+        return NULL;
+    }
+    double page_width, page_height;
+    poppler_page_get_size(page,
+                          &page_width,
+                          &page_height);
+    if(page_width <= 0 || page_height <= 0){
+        g_object_unref(page);
+        return NULL;
+    }
+    double scale = THUMBNAIL_SIZE / MAX(page_width, page_height);
+    int width = MAX(1, page_width * scale),
+        height = MAX(1, page_height * scale);
+    cairo_surface_t *thumbnail = cairo_image_surface_create(CAIRO_FORMAT_RGB24,
+                                                            width,
+                                                            height);
+    cairo_t *cr = cairo_create(thumbnail);
+    cairo_set_source_rgb(cr,
+                         1, 1, 1);
+    cairo_paint(cr);
+    cairo_scale(cr,
+                scale,
+                scale);
+    poppler_page_render(page,
+                        cr);
+    cairo_destroy(cr);
+    g_object_unref(page);
+    return thumbnail;
+}
+
+static void
+draw_cell(cairo_t         *cr,
+          int              page_num,
+          double           cell_x,
+          double           cell_y,
+          cairo_surface_t *thumbnail)
+{
+    const PageMeta *meta = g_ptr_array_index(metae,
+                                             page_num);
+    double cell_width = THUMBNAIL_SIZE + 2 * CELL_PADDING;
+    if(page_num == current_page_num && page_num != grid.hovered_index){
+        cairo_rectangle(cr,
+                        cell_x, cell_y,
+                        cell_width, THUMBNAIL_SIZE + LABEL_HEIGHT + 2 * CELL_PADDING);
+        cairo_set_source_rgba(cr,
+                              0.5686, 0.6392, 0.6902,
+                              0.5);
+        cairo_fill(cr);
+    }
+    /* the box keeps the page's proportions, placeholders too */
+    double scale = THUMBNAIL_SIZE / MAX(meta->page_width, meta->page_height);
+    double box_width = meta->page_width * scale,
+           box_height = meta->page_height * scale;
+    double box_x = cell_x + CELL_PADDING + (THUMBNAIL_SIZE - box_width) / 2.0,
+           box_y = cell_y + CELL_PADDING + (THUMBNAIL_SIZE - box_height) / 2.0;
+    if(thumbnail){
+        cairo_save(cr);
+        cairo_rectangle(cr,
+                        box_x, box_y,
+                        box_width, box_height);
+        cairo_clip(cr);
+        cairo_translate(cr,
+                        box_x, box_y);
+        cairo_scale(cr,
+                    box_width / cairo_image_surface_get_width(thumbnail),
+                    box_height / cairo_image_surface_get_height(thumbnail));
+        cairo_set_source_surface(cr,
+                                 thumbnail,
+                                 0, 0);
+        cairo_paint(cr);
+        cairo_restore(cr);
+    }
+    else{
+        /* placeholder */
+        cairo_rectangle(cr,
+                        box_x, box_y,
+                        box_width, box_height);
+        cairo_set_source_rgb(cr,
+                             0.7529, 0.7529, 0.7529);
+        cairo_fill(cr);
+    }
+    char *markup = NULL;
+    if(meta->page_label && meta->page_label->label){
+        markup = g_markup_printf_escaped("<span font='sans 9' foreground='#222222'>%s</span>",
+                                         meta->page_label->label);
+    }
+    else{
+        markup = g_markup_printf_escaped("<span font='sans 9' foreground='#222222'>%d</span>",
+                                         page_num + 1);
+    }
+    thumbnail_grid_draw_label(cr,
+                              markup,
+                              cell_x,
+                              cell_y + CELL_PADDING + THUMBNAIL_SIZE + 2,
+                              cell_width);
+    g_free(markup);
+}
+
+static const ThumbnailGridMode strip_mode = {
+    "pages",
+    THUMBNAIL_SIZE,
+    CELL_PADDING,
+    LABEL_HEIGHT,
+    thumbnail_job_new,
+    NULL,
+    render_thumbnail,
+    draw_cell
+};
+
+void
+page_strip_module_init(GtkWidget *widget)
+{
+    thumbnail_grid_init(&grid,
+                        widget,
+                        &strip_mode);
+}
+
+void
+page_strip_module_destroy(void)
+{
+    page_strip_unload();
+    thumbnail_grid_destroy(&grid);
+}
+
+void
+page_strip_load(const char *filename,
+                GPtrArray  *page_meta_list)
+{
+    page_strip_unload();
+    metae = page_meta_list;
+    thumbnail_grid_load(&grid,
+                        filename,
+                        metae ? metae->len : 0);
+}
+
+void
+page_strip_unload(void)
+{
+    thumbnail_grid_unload(&grid);
+    metae = NULL;
+}
+
+void
+page_strip_draw(cairo_t *cr,
+                double   width,
+                double   height,
+                int      cur_page_num)
+{
+    current_page_num = cur_page_num;
+    thumbnail_grid_draw(&grid,
+                        cr,
+                        width,
+                        height);
+}
+
+void
+page_strip_scroll(double dy)
+{
+    thumbnail_grid_scroll(&grid,
+                          dy);
+}
+
+void
+page_strip_scroll_to_page(int page_num)
+{
+    thumbnail_grid_scroll_to(&grid,
+                             page_num);
+}
+
+void
+page_strip_set_cache_limit(int max_thumbnails)
+{
+    thumbnail_grid_set_cache_limit(&grid,
+                                   max_thumbnails);
+}
+
+cairo_surface_t *
+page_strip_lookup_thumbnail(int page_num)
+{
+    /* borrowed, NULL if the page has no thumbnail in memory */
+    return thumbnail_grid_lookup(&grid,
+                                 page_num);
+}
+
+int
+page_strip_hover(double x,
+                 double y)
+{
+    /* page under (x, y) as of the last draw, -1 if none */
+    return thumbnail_grid_hover(&grid,
+                                x,
+                                y);
+}
@@ -0,0 +1,59 @@
+/*
+ * Copyright © 2020 Reza Hasanzadeh
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 3.0 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef PAGE_STRIP_H
+#define PAGE_STRIP_H
+
+#include <gtk/gtk.h>
+#include "page_meta.h"
+
+void
+page_strip_module_init(GtkWidget *widget);
+
+void
+page_strip_module_destroy(void);
+
+void
+page_strip_load(const char *filename,
+                GPtrArray  *metae);
+
+void
+page_strip_unload(void);
+
+void
+page_strip_draw(cairo_t *cr,
+                double   width,
+                double   height,
+                int      cur_page_num);
+
+void
+page_strip_scroll(double dy);
+
+void
+page_strip_scroll_to_page(int page_num);
+
+void
+page_strip_set_cache_limit(int max_thumbnails);
+
+cairo_surface_t *
+page_strip_lookup_thumbnail(int page_num);
+
+int
+page_strip_hover(double x,
+                 double y);
+
+#endif
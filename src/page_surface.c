@@ -0,0 +1,137 @@
+/*
+ * Copyright © 2020 Reza Hasanzadeh
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 3.0 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "page_surface.h"
+#include "surface_pool.h"
+
+/*
+   pages rendered over white paper with no colour in them are kept as A8
+   surfaces, a byte of ink coverage per pixel instead of four bytes of ARGB,
+   and are painted as black ink through that mask.
+*/
+
+/* channels of a grey pixel may differ this much, scans and jpegs are noisy */
+#define CHROMA_TOLERANCE 24
+
+gboolean
+page_surface_is_monochrome(cairo_surface_t *surface)
+{
+    if(cairo_image_surface_get_format(surface) == CAIRO_FORMAT_A8){
+        return TRUE;
+    }
+    if(cairo_image_surface_get_format(surface) != CAIRO_FORMAT_ARGB32 &&
+       cairo_image_surface_get_format(surface) != CAIRO_FORMAT_RGB24)
+    {
+        return FALSE;
+    }
+    cairo_surface_flush(surface);
+    int width = cairo_image_surface_get_width(surface);
+    int height = cairo_image_surface_get_height(surface);
+    int stride = cairo_image_surface_get_stride(surface);
+    const unsigned char *data = cairo_image_surface_get_data(surface);
+    for(int y = 0; y < height; y++){
+        const guint32 *row = (const guint32 *)(data + y * stride);
+        for(int x = 0; x < width; x++){
+            int r = (row[x] >> 16) & 0xff,
+                g = (row[x] >> 8) & 0xff,
+                b = row[x] & 0xff;
+            if(ABS(r - g) > CHROMA_TOLERANCE ||
+               ABS(g - b) > CHROMA_TOLERANCE ||
+               ABS(r - b) > CHROMA_TOLERANCE)
+            {
+                return FALSE;
+            }
+        }
+    }
+    return TRUE;
+}
+
+cairo_surface_t *
+page_surface_to_a8(cairo_surface_t *surface)
+{
+    /* 'surface' is an opaque page, alpha is ignored */
+    cairo_surface_flush(surface);
+    int width = cairo_image_surface_get_width(surface);
+    int height = cairo_image_surface_get_height(surface);
+    int stride = cairo_image_surface_get_stride(surface);
+    const unsigned char *data = cairo_image_surface_get_data(surface);
+    /* every pixel is written */
+    cairo_surface_t *mask = surface_pool_create(CAIRO_FORMAT_A8,
+                                                width,
+                                                height,
+                                                FALSE);
+    if(cairo_surface_status(mask) != CAIRO_STATUS_SUCCESS){
+        cairo_surface_destroy(mask);
+        return NULL;
+    }
+    int mask_stride = cairo_image_surface_get_stride(mask);
+    unsigned char *mask_data = cairo_image_surface_get_data(mask);
+    for(int y = 0; y < height; y++){
+        const guint32 *row = (const guint32 *)(data + y * stride);
+        unsigned char *mask_row = mask_data + y * mask_stride;
+        for(int x = 0; x < width; x++){
+            /* BT.601 luma in fixed point */
+            guint32 luma = (((row[x] >> 16) & 0xff) * 77 +
+                            ((row[x] >> 8) & 0xff) * 150 +
+                            (row[x] & 0xff) * 29) >> 8;
+            mask_row[x] = 255 - luma;
+        }
+    }
+    cairo_surface_mark_dirty(mask);
+    return mask;
+}
+
+void
+page_surface_paint(cairo_t         *cr,
+                   cairo_surface_t *surface,
+                   enum PageTheme   theme)
+{
+    /*
+       fills the current clip, the surface is at the user space origin.
+       'theme' picks paper and ink of A8 surfaces, others come filtered.
+    */
+    if(cairo_image_surface_get_format(surface) == CAIRO_FORMAT_A8){
+        double paper[3], ink[3];
+        page_filter_theme_colors(theme,
+                                 paper,
+                                 ink);
+        cairo_set_source_rgb(cr,
+                             paper[0], paper[1], paper[2]);
+        cairo_paint(cr);
+        cairo_set_source_rgb(cr,
+                             ink[0], ink[1], ink[2]);
+        cairo_mask_surface(cr,
+                           surface,
+                           0, 0);
+    }
+    else{
+        cairo_set_source_surface(cr,
+                                 surface,
+                                 0, 0);
+        cairo_paint(cr);
+    }
+}
+
+gsize
+page_surface_size(cairo_surface_t *surface)
+{
+    if(!surface){
+        return 0;
+    }
+    return (gsize)cairo_image_surface_get_stride(surface) *
+           cairo_image_surface_get_height(surface);
+}
@@ -0,0 +1,39 @@
+/*
+ * Copyright © 2020 Reza Hasanzadeh
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 3.0 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef PAGE_SURFACE_H
+#define PAGE_SURFACE_H
+
+#include <glib.h>
+#include <cairo.h>
+#include "page_filter.h"
+
+gboolean
+page_surface_is_monochrome(cairo_surface_t *surface);
+
+cairo_surface_t *
+page_surface_to_a8(cairo_surface_t *surface);
+
+void
+page_surface_paint(cairo_t         *cr,
+                   cairo_surface_t *surface,
+                   enum PageTheme   theme);
+
+gsize
+page_surface_size(cairo_surface_t *surface);
+
+#endif
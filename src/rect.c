@@ -222,34 +222,33 @@ rects_have_intersection(Rect *a,
 }
 
 gboolean
-rect_intersects_rect_list(Rect  *x,
-                          GList *rects)
+rect_intersects_rect_array(Rect      *x,
+                           GPtrArray *rects)
 {
-    GList *rect_p = rects;
-    while(rect_p){
-        if(rects_have_intersection(rect_p->data,
+    for(int i = 0; i < rects->len; i++){
+        if(rects_have_intersection(g_ptr_array_index(rects,
+                                                     i),
                                    x))
         {
-            break;
+            return TRUE;
         }
-        rect_p = rect_p->next;
     }
-    return rect_p ? TRUE : FALSE;
+    return FALSE;
 }
 
 gboolean
-rect_lists_intersect(GList *rects_a,
-                     GList *rects_b)
+rect_arrays_intersect(GPtrArray *rects_a,
+                      GPtrArray *rects_b)
 {
-    GList *rect_a_p = rects_a;
-    while(rect_a_p){        
-        if(rect_intersects_rect_list(rect_a_p->data,
-                                     rects_b)){
-            break;
+    for(int i = 0; i < rects_a->len; i++){
+        if(rect_intersects_rect_array(g_ptr_array_index(rects_a,
+                                                        i),
+                                      rects_b))
+        {
+            return TRUE;
         }
-        rect_a_p = rect_a_p->next;
     }
-    return rect_a_p ? TRUE : FALSE;
+    return FALSE;
 }
 
 
@@ -289,4 +288,161 @@ rect_y_compare(const void *a,
     const Rect *rect_a = a;
     const Rect *rect_b = b;
     return rect_a->y1 - rect_b->y1;
-}
\ No newline at end of file
+}
+
+static double
+rect_top(const Rect *rect)
+{
+    return MIN(rect->y1, rect->y2);
+}
+
+static double
+rect_bottom(const Rect *rect)
+{
+    return MAX(rect->y1, rect->y2);
+}
+
+static int
+compare_rect_tops(gconstpointer a,
+                  gconstpointer b,
+                  gpointer      user_data)
+{
+    double top_a = rect_top(a);
+    double top_b = rect_top(b);
+    if(top_a < top_b){
+        return -1;
+    }
+    if(top_a > top_b){
+        return +1;
+    }
+    return 0;
+}
+
+RectIndex *
+rect_index_new(void)
+{
+    RectIndex *index = g_malloc(sizeof(RectIndex));
+    index->ranges = g_sequence_new(g_free);
+    index->rects = g_sequence_new(NULL);
+    index->max_height = 0.0;
+    return index;
+}
+
+void
+rect_index_free(RectIndex *index)
+{
+    if(!index){
+        return;
+    }
+    g_sequence_free(index->ranges);
+    g_sequence_free(index->rects);
+    g_free(index);
+}
+
+void
+rect_index_add(RectIndex *index,
+               Rect      *rect)
+{
+    g_sequence_insert_sorted(index->rects,
+                             rect,
+                             compare_rect_tops,
+                             NULL);
+    index->max_height = MAX(index->max_height,
+                            rect_bottom(rect) - rect_top(rect));
+}
+
+gboolean
+rect_index_intersects(RectIndex *index,
+                      Rect      *rect)
+{
+    /*
+       only rects whose top lies in [top - max_height, bottom] can reach
+       rect, walk just those.
+    */
+    double lowest_top = rect_top(rect) - index->max_height;
+    double bottom = rect_bottom(rect);
+    Rect probe = {rect->x1, lowest_top, rect->x2, lowest_top};
+    GSequenceIter *iter = g_sequence_search(index->rects,
+                                            &probe,
+                                            compare_rect_tops,
+                                            NULL);
+    while(!g_sequence_iter_is_begin(iter)){
+        GSequenceIter *prev = g_sequence_iter_prev(iter);
+        if(rect_top(g_sequence_get(prev)) < lowest_top){
+            break;
+        }
+        iter = prev;
+    }
+    while(!g_sequence_iter_is_end(iter)){
+        Rect *candidate = g_sequence_get(iter);
+        if(rect_top(candidate) > bottom){
+            break;
+        }
+        if(rects_have_intersection(candidate,
+                                   rect))
+        {
+            return TRUE;
+        }
+        iter = g_sequence_iter_next(iter);
+    }
+    return FALSE;
+}
+
+typedef struct
+{
+    int start;
+    int end;
+}TextRange;
+
+static int
+compare_range_starts(gconstpointer a,
+                     gconstpointer b,
+                     gpointer      user_data)
+{
+    const TextRange *range_a = a;
+    const TextRange *range_b = b;
+    return range_a->start - range_b->start;
+}
+
+void
+rect_index_add_range(RectIndex *index,
+                     int        start,
+                     int        end)
+{
+    TextRange *range = g_malloc(sizeof(TextRange));
+    range->start = start;
+    range->end = end;
+    g_sequence_insert_sorted(index->ranges,
+                             range,
+                             compare_range_starts,
+                             NULL);
+}
+
+gboolean
+rect_index_intersects_range(RectIndex *index,
+                            int        start,
+                            int        end)
+{
+    /*
+       the ranges are disjoint, so only the last one starting at or before
+       start and the first one starting after it can reach [start, end).
+    */
+    TextRange probe = {start, end};
+    GSequenceIter *iter = g_sequence_search(index->ranges,
+                                            &probe,
+                                            compare_range_starts,
+                                            NULL);
+    if(!g_sequence_iter_is_begin(iter)){
+        const TextRange *before = g_sequence_get(g_sequence_iter_prev(iter));
+        if(before->end > start){
+            return TRUE;
+        }
+    }
+    if(!g_sequence_iter_is_end(iter)){
+        const TextRange *after = g_sequence_get(iter);
+        if(after->start < end){
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
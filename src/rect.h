@@ -98,12 +98,12 @@ gboolean
 rects_have_intersection(Rect *a,
                         Rect *b);
 gboolean
-rect_intersects_rect_list(Rect  *x,
-                          GList *rects);
+rect_intersects_rect_array(Rect      *x,
+                           GPtrArray *rects);
 
 gboolean
-rect_lists_intersect(GList *rects_a,
-                     GList *rects_b);
+rect_arrays_intersect(GPtrArray *rects_a,
+                      GPtrArray *rects_b);
 
 int
 rect_xy_compare(const void *a,
@@ -117,4 +117,42 @@ int
 rect_y_compare(const void *a,
                const void *b);
 
+/*
+   what has been taken on a page, to tell whether something new overlaps it.
+   items with byte offsets into the page text are kept as disjoint [start, end)
+   ranges in a tree sorted by start, added and tested in O(log n). rects
+   are only for items without offsets, they are sorted by their top, are not
+   owned and have to outlive the index.
+*/
+typedef struct
+{
+    GSequence *ranges;
+    GSequence *rects;
+    double max_height;
+}RectIndex;
+
+RectIndex *
+rect_index_new(void);
+
+void
+rect_index_free(RectIndex *index);
+
+void
+rect_index_add(RectIndex *index,
+               Rect      *rect);
+
+gboolean
+rect_index_intersects(RectIndex *index,
+                      Rect      *rect);
+
+void
+rect_index_add_range(RectIndex *index,
+                     int        start,
+                     int        end);
+
+gboolean
+rect_index_intersects_range(RectIndex *index,
+                            int        start,
+                            int        end);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,200 @@
+/*
+ * Copyright © 2020 Reza Hasanzadeh
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 3.0 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "regex_registry.h"
+
+/*
+   meant for the patterns fixed at compile time. ones built from user input
+   are compiled with g_regex_new() and dropped after use. the bound is a
+   safety net, the least recently used pattern goes first.
+*/
+#define MAX_REGISTERED_PATTERNS 512
+
+typedef struct
+{
+    GRegex *regex;
+    /* in lru_keys, the key is owned by the registry */
+    GList *link;
+}RegistryEntry;
+
+G_LOCK_DEFINE_STATIC(registry);
+/* key > RegistryEntry */
+static GHashTable *registry = NULL;
+/* most recently used first */
+static GQueue lru_keys = G_QUEUE_INIT;
+static guint64 num_lookups = 0;
+static guint64 num_compiles = 0;
+static guint64 num_failures = 0;
+static guint64 num_evictions = 0;
+static gint64 compile_time_us = 0;
+
+static void
+registry_entry_free(RegistryEntry *entry)
+{
+    g_regex_unref(entry->regex);
+    g_free(entry);
+}
+
+void
+regex_registry_module_destroy(void)
+{
+    G_LOCK(registry);
+    if(registry){
+        g_queue_clear(&lru_keys);
+        g_hash_table_unref(registry);
+        registry = NULL;
+    }
+    G_UNLOCK(registry);
+}
+
+GRegex *
+regex_registry_lookup(const char        *pattern,
+                      GRegexCompileFlags compile_options,
+                      GRegexMatchFlags   match_options,
+                      GError           **error)
+{
+    /*
+       a drop-in for g_regex_new() for constant patterns: each (pattern,
+       options) is compiled once, optimized, and shared. the caller owns a
+       reference to the result.
+    */
+    char *key = g_strdup_printf("%x/%x/%s",
+                                compile_options,
+                                match_options,
+                                pattern);
+    G_LOCK(registry);
+    if(!registry){
+        registry = g_hash_table_new_full(g_str_hash,
+                                         g_str_equal,
+                                         g_free,
+                                         (GDestroyNotify)registry_entry_free);
+    }
+    num_lookups++;
+    RegistryEntry *entry = g_hash_table_lookup(registry,
+                                               key);
+    if(entry){
+        g_queue_unlink(&lru_keys,
+                       entry->link);
+        g_queue_push_head_link(&lru_keys,
+                               entry->link);
+        GRegex *regex = g_regex_ref(entry->regex);
+        G_UNLOCK(registry);
+        g_free(key);
+        return regex;
+    }
+    gint64 start = g_get_monotonic_time();
+    GRegex *regex = g_regex_new(pattern,
+                        compile_options | G_REGEX_OPTIMIZE,
+                        match_options,
+                        error);
+    compile_time_us += g_get_monotonic_time() - start;
+    num_compiles++;
+    if(!regex){
+        num_failures++;
+        G_UNLOCK(registry);
+        g_free(key);
+        return NULL;
+    }
+    if(g_hash_table_size(registry) >= MAX_REGISTERED_PATTERNS){
+        /* outstanding references keep the evicted regex alive */
+        char *lru_key = g_queue_pop_tail(&lru_keys);
+        g_hash_table_remove(registry,
+                            lru_key);
+        num_evictions++;
+    }
+    entry = g_malloc(sizeof(RegistryEntry));
+    entry->regex = g_regex_ref(regex);
+    g_queue_push_head(&lru_keys,
+                      key);
+    entry->link = lru_keys.head;
+    g_hash_table_insert(registry,
+                        key,
+                        entry);
+    G_UNLOCK(registry);
+    return regex;
+}
+
+gboolean
+regex_registry_match_simple(const char        *pattern,
+                            const char        *string,
+                            GRegexCompileFlags compile_options,
+                            GRegexMatchFlags   match_options)
+{
+    GError *err = NULL;
+    GRegex *regex = regex_registry_lookup(pattern,
+                                          compile_options,
+                                          match_options,
+                                          &err);
+    if(!regex){
+        g_print("regex error. pattern: %s \ndomain: %d, \ncode: %d, \nmessage: %s\n",
+                pattern,
+                err->domain,
+                err->code,
+                err->message);
+        g_error_free(err);
+        return FALSE;
+    }
+    gboolean matches = g_regex_match(regex,
+                                     string,
+                                     0,
+                                     NULL);
+    g_regex_unref(regex);
+    return matches;
+}
+
+char **
+regex_registry_split_simple(const char        *pattern,
+                            const char        *string,
+                            GRegexCompileFlags compile_options,
+                            GRegexMatchFlags   match_options)
+{
+    GError *err = NULL;
+    GRegex *regex = regex_registry_lookup(pattern,
+                                          compile_options,
+                                          match_options,
+                                          &err);
+    if(!regex){
+        g_print("regex error. pattern: %s \ndomain: %d, \ncode: %d, \nmessage: %s\n",
+                pattern,
+                err->domain,
+                err->code,
+                err->message);
+        g_error_free(err);
+        return NULL;
+    }
+    char **tokens = g_regex_split(regex,
+                                  string,
+                                  0);
+    g_regex_unref(regex);
+    return tokens;
+}
+
+void
+regex_registry_dump_stats(void)
+{
+    G_LOCK(registry);
+    g_print("regex registry: %u patterns, %" G_GUINT64_FORMAT " lookups, "
+            "%" G_GUINT64_FORMAT " compiles(%" G_GUINT64_FORMAT " failed) in %.2f ms, "
+            "%" G_GUINT64_FORMAT " evictions\n",
+            registry ? g_hash_table_size(registry) : 0,
+            num_lookups,
+            num_compiles,
+            num_failures,
+            compile_time_us / 1000.0,
+            num_evictions);
+    G_UNLOCK(registry);
+}
@@ -0,0 +1,47 @@
+/*
+ * Copyright © 2020 Reza Hasanzadeh
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 3.0 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef REGEX_REGISTRY_H
+#define REGEX_REGISTRY_H
+
+#include <glib.h>
+
+void
+regex_registry_module_destroy(void);
+
+GRegex *
+regex_registry_lookup(const char        *pattern,
+                      GRegexCompileFlags compile_options,
+                      GRegexMatchFlags   match_options,
+                      GError           **error);
+
+gboolean
+regex_registry_match_simple(const char        *pattern,
+                            const char        *string,
+                            GRegexCompileFlags compile_options,
+                            GRegexMatchFlags   match_options);
+
+char **
+regex_registry_split_simple(const char        *pattern,
+                            const char        *string,
+                            GRegexCompileFlags compile_options,
+                            GRegexMatchFlags   match_options);
+
+void
+regex_registry_dump_stats(void);
+
+#endif
@@ -0,0 +1,372 @@
+/*
+ * Copyright © 2020 Reza Hasanzadeh
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 3.0 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "render_pool.h"
+
+/*
+   every rendering goes through a fixed set of workers. poppler documents
+   can't be shared between threads, so each worker gets its own, all opened
+   on one mapping of the file. a job is cancelled by bumping the generation
+   counter it was submitted with, and its surface is handed to the main
+   thread as is, never copied.
+*/
+
+#define MAX_WORKERS 4
+
+typedef struct
+{
+    GMutex mutex;
+    GCond cond;
+    gboolean is_done;
+}RenderWait;
+
+typedef struct
+{
+    enum RenderPriority priority;
+    guint64 sequence;
+    /* the client's counter and its value at submission, NULL for none */
+    gint *generation;
+    gint job_generation;
+    gint pool_generation;
+    RenderFunc render;
+    RenderDoneFunc done;
+    gpointer data;
+    GDestroyNotify data_free;
+    cairo_surface_t *surface;
+    /* set for render_pool_render_sync() jobs */
+    RenderWait *wait;
+}RenderJob;
+
+static GThreadPool *render_pool = NULL;
+static GMappedFile *mapped_file = NULL;
+/* each running job borrows one, there are as many as workers */
+static GAsyncQueue *worker_documents = NULL;
+/* bumped on close, results of older generations are dropped */
+static gint pool_generation = 0;
+static guint64 num_submitted_jobs = 0;
+
+/* per priority class */
+G_LOCK_DEFINE_STATIC(render_stats);
+static guint64 num_rendered_jobs[RenderPriorityCount] = {0};
+static guint64 num_cancelled_jobs[RenderPriorityCount] = {0};
+static guint64 num_dropped_results[RenderPriorityCount] = {0};
+static gint64 render_time_us[RenderPriorityCount] = {0};
+static guint64 num_sync_waits = 0;
+static gint64 sync_wait_time_us = 0;
+
+static gboolean
+is_job_cancelled(const RenderJob *job)
+{
+    return job->pool_generation != g_atomic_int_get(&pool_generation) ||
+           (job->generation && job->job_generation != g_atomic_int_get(job->generation));
+}
+
+static void
+render_job_free(RenderJob *job)
+{
+    if(job->surface){
+        cairo_surface_destroy(job->surface);
+    }
+    if(job->data_free){
+        job->data_free(job->data);
+    }
+    g_free(job);
+}
+
+static gboolean
+deliver_job(gpointer data)
+{
+    /* main thread */
+    RenderJob *job = data;
+    if(is_job_cancelled(job)){
+        G_LOCK(render_stats);
+        num_dropped_results[job->priority]++;
+        G_UNLOCK(render_stats);
+    }
+    else{
+        job->done(job->surface,
+                  job->data);
+        job->surface = NULL;
+    }
+    render_job_free(job);
+    return G_SOURCE_REMOVE;
+}
+
+static void
+run_job(gpointer data,
+        gpointer user_data)
+{
+    /* worker thread */
+    RenderJob *job = data;
+    gint64 start_time = g_get_monotonic_time();
+    if(is_job_cancelled(job)){
+        G_LOCK(render_stats);
+        num_cancelled_jobs[job->priority]++;
+        G_UNLOCK(render_stats);
+    }
+    else{
+        PopplerDocument *document = g_async_queue_pop(worker_documents);
+        job->surface = job->render(document,
+                                   job->data);
+        g_async_queue_push(worker_documents,
+                           document);
+        G_LOCK(render_stats);
+        num_rendered_jobs[job->priority]++;
+        render_time_us[job->priority] += g_get_monotonic_time() - start_time;
+        G_UNLOCK(render_stats);
+    }
+    if(job->wait){
+        g_mutex_lock(&job->wait->mutex);
+        job->wait->is_done = TRUE;
+        g_cond_signal(&job->wait->cond);
+        g_mutex_unlock(&job->wait->mutex);
+        return;
+    }
+    g_idle_add(deliver_job,
+               job);
+}
+
+static int
+compare_jobs(gconstpointer a,
+             gconstpointer b,
+             gpointer      user_data)
+{
+    /* by class, first come first served within one */
+    const RenderJob *job_a = a;
+    const RenderJob *job_b = b;
+    if(job_a->priority != job_b->priority){
+        return job_a->priority - job_b->priority;
+    }
+    return job_a->sequence < job_b->sequence ? -1 : (job_a->sequence > job_b->sequence);
+}
+
+static PopplerDocument *
+open_worker_document(const char *uri)
+{
+    GError *err = NULL;
+#if POPPLER_CHECK_VERSION(0, 82, 0)
+    /* the document keeps its own reference */
+    GBytes *bytes = g_mapped_file_get_bytes(mapped_file);
+    PopplerDocument *document = poppler_document_new_from_bytes(bytes,
+                                                                NULL,
+                                                                &err);
+    g_bytes_unref(bytes);
+#else
+    PopplerDocument *document = poppler_document_new_from_file(uri,
+                                                               NULL,
+                                                               &err);
+#endif
+    if(!document){
+        g_print("render worker document error.\ndomain: %d, \ncode: %d, \nmessage: %s\n",
+                err->domain, err->code, err->message);
+        g_error_free(err);
+    }
+    return document;
+}
+
+gboolean
+render_pool_open(const char *filename)
+{
+    render_pool_close();
+    GError *err = NULL;
+    mapped_file = g_mapped_file_new(filename,
+                                    FALSE,
+                                    &err);
+    if(!mapped_file){
+        g_print("render pool mapping error.\ndomain: %d, \ncode: %d, \nmessage: %s\n",
+                err->domain, err->code, err->message);
+        g_error_free(err);
+        return FALSE;
+    }
+    char *uri = g_filename_to_uri(filename,
+                                  NULL,
+                                  NULL);
+    worker_documents = g_async_queue_new();
+    int num_workers = CLAMP(g_get_num_processors(), 1, MAX_WORKERS);
+    for(int i = 0; i < num_workers; i++){
+        PopplerDocument *document = open_worker_document(uri);
+        if(!document){
+            break;
+        }
+        g_async_queue_push(worker_documents,
+                           document);
+    }
+    g_free(uri);
+    int num_documents = g_async_queue_length(worker_documents);
+    if(num_documents == 0){
+        render_pool_close();
+        return FALSE;
+    }
+    render_pool = g_thread_pool_new(run_job,
+                                    NULL,
+                                    num_documents,
+                                    FALSE,
+                                    &err);
+    if(!render_pool){
+        g_print("render pool error.\ndomain: %d, \ncode: %d, \nmessage: %s\n",
+                err->domain, err->code, err->message);
+        g_error_free(err);
+        render_pool_close();
+        return FALSE;
+    }
+    g_thread_pool_set_sort_function(render_pool,
+                                    compare_jobs,
+                                    NULL);
+    return TRUE;
+}
+
+void
+render_pool_close(void)
+{
+    g_atomic_int_inc(&pool_generation);
+    if(render_pool){
+        /* queued jobs see the new generation and bail out */
+        g_thread_pool_free(render_pool,
+                           FALSE,
+                           TRUE);
+        render_pool = NULL;
+    }
+    if(worker_documents){
+        PopplerDocument *document;
+        while((document = g_async_queue_try_pop(worker_documents))){
+            g_object_unref(document);
+        }
+        g_async_queue_unref(worker_documents);
+        worker_documents = NULL;
+    }
+    if(mapped_file){
+        g_mapped_file_unref(mapped_file);
+        mapped_file = NULL;
+    }
+}
+
+gboolean
+render_pool_is_open(void)
+{
+    return render_pool != NULL;
+}
+
+static RenderJob *
+render_job_new(enum RenderPriority  priority,
+               gint                *generation,
+               RenderFunc           render,
+               RenderDoneFunc       done,
+               gpointer             data,
+               GDestroyNotify       data_free)
+{
+    RenderJob *job = g_malloc0(sizeof(RenderJob));
+    job->priority = priority;
+    job->sequence = num_submitted_jobs++;
+    job->generation = generation;
+    job->job_generation = generation ? g_atomic_int_get(generation) : 0;
+    job->pool_generation = g_atomic_int_get(&pool_generation);
+    job->render = render;
+    job->done = done;
+    job->data = data;
+    job->data_free = data_free;
+    return job;
+}
+
+void
+render_pool_submit(enum RenderPriority  priority,
+                   gint                *generation,
+                   RenderFunc           render,
+                   RenderDoneFunc       done,
+                   gpointer             data,
+                   GDestroyNotify       data_free)
+{
+    /* main thread, done is called unless the generation moves on first */
+    if(!render_pool){
+        if(data_free){
+            data_free(data);
+        }
+        return;
+    }
+    g_thread_pool_push(render_pool,
+                       render_job_new(priority,
+                                      generation,
+                                      render,
+                                      done,
+                                      data,
+                                      data_free),
+                       NULL);
+}
+
+cairo_surface_t *
+render_pool_render_sync(RenderFunc render,
+                        gpointer   data)
+{
+    /*
+       for callers that can't go on without the surface, NULL if the pool is
+       closed. the job is queued at the visible class behind any visible jobs
+       already there, then waits for a worker's document, and the caller is
+       blocked all along. keep it off paths that run on every draw.
+    */
+    if(!render_pool){
+        return NULL;
+    }
+    gint64 start_time = g_get_monotonic_time();
+    RenderWait wait;
+    g_mutex_init(&wait.mutex);
+    g_cond_init(&wait.cond);
+    wait.is_done = FALSE;
+    RenderJob *job = render_job_new(RenderPriorityVisible,
+                                    NULL,
+                                    render,
+                                    NULL,
+                                    data,
+                                    NULL);
+    job->wait = &wait;
+    g_mutex_lock(&wait.mutex);
+    g_thread_pool_push(render_pool,
+                       job,
+                       NULL);
+    while(!wait.is_done){
+        g_cond_wait(&wait.cond,
+                    &wait.mutex);
+    }
+    g_mutex_unlock(&wait.mutex);
+    g_mutex_clear(&wait.mutex);
+    g_cond_clear(&wait.cond);
+    cairo_surface_t *surface = job->surface;
+    g_free(job);
+    G_LOCK(render_stats);
+    num_sync_waits++;
+    sync_wait_time_us += g_get_monotonic_time() - start_time;
+    G_UNLOCK(render_stats);
+    return surface;
+}
+
+void
+render_pool_dump_stats(void)
+{
+    static const char *class_names[] = {"visible", "next", "prefetch", "thumbnail"};
+    G_LOCK(render_stats);
+    for(int i = 0; i < RenderPriorityCount; i++){
+        g_print("render pool %s: %" G_GUINT64_FORMAT " rendered, %.1fms, "
+                "%" G_GUINT64_FORMAT " cancelled, %" G_GUINT64_FORMAT " dropped\n",
+                class_names[i],
+                num_rendered_jobs[i],
+                render_time_us[i] / 1000.0,
+                num_cancelled_jobs[i],
+                num_dropped_results[i]);
+    }
+    g_print("render pool waits: %" G_GUINT64_FORMAT ", %.1fms\n",
+            num_sync_waits,
+            sync_wait_time_us / 1000.0);
+    G_UNLOCK(render_stats);
+}
@@ -0,0 +1,70 @@
+/*
+ * Copyright © 2020 Reza Hasanzadeh
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 3.0 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef RENDER_POOL_H
+#define RENDER_POOL_H
+
+#include <glib.h>
+#include <cairo.h>
+#include <poppler/glib/poppler.h>
+
+/* the sooner the user sees the result, the higher the class */
+enum RenderPriority
+{
+    RenderPriorityVisible = 0,
+    RenderPriorityNext,
+    RenderPriorityPrefetch,
+    RenderPriorityThumbnail,
+    RenderPriorityCount
+};
+
+/*
+   runs on a worker with a document of its own, returns the rendered surface
+   or NULL.
+*/
+typedef cairo_surface_t *(*RenderFunc)(PopplerDocument *document,
+                                       gpointer         data);
+
+/* runs on the main thread and takes the surface, which may be NULL */
+typedef void (*RenderDoneFunc)(cairo_surface_t *surface,
+                               gpointer         data);
+
+gboolean
+render_pool_open(const char *filename);
+
+void
+render_pool_close(void);
+
+gboolean
+render_pool_is_open(void);
+
+void
+render_pool_submit(enum RenderPriority  priority,
+                   gint                *generation,
+                   RenderFunc           render,
+                   RenderDoneFunc       done,
+                   gpointer             data,
+                   GDestroyNotify       data_free);
+
+cairo_surface_t *
+render_pool_render_sync(RenderFunc render,
+                        gpointer   data);
+
+void
+render_pool_dump_stats(void);
+
+#endif
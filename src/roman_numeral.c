@@ -17,6 +17,7 @@
  */
 
 #include "roman_numeral.h"
+#include "regex_registry.h"
 
 static const int ROMAN_ZOO_MAX = 100;
 
@@ -30,7 +31,7 @@ static char *ROMAN_ZOO[] = {
     "LX","LXI", "LXII", "LXIII", "LXIV", "LXV", "LXVI", "LXVII", "LXVIII", "LXIX",
     "LXX", "LXXI", "LXXII", "LXXIII", "LXXIV", "LXXV", "LXXVI", "LXXVII", "LXXVIII", "LXXIX", 
     "LXXX", "LXXXI", "LXXXII", "LXXXIII", "LXXXIV", "LXXXV", "LXXXVI", "LXXXVII", "LXXXVIII", "LXXXIX", 
-    "XCI", "XCII", "XCIII", "XCIV", "XCV", "XCVI", "XCVII", "XCVIII", "XCIX", "XCX",
+    "XC", "XCI", "XCII", "XCIII", "XCIV", "XCV", "XCVI", "XCVII", "XCVIII", "XCIX",
     "C"
 }; 
 
@@ -40,7 +41,7 @@ roman_is_valid(const char *roman)
     if(!roman){
         return FALSE;
     }
-    return g_regex_match_simple(
+    return regex_registry_match_simple(
         "^M{0,3}(CM|CD|D?C{0,3})(XC|XL|L?X{0,3})(IX|IV|V?I{0,3})$",
         roman,
         G_REGEX_CASELESS,
@@ -56,26 +57,39 @@ roman_from_decimal(int decimal)
     return ROMAN_ZOO[decimal - 1];
 }
 
+static int
+roman_digit_value(char digit)
+{
+    switch(g_ascii_toupper(digit)){
+        case 'I': return 1;
+        case 'V': return 5;
+        case 'X': return 10;
+        case 'L': return 50;
+        case 'C': return 100;
+        case 'D': return 500;
+        case 'M': return 1000;
+        default: return 0;
+    }
+}
+
 int
 roman_to_decimal(const char *roman)
 {
     if(!roman_is_valid(roman)){
         return -1;
     }
-    char *roman_pattern = g_strdup_printf("^%s$",
-                                          roman);
+    /* a digit followed by a greater one is subtracted: XIV > 10 - 1 + 5 */
     int decimal = 0;
-    for(; decimal < ROMAN_ZOO_MAX; decimal++){
-        if(g_regex_match_simple(roman_pattern,
-                                ROMAN_ZOO[decimal],
-                                G_REGEX_CASELESS,
-                                0))
-        {
-            break;
+    for(const char *p = roman; *p; p++){
+        int value = roman_digit_value(*p);
+        if(value < roman_digit_value(p[1])){
+            decimal -= value;
+        }
+        else{
+            decimal += value;
         }
     }
-    g_free(roman_pattern);
-    return decimal < ROMAN_ZOO_MAX ? decimal + 1 : -1;
+    return decimal <= ROMAN_ZOO_MAX ? decimal : -1;
 }
 
 const char *
@@ -91,11 +105,11 @@ roman_previous(const char *roman)
 const char *
 roman_next(const char *roman)
 {
-    int decimal = roman_to_decimal(roman) + 1;
-    if(decimal > ROMAN_ZOO_MAX){
+    int decimal = roman_to_decimal(roman);
+    if(decimal < 0 || decimal + 1 > ROMAN_ZOO_MAX){
         return NULL;
     }
-    return ROMAN_ZOO[decimal - 1];
+    return ROMAN_ZOO[decimal];
 }
 
 int 
@@ -0,0 +1,238 @@
+/*
+ * Copyright © 2020 Reza Hasanzadeh
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 3.0 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "surface_pool.h"
+#include <string.h>
+
+/*
+   image surfaces whose pixel buffers are recycled. a buffer goes back to the
+   pool when the last reference to its surface is dropped, so callers just
+   cairo_surface_destroy() as usual. buffers are bucketed by size classes an
+   eighth of a power of two apart, a surface may take a buffer up to two
+   classes larger than it needs. safe to use from any thread.
+*/
+
+#define MAX_IDLE_SIZE (64 * 1024 * 1024)
+#define CLASS_STEPS 8
+#define MAX_CLASS_SKIP 2
+#define MEBIBYTE (1024.0 * 1024.0)
+
+typedef struct
+{
+    gsize size;
+    unsigned char *data;
+}PoolBuffer;
+
+G_LOCK_DEFINE_STATIC(pool);
+/* class size > GSList of PoolBuffer, most recently released first */
+static GHashTable *buckets = NULL;
+static gsize idle_size = 0;
+static gsize live_size = 0;
+static gsize peak_live_size = 0;
+static guint64 num_requests = 0;
+static guint64 num_reuses = 0;
+static cairo_user_data_key_t buffer_key;
+
+static gsize
+class_size(gsize size)
+{
+    /* rounds up to the next eighth of the enclosing power of two */
+    gsize power = 1;
+    while(power * 2 <= size){
+        power *= 2;
+    }
+    gsize step = MAX(power / CLASS_STEPS, 1);
+    return (size + step - 1) / step * step;
+}
+
+static gsize
+next_class_size(gsize size)
+{
+    return class_size(size + 1);
+}
+
+static void
+pool_buffer_free(PoolBuffer *buffer)
+{
+    g_free(buffer->data);
+    g_free(buffer);
+}
+
+static void
+release_buffer(void *data)
+{
+    PoolBuffer *buffer = data;
+    G_LOCK(pool);
+    live_size -= buffer->size;
+    if(!buckets || idle_size + buffer->size > MAX_IDLE_SIZE){
+        G_UNLOCK(pool);
+        pool_buffer_free(buffer);
+        return;
+    }
+    gpointer key = GSIZE_TO_POINTER(buffer->size);
+    GSList *list = g_hash_table_lookup(buckets,
+                                       key);
+    g_hash_table_insert(buckets,
+                        key,
+                        g_slist_prepend(list,
+                                        buffer));
+    idle_size += buffer->size;
+    G_UNLOCK(pool);
+}
+
+static PoolBuffer *
+take_buffer(gsize size)
+{
+    /* pool is locked */
+    gsize wanted_size = class_size(size);
+    gsize candidate_size = wanted_size;
+    for(int i = 0; i <= MAX_CLASS_SKIP; i++){
+        gpointer key = GSIZE_TO_POINTER(candidate_size);
+        GSList *list = g_hash_table_lookup(buckets,
+                                           key);
+        if(list){
+            PoolBuffer *buffer = list->data;
+            g_hash_table_insert(buckets,
+                                key,
+                                g_slist_delete_link(list,
+                                                    list));
+            idle_size -= buffer->size;
+            num_reuses++;
+            return buffer;
+        }
+        candidate_size = next_class_size(candidate_size);
+    }
+    PoolBuffer *buffer = g_malloc(sizeof(PoolBuffer));
+    buffer->size = wanted_size;
+    buffer->data = NULL;
+    return buffer;
+}
+
+cairo_surface_t *
+surface_pool_create(cairo_format_t format,
+                    int            width,
+                    int            height,
+                    gboolean       is_cleared)
+{
+    /*
+       a drop-in for cairo_image_surface_create(), which always clears. pass
+       'is_cleared' FALSE when every pixel is painted over anyway.
+    */
+    int stride = cairo_format_stride_for_width(format,
+                                               width);
+    if(stride <= 0 || width <= 0 || height <= 0){
+        return cairo_image_surface_create(format,
+                                          width,
+                                          height);
+    }
+    gsize size = (gsize)stride * height;
+    G_LOCK(pool);
+    if(!buckets){
+        buckets = g_hash_table_new(g_direct_hash,
+                                   g_direct_equal);
+    }
+    num_requests++;
+    PoolBuffer *buffer = take_buffer(size);
+    live_size += buffer->size;
+    peak_live_size = MAX(peak_live_size, live_size);
+    G_UNLOCK(pool);
+    if(!buffer->data){
+        /* fresh memory, cleared by the allocator */
+        buffer->data = g_malloc0(buffer->size);
+    }
+    else if(is_cleared){
+        memset(buffer->data,
+               0,
+               size);
+    }
+    cairo_surface_t *surface = cairo_image_surface_create_for_data(buffer->data,
+                                                                   format,
+                                                                   width,
+                                                                   height,
+                                                                   stride);
+    if(cairo_surface_status(surface) != CAIRO_STATUS_SUCCESS ||
+       cairo_surface_set_user_data(surface,
+                                   &buffer_key,
+                                   buffer,
+                                   release_buffer) != CAIRO_STATUS_SUCCESS)
+    {
+        cairo_surface_destroy(surface);
+        release_buffer(buffer);
+        return cairo_image_surface_create(format,
+                                          width,
+                                          height);
+    }
+    return surface;
+}
+
+void
+surface_pool_trim(gsize max_idle_size)
+{
+    G_LOCK(pool);
+    if(!buckets){
+        G_UNLOCK(pool);
+        return;
+    }
+    GHashTableIter iter;
+    gpointer key, value;
+    g_hash_table_iter_init(&iter, buckets);
+    while(idle_size > max_idle_size && g_hash_table_iter_next(&iter, &key, &value)){
+        GSList *list = value;
+        while(list && idle_size > max_idle_size){
+            PoolBuffer *buffer = list->data;
+            idle_size -= buffer->size;
+            pool_buffer_free(buffer);
+            list = g_slist_delete_link(list,
+                                       list);
+        }
+        if(list){
+            g_hash_table_iter_replace(&iter,
+                                      list);
+        }
+        else{
+            g_hash_table_iter_remove(&iter);
+        }
+    }
+    G_UNLOCK(pool);
+}
+
+void
+surface_pool_module_destroy(void)
+{
+    surface_pool_trim(0);
+    G_LOCK(pool);
+    if(buckets){
+        /* live surfaces free their buffers on release from now on */
+        g_hash_table_unref(buckets);
+        buckets = NULL;
+    }
+    G_UNLOCK(pool);
+}
+
+void
+surface_pool_dump_stats(void)
+{
+    G_LOCK(pool);
+    g_print("surface pool: %" G_GUINT64_FORMAT " surfaces(%" G_GUINT64_FORMAT " reused), "
+            "%.1f MiB live(%.1f MiB peak), %.1f MiB idle\n",
+            num_requests,
+            num_reuses,
+            live_size / MEBIBYTE,
+            peak_live_size / MEBIBYTE,
+            idle_size / MEBIBYTE);
+    G_UNLOCK(pool);
+}
@@ -0,0 +1,39 @@
+/*
+ * Copyright © 2020 Reza Hasanzadeh
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 3.0 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef SURFACE_POOL_H
+#define SURFACE_POOL_H
+
+#include <glib.h>
+#include <cairo.h>
+
+void
+surface_pool_module_destroy(void);
+
+cairo_surface_t *
+surface_pool_create(cairo_format_t format,
+                    int            width,
+                    int            height,
+                    gboolean       is_cleared);
+
+void
+surface_pool_trim(gsize max_idle_size);
+
+void
+surface_pool_dump_stats(void);
+
+#endif
@@ -0,0 +1,405 @@
+/*
+ * Copyright © 2020 Reza Hasanzadeh
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 3.0 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "teleport_index.h"
+#include <string.h>
+
+static char *
+fold_text(const char *text)
+{
+    /*
+       casefold and decompose text, keep alphanumerics and dots and separate
+       words by a single space.
+       'Chapter 12: Homology' > 'chapter 12 homology'
+    */
+    char *normalized = g_utf8_normalize(text,
+                                        -1,
+                                        G_NORMALIZE_ALL);
+    if(!normalized){
+        return g_strdup("");
+    }
+    char *casefolded = g_utf8_casefold(normalized,
+                                       -1);
+    g_free(normalized);
+    GString *folded = g_string_new(NULL);
+    gboolean is_space_pending = FALSE;
+    const char *p = casefolded;
+    while(*p){
+        gunichar c = g_utf8_get_char(p);
+        if(g_unichar_isalnum(c) || c == '.'){
+            if(is_space_pending && folded->len > 0){
+                folded = g_string_append_c(folded,
+                                           ' ');
+            }
+            is_space_pending = FALSE;
+            folded = g_string_append_unichar(folded,
+                                             c);
+        }
+        else if(!g_unichar_ismark(c)){
+            /* combining marks are left over by decomposition, drop them */
+            is_space_pending = TRUE;
+        }
+        p = g_utf8_next_char(p);
+    }
+    g_free(casefolded);
+    return g_string_free(folded,
+                         FALSE);
+}
+
+static guint
+pack_trigram(const char *s)
+{
+    return ((guint)(guchar)s[0] << 16) |
+           ((guint)(guchar)s[1] << 8) |
+           (guint)(guchar)s[2];
+}
+
+static char *
+make_exact_key(const char *tag,
+               const char *folded)
+{
+    return g_strconcat(tag ? tag : "", "\x1f", folded, NULL);
+}
+
+static void
+target_free(TeleportTarget *target)
+{
+    g_free(target->text);
+    g_free(target->tag);
+    g_free(target->folded);
+    g_strfreev(target->words);
+    g_free(target);
+}
+
+TeleportIndex *
+teleport_index_new(void)
+{
+    TeleportIndex *index = g_malloc(sizeof(TeleportIndex));
+    index->targets = g_ptr_array_new_with_free_func((GDestroyNotify)target_free);
+    index->trigrams = g_hash_table_new_full(g_direct_hash,
+                                            g_direct_equal,
+                                            NULL,
+                                            (GDestroyNotify)g_array_unref);
+    index->exact = g_hash_table_new_full(g_str_hash,
+                                         g_str_equal,
+                                         g_free,
+                                         NULL);
+    return index;
+}
+
+void
+teleport_index_free(TeleportIndex *index)
+{
+    if(!index){
+        return;
+    }
+    g_hash_table_unref(index->exact);
+    g_hash_table_unref(index->trigrams);
+    g_ptr_array_unref(index->targets);
+    g_free(index);
+}
+
+void
+teleport_index_add(TeleportIndex *index,
+                   const char    *text,
+                   const char    *tag,
+                   gpointer       data)
+{
+    if(!text){
+        return;
+    }
+    TeleportTarget *target = g_malloc(sizeof(TeleportTarget));
+    target->text = g_strdup(text);
+    target->tag = g_strdup(tag);
+    target->folded = fold_text(text);
+    target->words = g_strsplit(target->folded,
+                               " ",
+                               -1);
+    target->data = data;
+    guint target_index = index->targets->len;
+    g_ptr_array_add(index->targets,
+                    target);
+    /* trigrams never cross word boundaries */
+    char **word_p = target->words;
+    while(*word_p){
+        size_t len = strlen(*word_p);
+        for(size_t i = 0; i + 3 <= len; i++){
+            gpointer key = GUINT_TO_POINTER(pack_trigram(*word_p + i));
+            GArray *postings = g_hash_table_lookup(index->trigrams,
+                                                   key);
+            if(!postings){
+                postings = g_array_new(FALSE,
+                                       FALSE,
+                                       sizeof(guint));
+                g_hash_table_insert(index->trigrams,
+                                    key,
+                                    postings);
+            }
+            if(postings->len == 0 ||
+               g_array_index(postings, guint, postings->len - 1) != target_index)
+            {
+                g_array_append_val(postings,
+                                   target_index);
+            }
+        }
+        word_p++;
+    }
+    char *exact_key = make_exact_key(tag,
+                                     target->folded);
+    if(g_hash_table_contains(index->exact,
+                             exact_key))
+    {
+        g_free(exact_key);
+    }
+    else{
+        g_hash_table_insert(index->exact,
+                            exact_key,
+                            target);
+    }
+}
+
+static gboolean
+is_subsequence(const char *needle,
+               const char *haystack)
+{
+    while(*needle && *haystack){
+        if(*needle == *haystack){
+            needle++;
+        }
+        haystack++;
+    }
+    return *needle == '\0';
+}
+
+static double
+score_target(const TeleportTarget *target,
+             char                **query_words,
+             int                   num_query_words,
+             const char           *query_folded)
+{
+    /*
+       every query word has to hit the target, either as a prefix of one of
+       its words(best), a substring of one of its words or as a subsequence
+       of the whole target(worst). words hit in order score a bit higher.
+       'ch 12 homol' > 'chapter 12 homology'
+    */
+    if(strcmp(target->folded, query_folded) == 0){
+        return 100.0;
+    }
+    double score = 0.0;
+    int cursor = 0;
+    for(int qi = 0; qi < num_query_words; qi++){
+        const char *query_word = query_words[qi];
+        double best = 0.0;
+        int best_wi = -1;
+        for(int wi = 0; target->words[wi]; wi++){
+            const char *word = target->words[wi];
+            double s = 0.0;
+            if(g_str_has_prefix(word,
+                                query_word))
+            {
+                s = strcmp(word, query_word) == 0 ? 4.0 : 3.0;
+            }
+            else if(strstr(word,
+                           query_word))
+            {
+                s = 2.0;
+            }
+            if(s > 0.0 && wi >= cursor){
+                s += 0.5;
+            }
+            if(s > best){
+                best = s;
+                best_wi = wi;
+            }
+        }
+        if(best_wi < 0){
+            if(!is_subsequence(query_word,
+                               target->folded))
+            {
+                return 0.0;
+            }
+            best = 1.0;
+        }
+        else{
+            cursor = best_wi + 1;
+        }
+        score += best;
+    }
+    /* among equals, shorter targets win */
+    return score / num_query_words +
+           1.0 / (1.0 + strlen(target->folded) / 32.0);
+}
+
+static int
+compare_teleport_matches(const void *a,
+                         const void *b)
+{
+    const TeleportMatch *match_a = a;
+    const TeleportMatch *match_b = b;
+    if(match_a->score > match_b->score){
+        return -1;
+    }
+    if(match_a->score < match_b->score){
+        return +1;
+    }
+    return 0;
+}
+
+static void
+score_candidate(const TeleportIndex *index,
+                guint                target_index,
+                const char          *tag,
+                char               **query_words,
+                int                  num_query_words,
+                const char          *query_folded,
+                GArray              *matches)
+{
+    const TeleportTarget *target = g_ptr_array_index(index->targets,
+                                                     target_index);
+    if(tag && g_strcmp0(target->tag, tag) != 0){
+        return;
+    }
+    double score = score_target(target,
+                                query_words,
+                                num_query_words,
+                                query_folded);
+    if(score > 0.0){
+        TeleportMatch match = {target, score};
+        g_array_append_val(matches,
+                           match);
+    }
+}
+
+GArray *
+teleport_index_query(const TeleportIndex *index,
+                     const char          *query,
+                     const char          *tag,
+                     int                  max_results)
+{
+    /*
+       rank targets against the query. candidates are the targets sharing at
+       least a trigram with the query; queries without trigrams, or whose
+       trigrams hit nothing(e.g. subsequences), fall back to a full scan.
+       results are sorted by descending score.
+    */
+    GArray *matches = g_array_new(FALSE,
+                                  FALSE,
+                                  sizeof(TeleportMatch));
+    if(!index || !query){
+        return matches;
+    }
+    char *query_folded = fold_text(query);
+    char **query_words = g_strsplit(query_folded,
+                                    " ",
+                                    -1);
+    int num_query_words = g_strv_length(query_words);
+    if(num_query_words == 0){
+        g_strfreev(query_words);
+        g_free(query_folded);
+        return matches;
+    }
+    guint num_targets = index->targets->len;
+    gboolean *is_candidate = g_new0(gboolean, num_targets);
+    gboolean has_trigrams = FALSE;
+    for(int qi = 0; qi < num_query_words; qi++){
+        size_t len = strlen(query_words[qi]);
+        for(size_t i = 0; i + 3 <= len; i++){
+            has_trigrams = TRUE;
+            GArray *postings = g_hash_table_lookup(index->trigrams,
+                                                   GUINT_TO_POINTER(pack_trigram(query_words[qi] + i)));
+            if(!postings){
+                continue;
+            }
+            for(guint pi = 0; pi < postings->len; pi++){
+                is_candidate[g_array_index(postings, guint, pi)] = TRUE;
+            }
+        }
+    }
+    if(has_trigrams){
+        for(guint ti = 0; ti < num_targets; ti++){
+            if(is_candidate[ti]){
+                score_candidate(index,
+                                ti,
+                                tag,
+                                query_words,
+                                num_query_words,
+                                query_folded,
+                                matches);
+            }
+        }
+    }
+    if(matches->len == 0){
+        for(guint ti = 0; ti < num_targets; ti++){
+            if(has_trigrams && is_candidate[ti]){
+                continue;
+            }
+            score_candidate(index,
+                            ti,
+                            tag,
+                            query_words,
+                            num_query_words,
+                            query_folded,
+                            matches);
+        }
+    }
+    g_free(is_candidate);
+    g_strfreev(query_words);
+    g_free(query_folded);
+    g_array_sort(matches,
+                 compare_teleport_matches);
+    if(max_results > 0 && matches->len > max_results){
+        g_array_set_size(matches,
+                         max_results);
+    }
+    return matches;
+}
+
+const TeleportTarget *
+teleport_index_lookup_exact(const TeleportIndex *index,
+                            const char          *query,
+                            const char          *tag)
+{
+    if(!index || !query){
+        return NULL;
+    }
+    char *query_folded = fold_text(query);
+    char *exact_key = make_exact_key(tag,
+                                     query_folded);
+    const TeleportTarget *target = g_hash_table_lookup(index->exact,
+                                                       exact_key);
+    g_free(exact_key);
+    g_free(query_folded);
+    return target;
+}
+
+const TeleportTarget *
+teleport_index_lookup_best(const TeleportIndex *index,
+                           const char          *query,
+                           const char          *tag)
+{
+    GArray *matches = teleport_index_query(index,
+                                           query,
+                                           tag,
+                                           1);
+    const TeleportTarget *target = NULL;
+    if(matches->len > 0){
+        target = g_array_index(matches, TeleportMatch, 0).target;
+    }
+    g_array_unref(matches);
+    return target;
+}
@@ -0,0 +1,75 @@
+/*
+ * Copyright © 2020 Reza Hasanzadeh
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 3.0 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef TELEPORT_INDEX_H
+#define TELEPORT_INDEX_H
+
+#include <glib.h>
+
+typedef struct
+{
+    char *text;
+    char *tag;
+    char *folded;
+    char **words;
+    gpointer data;
+}TeleportTarget;
+
+typedef struct
+{
+    const TeleportTarget *target;
+    double score;
+}TeleportMatch;
+
+typedef struct
+{
+    GPtrArray *targets;
+    /* packed trigram > GArray of target indices */
+    GHashTable *trigrams;
+    /* folded text > first target with that text */
+    GHashTable *exact;
+}TeleportIndex;
+
+TeleportIndex *
+teleport_index_new(void);
+
+void
+teleport_index_free(TeleportIndex *index);
+
+void
+teleport_index_add(TeleportIndex *index,
+                   const char    *text,
+                   const char    *tag,
+                   gpointer       data);
+
+GArray *
+teleport_index_query(const TeleportIndex *index,
+                     const char          *query,
+                     const char          *tag,
+                     int                  max_results);
+
+const TeleportTarget *
+teleport_index_lookup_exact(const TeleportIndex *index,
+                            const char          *query,
+                            const char          *tag);
+
+const TeleportTarget *
+teleport_index_lookup_best(const TeleportIndex *index,
+                           const char          *query,
+                           const char          *tag);
+
+#endif
@@ -17,10 +17,13 @@
 
 #include "teleport_widget.h"
 
+#define MAX_COMPLETIONS 64
+
 static GtkWidget *teleport_window = NULL;
 static GtkWidget *text_entry = NULL;
 static GtkEntryCompletion *entry_completion = NULL;
 static GtkWidget *teleport_button = NULL;
+static const TeleportIndex *completion_index = NULL;
 
 void
 teleport_widget_hide(void)
@@ -85,6 +88,47 @@ key_press_callback(GtkWidget   *widget,
     return handled;
 }
 
+static gboolean
+completion_match_func(GtkEntryCompletion *completion,
+                      const char         *key,
+                      GtkTreeIter        *iter,
+                      gpointer            user_data)
+{
+    /* the model only ever holds ranked matches of the current text */
+    return TRUE;
+}
+
+static void
+on_text_entry_changed(GtkEditable *editable,
+                      gpointer     user_data)
+{
+    /*
+       refill the completion model with the best ranked targets, the
+       completion only shows rows in model order.
+    */
+    GtkListStore *list_store = GTK_LIST_STORE(gtk_entry_completion_get_model(entry_completion));
+    gtk_list_store_clear(list_store);
+    if(!completion_index){
+        return;
+    }
+    const char *text = gtk_entry_get_text(GTK_ENTRY(text_entry));
+    GArray *matches = teleport_index_query(completion_index,
+                                           text,
+                                           NULL,
+                                           MAX_COMPLETIONS);
+    for(guint i = 0; i < matches->len; i++){
+        const TeleportTarget *target = g_array_index(matches, TeleportMatch, i).target;
+        GtkTreeIter iter;
+        gtk_list_store_append(list_store,
+                              &iter);
+        gtk_list_store_set(list_store, &iter,
+                           0, target->text,
+                           1, target->tag,
+                           -1);
+    }
+    g_array_unref(matches);
+}
+
 static void
 setup_text_entry_completion(void)
 {
@@ -115,6 +159,12 @@ setup_text_entry_completion(void)
                                    GTK_TREE_MODEL(list_store));
     gtk_entry_completion_set_text_column(entry_completion,
                                          VALUE_COLUMN);
+    gtk_entry_completion_set_match_func(entry_completion,
+                                        completion_match_func,
+                                        NULL,
+                                        NULL);
+    g_signal_connect(G_OBJECT(text_entry), "changed",
+                     G_CALLBACK(on_text_entry_changed), NULL);
 
     gtk_entry_set_completion(GTK_ENTRY(text_entry),
                              entry_completion);
@@ -207,23 +257,12 @@ teleport_widget_destroy_text_completions(void)
 {
     GtkListStore *list_store = GTK_LIST_STORE(gtk_entry_completion_get_model(entry_completion));
     gtk_list_store_clear(list_store);
+    completion_index = NULL;
 }
 
 void
-teleport_widget_update_text_completions(GList *text_list,
-                                        char *tag)
+teleport_widget_set_completion_index(const TeleportIndex *index)
 {
-    GtkListStore *list_store = GTK_LIST_STORE(gtk_entry_completion_get_model(entry_completion));
-    GList *text_p = text_list;
-    while(text_p){
-        char *text = text_p->data;
-        GtkTreeIter iter;
-        gtk_list_store_append(list_store,
-                              &iter);
-        gtk_list_store_set(list_store, &iter,
-                           0, text,
-                           1, tag,
-                           -1);
-        text_p = text_p->next;
-    }
-}
\ No newline at end of file
+    /* the index is owned by the document */
+    completion_index = index;
+}
@@ -19,6 +19,7 @@
 #define TELEPORT_WIDGET_H
 
 #include <gtk/gtk.h>
+#include "teleport_index.h"
 
 void
 teleport_widget_show(void);
@@ -37,7 +38,6 @@ void
 teleport_widget_destroy_text_completions(void);
 
 void
-teleport_widget_update_text_completions(GList *text_list,
-                                        char  *tag);
+teleport_widget_set_completion_index(const TeleportIndex *index);
 
 #endif
\ No newline at end of file
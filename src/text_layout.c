@@ -0,0 +1,149 @@
+/*
+ * Copyright © 2020 Reza Hasanzadeh
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 3.0 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "text_layout.h"
+#include <math.h>
+
+/* characters of a line are within this fraction of the mean height */
+#define LINE_CENTER_TOLERANCE 0.01
+
+TextLayout *
+text_layout_new(const PopplerRectangle *rects,
+                unsigned int            length)
+{
+    /*
+       the coordinates go into four float arrays that share one allocation,
+       instead of a heap-allocated Rect per character.
+    */
+    TextLayout *layout = g_malloc(sizeof(TextLayout));
+    layout->length = length;
+    layout->x1 = g_new(float, length * 4);
+    layout->y1 = layout->x1 + length;
+    layout->x2 = layout->y1 + length;
+    layout->y2 = layout->x2 + length;
+    layout->mean_height = 0.0;
+    for(unsigned int i = 0; i < length; i++){
+        layout->x1[i] = MIN(rects[i].x1, rects[i].x2);
+        layout->y1[i] = MIN(rects[i].y1, rects[i].y2);
+        layout->x2[i] = MAX(rects[i].x1, rects[i].x2);
+        layout->y2[i] = MAX(rects[i].y1, rects[i].y2);
+        layout->mean_height += layout->y2[i] - layout->y1[i];
+    }
+    if(length > 0){
+        layout->mean_height /= length;
+    }
+    /* lines */
+    GArray *lines = g_array_new(FALSE,
+                                FALSE,
+                                sizeof(TextLayoutLine));
+    const double tolerance = layout->mean_height * LINE_CENTER_TOLERANCE;
+    TextLayoutLine *line = NULL;
+    for(unsigned int i = 0; i < length; i++){
+        float center_y = (layout->y1[i] + layout->y2[i]) / 2;
+        if(line && fabs(center_y - line->center_y) <= tolerance){
+            line->min_x1 = MIN(line->min_x1, layout->x1[i]);
+            line->max_x1 = MAX(line->max_x1, layout->x1[i]);
+            continue;
+        }
+        TextLayoutLine new_line = {i, center_y, layout->x1[i], layout->x1[i]};
+        g_array_append_val(lines,
+                           new_line);
+        line = &g_array_index(lines, TextLayoutLine, lines->len - 1);
+    }
+    layout->num_lines = lines->len;
+    layout->lines = (TextLayoutLine *)g_array_free(lines,
+                                                   FALSE);
+    return layout;
+}
+
+void
+text_layout_free(TextLayout *layout)
+{
+    if(!layout){
+        return;
+    }
+    g_free(layout->x1);
+    g_free(layout->lines);
+    g_free(layout);
+}
+
+gsize
+text_layout_size(const TextLayout *layout)
+{
+    if(!layout){
+        return 0;
+    }
+    return sizeof(TextLayout) +
+           sizeof(float) * layout->length * 4 +
+           sizeof(TextLayoutLine) * layout->num_lines;
+}
+
+Rect
+text_layout_get(const TextLayout *layout,
+                unsigned int      index)
+{
+    Rect rect;
+    rect.x1 = layout->x1[index];
+    rect.y1 = layout->y1[index];
+    rect.x2 = layout->x2[index];
+    rect.y2 = layout->y2[index];
+    return rect;
+}
+
+double
+text_layout_center_x(const TextLayout *layout,
+                     unsigned int      index)
+{
+    return (layout->x1[index] + layout->x2[index]) / 2;
+}
+
+double
+text_layout_center_y(const TextLayout *layout,
+                     unsigned int      index)
+{
+    return (layout->y1[index] + layout->y2[index]) / 2;
+}
+
+gboolean
+text_layout_line_extent(const TextLayout *layout,
+                        double            center_y,
+                        double            tolerance,
+                        double           *min_x1,
+                        double           *max_x1)
+{
+    /*
+       horizontal extent, by left edges, of the characters whose Y-center is
+       within 'tolerance' of 'center_y'. only the lines are visited.
+    */
+    gboolean is_found = FALSE;
+    for(unsigned int l = 0; l < layout->num_lines; l++){
+        const TextLayoutLine *line = &layout->lines[l];
+        if(fabs(line->center_y - center_y) >= tolerance){
+            continue;
+        }
+        if(!is_found){
+            *min_x1 = line->min_x1;
+            *max_x1 = line->max_x1;
+            is_found = TRUE;
+        }
+        else{
+            *min_x1 = MIN(*min_x1, line->min_x1);
+            *max_x1 = MAX(*max_x1, line->max_x1);
+        }
+    }
+    return is_found;
+}
@@ -0,0 +1,76 @@
+/*
+ * Copyright © 2020 Reza Hasanzadeh
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 3.0 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef TEXT_LAYOUT_H
+#define TEXT_LAYOUT_H
+
+#include <gmodule.h>
+#include <poppler/glib/poppler.h>
+#include "rect.h"
+
+/* consecutive characters sharing a Y-center, roughly a line of text */
+typedef struct
+{
+    unsigned int start;
+    float center_y;
+    float min_x1;
+    float max_x1;
+}TextLayoutLine;
+
+/* per-character boxes of a page, one per character of its text */
+typedef struct
+{
+    unsigned int length;
+    float *x1;
+    float *y1;
+    float *x2;
+    float *y2;
+    unsigned int num_lines;
+    TextLayoutLine *lines;
+    double mean_height;
+}TextLayout;
+
+TextLayout *
+text_layout_new(const PopplerRectangle *rects,
+                unsigned int            length);
+
+void
+text_layout_free(TextLayout *layout);
+
+gsize
+text_layout_size(const TextLayout *layout);
+
+Rect
+text_layout_get(const TextLayout *layout,
+                unsigned int      index);
+
+double
+text_layout_center_x(const TextLayout *layout,
+                     unsigned int      index);
+
+double
+text_layout_center_y(const TextLayout *layout,
+                     unsigned int      index);
+
+gboolean
+text_layout_line_extent(const TextLayout *layout,
+                        double            center_y,
+                        double            tolerance,
+                        double           *min_x1,
+                        double           *max_x1);
+
+#endif
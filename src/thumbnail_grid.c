@@ -0,0 +1,610 @@
+/*
+ * Copyright © 2020 Reza Hasanzadeh
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 3.0 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "thumbnail_grid.h"
+#include <stdio.h>
+#include <string.h>
+#include <glib/gstdio.h>
+#include <pango/pangocairo.h>
+
+/* rows whose thumbnails are made before they scroll into view */
+#define PREFETCH_ROWS 2
+/* thumbnails kept in memory, the ones farthest from view go first */
+#define MAX_CACHED_THUMBNAILS 256
+/* bytes read from each end of the file for its key */
+#define KEY_SAMPLE_SIZE (64 * 1024)
+/* per cache directory, the least recently used files go first */
+#define MAX_CACHE_SIZE (64 * 1024 * 1024)
+#define MAX_CACHE_AGE_DAYS 30
+
+typedef struct
+{
+    ThumbnailGrid *grid;
+    int index;
+    char *cache_path;
+    RenderFunc render;
+    gpointer data;
+    GDestroyNotify data_free;
+    /* set by the worker when the index was out of the wanted range */
+    gboolean is_skipped;
+}GridJob;
+
+typedef struct
+{
+    char *path;
+    gint64 size;
+    gint64 mtime;
+}CacheFile;
+
+static int
+compare_cache_files(gconstpointer a,
+                    gconstpointer b)
+{
+    /* newest first */
+    const CacheFile *file_a = *(const CacheFile **)a;
+    const CacheFile *file_b = *(const CacheFile **)b;
+    return file_a->mtime < file_b->mtime ? 1 : (file_a->mtime > file_b->mtime ? -1 : 0);
+}
+
+static void
+cache_file_free(CacheFile *file)
+{
+    g_free(file->path);
+    g_free(file);
+}
+
+static gpointer
+prune_cache(gpointer data)
+{
+    /*
+       own thread, takes cache_dir. drops thumbnails not used for
+       MAX_CACHE_AGE_DAYS, then the least recently used ones until the
+       directory fits in MAX_CACHE_SIZE. a thumbnail read from disk is
+       touched, so mtime is its last use.
+    */
+    char *cache_dir = data;
+    GDir *dir = g_dir_open(cache_dir,
+                           0,
+                           NULL);
+    if(!dir){
+        g_free(cache_dir);
+        return NULL;
+    }
+    gint64 oldest_mtime = g_get_real_time() / G_USEC_PER_SEC - MAX_CACHE_AGE_DAYS * 24 * 3600;
+    GPtrArray *files = g_ptr_array_new_with_free_func((GDestroyNotify)cache_file_free);
+    const char *name;
+    while((name = g_dir_read_name(dir))){
+        if(!g_str_has_suffix(name,
+                             ".png"))
+        {
+            continue;
+        }
+        char *path = g_build_filename(cache_dir,
+                                      name,
+                                      NULL);
+        GStatBuf st;
+        if(g_stat(path,
+                  &st) != 0)
+        {
+            g_free(path);
+            continue;
+        }
+        if(st.st_mtime < oldest_mtime){
+            g_remove(path);
+            g_free(path);
+            continue;
+        }
+        CacheFile *file = g_malloc(sizeof(CacheFile));
+        file->path = path;
+        file->size = st.st_size;
+        file->mtime = st.st_mtime;
+        g_ptr_array_add(files,
+                        file);
+    }
+    g_dir_close(dir);
+    g_ptr_array_sort(files,
+                     compare_cache_files);
+    gint64 total_size = 0;
+    for(guint i = 0; i < files->len; i++){
+        CacheFile *file = g_ptr_array_index(files,
+                                            i);
+        total_size += file->size;
+        if(total_size > MAX_CACHE_SIZE){
+            g_remove(file->path);
+        }
+    }
+    g_ptr_array_unref(files);
+    g_free(cache_dir);
+    return NULL;
+}
+
+void
+thumbnail_grid_init(ThumbnailGrid           *grid,
+                    GtkWidget               *widget,
+                    const ThumbnailGridMode *mode)
+{
+    memset(grid, 0, sizeof(ThumbnailGrid));
+    grid->mode = mode;
+    grid->widget = widget;
+    grid->last_wanted = -1;
+    grid->num_columns = 1;
+    grid->hovered_index = -1;
+    grid->scroll_target = -1;
+    grid->max_cached_thumbnails = MAX_CACHED_THUMBNAILS;
+    g_mutex_init(&grid->range_mutex);
+    grid->cache_dir = g_build_filename(g_get_user_cache_dir(),
+                                       "readaratus",
+                                       mode->cache_subdir,
+                                       NULL);
+    if(g_mkdir_with_parents(grid->cache_dir,
+                            0700) != 0)
+    {
+        g_print("Failed to create thumbnail cache '%s'.\n",
+                grid->cache_dir);
+        g_free(grid->cache_dir);
+        grid->cache_dir = NULL;
+    }
+    else{
+        g_thread_unref(g_thread_new("thumbnail cache pruner",
+                                    prune_cache,
+                                    g_strdup(grid->cache_dir)));
+    }
+    grid->thumbnails = g_hash_table_new_full(g_direct_hash,
+                                             g_direct_equal,
+                                             NULL,
+                                             (GDestroyNotify)cairo_surface_destroy);
+    grid->pending = g_hash_table_new(g_direct_hash,
+                                     g_direct_equal);
+}
+
+void
+thumbnail_grid_destroy(ThumbnailGrid *grid)
+{
+    thumbnail_grid_unload(grid);
+    g_hash_table_unref(grid->thumbnails);
+    g_hash_table_unref(grid->pending);
+    g_free(grid->cache_dir);
+    g_mutex_clear(&grid->range_mutex);
+    grid->thumbnails = NULL;
+    grid->pending = NULL;
+    grid->cache_dir = NULL;
+}
+
+static void
+set_wanted_range(ThumbnailGrid *grid,
+                 int            first,
+                 int            last)
+{
+    g_mutex_lock(&grid->range_mutex);
+    grid->first_wanted = first;
+    grid->last_wanted = last;
+    g_mutex_unlock(&grid->range_mutex);
+}
+
+static gboolean
+is_wanted(ThumbnailGrid *grid,
+          int            index)
+{
+    /* any thread */
+    g_mutex_lock(&grid->range_mutex);
+    gboolean is_in_range = index >= grid->first_wanted && index <= grid->last_wanted;
+    g_mutex_unlock(&grid->range_mutex);
+    return is_in_range;
+}
+
+static void
+grid_job_free(GridJob *job)
+{
+    if(job->data_free){
+        job->data_free(job->data);
+    }
+    g_free(job->cache_path);
+    g_free(job);
+}
+
+static void
+evict_thumbnails(ThumbnailGrid *grid)
+{
+    int first = grid->first_wanted,
+        last = grid->last_wanted;
+    while(g_hash_table_size(grid->thumbnails) > grid->max_cached_thumbnails){
+        GHashTableIter iter;
+        gpointer key, value;
+        int farthest_index = -1,
+            max_distance = -1;
+        g_hash_table_iter_init(&iter, grid->thumbnails);
+        while(g_hash_table_iter_next(&iter, &key, &value)){
+            int index = GPOINTER_TO_INT(key);
+            int distance = index < first ? first - index
+                                         : (index > last ? index - last : 0);
+            if(distance > max_distance){
+                max_distance = distance;
+                farthest_index = index;
+            }
+        }
+        if(max_distance <= 0){
+            /* everything cached is on screen */
+            break;
+        }
+        g_hash_table_remove(grid->thumbnails,
+                            GINT_TO_POINTER(farthest_index));
+    }
+}
+
+static void
+deliver_thumbnail(cairo_surface_t *thumbnail,
+                  gpointer         data)
+{
+    /* main thread, only called for the current generation */
+    const GridJob *job = data;
+    ThumbnailGrid *grid = job->grid;
+    g_hash_table_remove(grid->pending,
+                        GINT_TO_POINTER(job->index));
+    if(job->is_skipped && is_wanted(grid, job->index)){
+        /* scrolled back while the job was skipped, the next draw queues it again */
+        gtk_widget_queue_draw(grid->widget);
+    }
+    if(thumbnail){
+        g_hash_table_insert(grid->thumbnails,
+                            GINT_TO_POINTER(job->index),
+                            thumbnail);
+        evict_thumbnails(grid);
+        gtk_widget_queue_draw(grid->widget);
+    }
+}
+
+static cairo_surface_t *
+generate_thumbnail(PopplerDocument *document,
+                   gpointer         data)
+{
+    /* worker thread, only the grid's wanted range is read here */
+    GridJob *job = data;
+    if(!is_wanted(job->grid, job->index)){
+        job->is_skipped = TRUE;
+        return NULL;
+    }
+    if(job->cache_path){
+        cairo_surface_t *cached = cairo_image_surface_create_from_png(job->cache_path);
+        if(cairo_surface_status(cached) == CAIRO_STATUS_SUCCESS){
+            /* keeps it from being pruned */
+            g_utime(job->cache_path,
+                    NULL);
+            return cached;
+        }
+        cairo_surface_destroy(cached);
+    }
+    cairo_surface_t *thumbnail = job->render(document,
+                                             job->data);
+    if(thumbnail && job->cache_path){
+        /*
+           a job of a newer generation may be making the same thumbnail,
+           the file is swapped in whole so nobody reads half of it.
+        */
+        char *temp_path = g_strdup_printf("%s.%p.png",
+                                          job->cache_path,
+                                          (void *)g_thread_self());
+        if(cairo_surface_write_to_png(thumbnail,
+                                      temp_path) == CAIRO_STATUS_SUCCESS)
+        {
+            g_rename(temp_path,
+                     job->cache_path);
+        }
+        else{
+            g_remove(temp_path);
+        }
+        g_free(temp_path);
+    }
+    return thumbnail;
+}
+
+static char *
+make_document_key(const char *filename,
+                  int         thumbnail_size)
+{
+    /*
+       hashes the size, modification time and both ends of the file rather
+       than its path, a moved book keeps its thumbnails and an edited one
+       doesn't, even when the edit is in the middle and keeps the size.
+    */
+    GChecksum *checksum = g_checksum_new(G_CHECKSUM_SHA1);
+    FILE *file = g_fopen(filename,
+                         "rb");
+    if(file){
+        guchar *buffer = g_malloc(KEY_SAMPLE_SIZE);
+        size_t num_read = fread(buffer,
+                                1,
+                                KEY_SAMPLE_SIZE,
+                                file);
+        g_checksum_update(checksum,
+                          buffer,
+                          num_read);
+        if(fseek(file,
+                 -KEY_SAMPLE_SIZE,
+                 SEEK_END) == 0)
+        {
+            num_read = fread(buffer,
+                             1,
+                             KEY_SAMPLE_SIZE,
+                             file);
+            g_checksum_update(checksum,
+                              buffer,
+                              num_read);
+        }
+        GStatBuf st;
+        long long size = -1,
+                  mtime = -1;
+        if(g_stat(filename,
+                  &st) == 0)
+        {
+            size = st.st_size;
+            mtime = st.st_mtime;
+        }
+        char *stamp = g_strdup_printf("%lld:%lld:%d",
+                                      size,
+                                      mtime,
+                                      thumbnail_size);
+        g_checksum_update(checksum,
+                          (const guchar *)stamp,
+                          -1);
+        g_free(stamp);
+        g_free(buffer);
+        fclose(file);
+    }
+    else{
+        g_checksum_update(checksum,
+                          (const guchar *)filename,
+                          -1);
+    }
+    char *key = g_strdup(g_checksum_get_string(checksum));
+    g_checksum_free(checksum);
+    return key;
+}
+
+void
+thumbnail_grid_load(ThumbnailGrid *grid,
+                    const char    *filename,
+                    int            num_items)
+{
+    thumbnail_grid_unload(grid);
+    if(num_items <= 0){
+        return;
+    }
+    grid->num_items = num_items;
+    grid->document_key = make_document_key(filename,
+                                           grid->mode->thumbnail_size);
+}
+
+void
+thumbnail_grid_unload(ThumbnailGrid *grid)
+{
+    /* queued jobs see the new generation and bail out */
+    g_atomic_int_inc(&grid->generation);
+    grid->num_items = 0;
+    g_free(grid->document_key);
+    grid->document_key = NULL;
+    if(grid->thumbnails){
+        g_hash_table_remove_all(grid->thumbnails);
+        g_hash_table_remove_all(grid->pending);
+    }
+    set_wanted_range(grid,
+                     0,
+                     -1);
+    grid->origin_y = 0.0;
+    grid->hovered_index = -1;
+    grid->scroll_target = -1;
+}
+
+static void
+request_thumbnails(ThumbnailGrid *grid,
+                   int            first,
+                   int            last)
+{
+    /*
+       once the range moves, only the queued jobs for cells that scrolled
+       away are dropped, the workers skip them. cells still in view keep
+       their place in the queue and new ones are queued after them, in
+       order, so the visible rows come first.
+    */
+    if(first != grid->first_wanted || last != grid->last_wanted){
+        set_wanted_range(grid,
+                         first,
+                         last);
+    }
+    evict_thumbnails(grid);
+    if(!grid->document_key || !render_pool_is_open()){
+        return;
+    }
+    for(int index = first; index <= last; index++){
+        gpointer key = GINT_TO_POINTER(index);
+        if(g_hash_table_contains(grid->thumbnails,
+                                 key) ||
+           g_hash_table_contains(grid->pending,
+                                 key))
+        {
+            continue;
+        }
+        char *cache_name = NULL;
+        GridJob *job = g_malloc(sizeof(GridJob));
+        job->grid = grid;
+        job->index = index;
+        job->render = grid->mode->render;
+        job->data = grid->mode->job_new(index,
+                                        &cache_name);
+        job->data_free = grid->mode->job_free;
+        job->cache_path = NULL;
+        if(grid->cache_dir && cache_name){
+            char *name = g_strdup_printf("%s-%s.png",
+                                        grid->document_key,
+                                        cache_name);
+            job->cache_path = g_build_filename(grid->cache_dir,
+                                               name,
+                                               NULL);
+            g_free(name);
+        }
+        g_free(cache_name);
+        g_hash_table_add(grid->pending,
+                         key);
+        render_pool_submit(RenderPriorityThumbnail,
+                           &grid->generation,
+                           generate_thumbnail,
+                           deliver_thumbnail,
+                           job,
+                           (GDestroyNotify)grid_job_free);
+    }
+}
+
+static double
+cell_width(const ThumbnailGrid *grid)
+{
+    return grid->mode->thumbnail_size + 2 * grid->mode->cell_padding;
+}
+
+static double
+cell_height(const ThumbnailGrid *grid)
+{
+    return grid->mode->thumbnail_size + grid->mode->label_height + 2 * grid->mode->cell_padding;
+}
+
+void
+thumbnail_grid_draw_label(cairo_t    *cr,
+                          const char *markup,
+                          double      x,
+                          double      y,
+                          double      width)
+{
+    PangoLayout *layout = pango_cairo_create_layout(cr);
+    pango_layout_set_markup(layout,
+                            markup, -1);
+    pango_layout_set_alignment(layout,
+                               PANGO_ALIGN_CENTER);
+    pango_layout_set_width(layout,
+                           width * PANGO_SCALE);
+    pango_layout_set_ellipsize(layout,
+                               PANGO_ELLIPSIZE_END);
+    cairo_move_to(cr,
+                  x, y);
+    pango_cairo_show_layout(cr,
+                            layout);
+    g_object_unref(layout);
+}
+
+void
+thumbnail_grid_draw(ThumbnailGrid *grid,
+                    cairo_t       *cr,
+                    double         width,
+                    double         height)
+{
+    /* only the visible cells are drawn, thumbnails arrive as they're made */
+    if(grid->num_items == 0){
+        return;
+    }
+    grid->num_columns = MAX(1, (int)(width / cell_width(grid)));
+    grid->margin_x = (width - grid->num_columns * cell_width(grid)) / 2;
+    int num_rows = (grid->num_items + grid->num_columns - 1) / grid->num_columns;
+    if(grid->scroll_target >= 0){
+        /* the target row goes to the middle of the view */
+        grid->origin_y = (grid->scroll_target / grid->num_columns) * cell_height(grid) -
+                         (height - cell_height(grid)) / 2;
+        grid->scroll_target = -1;
+    }
+    double max_origin_y = MAX(0, num_rows * cell_height(grid) - height);
+    grid->origin_y = CLAMP(grid->origin_y, 0, max_origin_y);
+    int first_row = grid->origin_y / cell_height(grid),
+        last_row = (grid->origin_y + height) / cell_height(grid);
+    int first_visible = first_row * grid->num_columns,
+        last_visible = MIN(grid->num_items - 1, (last_row + 1) * grid->num_columns - 1);
+    request_thumbnails(grid,
+                       first_visible,
+                       MIN(grid->num_items - 1, last_visible + PREFETCH_ROWS * grid->num_columns));
+    for(int index = first_visible; index <= last_visible; index++){
+        double cell_x = grid->margin_x + (index % grid->num_columns) * cell_width(grid),
+               cell_y = (index / grid->num_columns) * cell_height(grid) - grid->origin_y;
+        if(index == grid->hovered_index){
+            cairo_rectangle(cr,
+                            cell_x, cell_y,
+                            cell_width(grid), cell_height(grid));
+            cairo_set_source_rgb(cr,
+                                 0.5686, 0.6392, 0.6902);
+            cairo_fill(cr);
+        }
+        grid->mode->draw_cell(cr,
+                              index,
+                              cell_x,
+                              cell_y,
+                              g_hash_table_lookup(grid->thumbnails,
+                                                  GINT_TO_POINTER(index)));
+    }
+}
+
+void
+thumbnail_grid_scroll(ThumbnailGrid *grid,
+                      double         dy)
+{
+    grid->origin_y = MAX(0, grid->origin_y + dy);
+    gtk_widget_queue_draw(grid->widget);
+}
+
+void
+thumbnail_grid_scroll_to(ThumbnailGrid *grid,
+                         int            index)
+{
+    grid->scroll_target = index;
+    gtk_widget_queue_draw(grid->widget);
+}
+
+void
+thumbnail_grid_set_cache_limit(ThumbnailGrid *grid,
+                               int            max_thumbnails)
+{
+    grid->max_cached_thumbnails = CLAMP(max_thumbnails, 0, MAX_CACHED_THUMBNAILS);
+    evict_thumbnails(grid);
+}
+
+cairo_surface_t *
+thumbnail_grid_lookup(ThumbnailGrid *grid,
+                      int            index)
+{
+    /* borrowed, NULL if the item has no thumbnail in memory */
+    if(!grid->thumbnails){
+        return NULL;
+    }
+    return g_hash_table_lookup(grid->thumbnails,
+                               GINT_TO_POINTER(index));
+}
+
+int
+thumbnail_grid_hover(ThumbnailGrid *grid,
+                     double         x,
+                     double         y)
+{
+    /* item under (x, y) as of the last draw, -1 if none */
+    grid->hovered_index = -1;
+    if(grid->num_items == 0 || x < grid->margin_x){
+        return -1;
+    }
+    int column = (x - grid->margin_x) / cell_width(grid),
+        row = (y + grid->origin_y) / cell_height(grid);
+    if(column >= grid->num_columns || row < 0){
+        return -1;
+    }
+    int index = row * grid->num_columns + column;
+    if(index >= grid->num_items){
+        return -1;
+    }
+    grid->hovered_index = index;
+    return index;
+}
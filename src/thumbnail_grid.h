@@ -0,0 +1,139 @@
+/*
+ * Copyright © 2020 Reza Hasanzadeh
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 3.0 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef THUMBNAIL_GRID_H
+#define THUMBNAIL_GRID_H
+
+#include <gtk/gtk.h>
+#include "render_pool.h"
+
+/*
+   what a grid of thumbnails shows, the figure gallery and the page strip
+   each configure one.
+*/
+typedef struct
+{
+    /* directory under the user cache the thumbnails are kept in */
+    const char *cache_subdir;
+    int thumbnail_size;
+    int cell_padding;
+    int label_height;
+    /*
+       main thread, what a worker needs to make item index's thumbnail and
+       the name of its file, unique within a document.
+    */
+    gpointer (*job_new)(int    index,
+                        char **cache_name);
+    GDestroyNotify job_free;
+    /* worker thread, only called when the thumbnail isn't on disk */
+    RenderFunc render;
+    /* main thread, item index in the cell at (x, y), thumbnail may be NULL */
+    void (*draw_cell)(cairo_t         *cr,
+                      int              index,
+                      double           x,
+                      double           y,
+                      cairo_surface_t *thumbnail);
+}ThumbnailGridMode;
+
+/*
+   a scrolled grid of cells, only the ones in view and a few rows below have
+   thumbnails. those are made by the render pool, visible rows first, and
+   kept on disk for the next time the book is opened. grids are meant to be
+   static, queued jobs refer to their generation.
+*/
+typedef struct
+{
+    const ThumbnailGridMode *mode;
+    GtkWidget *widget;
+    char *cache_dir;
+    /* identifies the document's thumbnails on disk */
+    char *document_key;
+    int num_items;
+    /* index > cairo_surface_t */
+    GHashTable *thumbnails;
+    /* indices queued for a thumbnail */
+    GHashTable *pending;
+    /* bumped on unload, queued jobs of older generations are skipped */
+    gint generation;
+    /*
+       range of indices worth a thumbnail, set on the main thread. workers
+       read it under range_mutex and skip jobs whose index has left it.
+    */
+    int first_wanted;
+    int last_wanted;
+    GMutex range_mutex;
+    double origin_y;
+    double margin_x;
+    int num_columns;
+    int hovered_index;
+    /* index to bring into view on the next draw, once the columns are known */
+    int scroll_target;
+    /* lowered under memory pressure */
+    int max_cached_thumbnails;
+}ThumbnailGrid;
+
+void
+thumbnail_grid_init(ThumbnailGrid           *grid,
+                    GtkWidget               *widget,
+                    const ThumbnailGridMode *mode);
+
+void
+thumbnail_grid_destroy(ThumbnailGrid *grid);
+
+void
+thumbnail_grid_load(ThumbnailGrid *grid,
+                    const char    *filename,
+                    int            num_items);
+
+void
+thumbnail_grid_unload(ThumbnailGrid *grid);
+
+void
+thumbnail_grid_draw(ThumbnailGrid *grid,
+                    cairo_t       *cr,
+                    double         width,
+                    double         height);
+
+void
+thumbnail_grid_scroll(ThumbnailGrid *grid,
+                      double         dy);
+
+void
+thumbnail_grid_scroll_to(ThumbnailGrid *grid,
+                         int            index);
+
+void
+thumbnail_grid_set_cache_limit(ThumbnailGrid *grid,
+                               int            max_thumbnails);
+
+cairo_surface_t *
+thumbnail_grid_lookup(ThumbnailGrid *grid,
+                      int            index);
+
+int
+thumbnail_grid_hover(ThumbnailGrid *grid,
+                     double         x,
+                     double         y);
+
+void
+thumbnail_grid_draw_label(cairo_t    *cr,
+                          const char *markup,
+                          double      x,
+                          double      y,
+                          double      width);
+
+#endif
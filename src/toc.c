@@ -16,8 +16,11 @@
  */
 
 #include "toc.h"
+#include "roman_numeral.h"
+#include "regex_registry.h"
 #include <glib.h>
 #include <math.h>
+#include <string.h>
 
 static GRegex *toc_regex = NULL;
 
@@ -41,10 +44,10 @@ toc_module_init(void)
         "(I{1,3}|I?V|VI{1,3}|IX)|(XL|XC|L?X{1,3})(I{1,3}|I?V|VI{1,3}|IX)?\n"
         ")(?=(\\W*\\s|$))";
     GError *err = NULL;
-    toc_regex = g_regex_new(pattern,
-                            G_REGEX_CASELESS | G_REGEX_EXTENDED | G_REGEX_NO_AUTO_CAPTURE,
-                            G_REGEX_MATCH_NOTEMPTY,
-                            &err);
+    toc_regex = regex_registry_lookup(pattern,
+                                      G_REGEX_CASELESS | G_REGEX_EXTENDED | G_REGEX_NO_AUTO_CAPTURE,
+                                      G_REGEX_MATCH_NOTEMPTY,
+                                      &err);
     if(!toc_regex){
         g_print("toc_regex error.\ndomain: %d, \ncode: %d, \nmessage: %s\n",
                 err->domain, err->code, err->message);
@@ -162,31 +165,31 @@ toc_get_item_type (const char *label)
         return None;
     }
     enum TOCType toc_type;
-    if(g_regex_match_simple("^part\\b",
-                            label,
-                            G_REGEX_CASELESS,
-                            0))
+    if(regex_registry_match_simple("^part\\b",
+                                   label,
+                                   G_REGEX_CASELESS,
+                                   0))
     {
         toc_type = Part;
     }
-    else if(g_regex_match_simple("^ch(apter)?\\b",
-                                 label,
-                                 G_REGEX_CASELESS,
-                                 0))
+    else if(regex_registry_match_simple("^ch(apter)?\\b",
+                                        label,
+                                        G_REGEX_CASELESS,
+                                        0))
     {
         toc_type = Chapter;
     }
-    else if(g_regex_match_simple("^sec(tion)?\\b",
-                                 label,
-                                 G_REGEX_CASELESS,
-                                 0))
+    else if(regex_registry_match_simple("^sec(tion)?\\b",
+                                        label,
+                                        G_REGEX_CASELESS,
+                                        0))
     {
         toc_type = Section;
     }
-    else if(g_regex_match_simple("^subsec(tion)?\\b",
-                                 label,
-                                 G_REGEX_CASELESS,
-                                 0))
+    else if(regex_registry_match_simple("^subsec(tion)?\\b",
+                                        label,
+                                        G_REGEX_CASELESS,
+                                        0))
     {
         toc_type = Subsection;
     }
@@ -210,19 +213,28 @@ string_index_in_list(GList      *list,
     char *pattern_needle = g_strdup_printf("^%s$",
                                            escaped_needle); 
     g_free(escaped_needle);
+    /* made from the needle, not worth keeping in the registry */
+    GRegex *needle_regex = g_regex_new(pattern_needle,
+                                       is_case_sensitive ? 0 : G_REGEX_CASELESS,
+                                       0,
+                                       NULL);
+    g_free(pattern_needle);
+    if(!needle_regex){
+        return -1;
+    }
     GList *list_p = list;
     while(list_p){
-        if(g_regex_match_simple(pattern_needle,
-                                list_p->data,
-                                is_case_sensitive ? 0 : G_REGEX_CASELESS,
-                                0))
+        if(g_regex_match(needle_regex,
+                         list_p->data,
+                         0,
+                         NULL))
         {
             break;
         }
 
         list_p = list_p->next;
     }
-    g_free(pattern_needle);
+    g_regex_unref(needle_regex);
     int index = list_p ? g_list_position(list,
                                          list_p) 
                        : -1;
@@ -235,31 +247,31 @@ toc_infer_child_label(const char *label_parent)
     if(!label_parent){
         return NULL;
     }
-    if(g_regex_match_simple("^part$",
-                            label_parent,
-                            G_REGEX_CASELESS,
-                            0))
+    if(regex_registry_match_simple("^part$",
+                                   label_parent,
+                                   G_REGEX_CASELESS,
+                                   0))
     {
         return "Chapter";
     }
-    else if(g_regex_match_simple("^ch(apter)?$",
-                                 label_parent,
-                                 G_REGEX_CASELESS,
-                                 0))
+    else if(regex_registry_match_simple("^ch(apter)?$",
+                                        label_parent,
+                                        G_REGEX_CASELESS,
+                                        0))
     {
         return "Section";
     }
-    else if(g_regex_match_simple("^sec(tion)?$",
-                                 label_parent,
-                                 G_REGEX_CASELESS,
-                                 0))
+    else if(regex_registry_match_simple("^sec(tion)?$",
+                                        label_parent,
+                                        G_REGEX_CASELESS,
+                                        0))
     {
         return "Subsection";
     }
-    else if(g_regex_match_simple("^subsec(tion)?$",
-                                 label_parent,
-                                 G_REGEX_CASELESS,
-                                 0))
+    else if(regex_registry_match_simple("^subsec(tion)?$",
+                                        label_parent,
+                                        G_REGEX_CASELESS,
+                                        0))
     {
         return "Chapter";
     }
@@ -343,36 +355,14 @@ toc_fix_labels(TOCItem    *toc_item,
     }
 }
 
-const TOCItem *
-toc_search_by_title(const TOCItem *toc_item,
-                    const char    *title)
-{   
-    char *escaped_title = g_regex_escape_string(toc_item->title,
-                                                -1);
-    char *pattern = g_strdup_printf("^%s$",
-                                    escaped_title); 
-    g_free(escaped_title);
-
-    if(g_regex_match_simple(pattern,
-                            title,
-                            G_REGEX_CASELESS,
-                            0))
-    {
-        g_free(pattern);
-        return toc_item;
-    }
-    g_free(pattern);
-    GList *item_p = toc_item->children;
-    while(item_p){
-        TOCItem *child_item = item_p->data;
-        const TOCItem *target_item = toc_search_by_title(child_item,
-                                                         title);
-        if(target_item){
-            return target_item;
-        }
-        item_p = item_p->next;
-    }
-    return NULL;
+gboolean
+toc_title_has_label(const char *title)
+{
+    /* 'chapter 3 homology', '3.2 cohomology', ... */
+    return title && g_regex_match(toc_regex,
+                                  title,
+                                  0,
+                                  NULL);
 }
 
 static void
@@ -474,41 +464,148 @@ toc_create_from_poppler_index(PopplerDocument *doc,
     toc_calc_length(*head_item);
 }
 
+static char *
+normalize_page_label(const char *label)
+{
+    /* casefold and drop whitespace: ' XIV ' > 'xiv', 'A 3' > 'a3' */
+    char *casefolded = g_utf8_casefold(label,
+                                       -1);
+    GString *normalized = g_string_new(NULL);
+    const char *p = casefolded;
+    while(*p){
+        gunichar c = g_utf8_get_char(p);
+        if(!g_unichar_isspace(c)){
+            normalized = g_string_append_unichar(normalized,
+                                                 c);
+        }
+        p = g_utf8_next_char(p);
+    }
+    g_free(casefolded);
+    return g_string_free(normalized,
+                         FALSE);
+}
+
+void
+page_label_index_insert(GHashTable *page_label_index,
+                        const char *label,
+                        int         page_num)
+{
+    if(!label){
+        return;
+    }
+    g_hash_table_insert(page_label_index,
+                        normalize_page_label(label),
+                        GINT_TO_POINTER(page_num));
+}
+
+void
+page_label_index_insert_aliases(GHashTable *page_label_index,
+                                const char *label,
+                                int         page_num)
+{
+    /*
+       roman labels are also reachable by their decimal value and decimal
+       labels by their roman form, unless a page actually owns that label.
+       must be called after all labels are inserted.
+    */
+    if(!label){
+        return;
+    }
+    char *alias = NULL;
+    int decimal = roman_to_decimal(label);
+    if(decimal > 0){
+        alias = g_strdup_printf("%d",
+                                decimal);
+    }
+    else{
+        char *end_ptr = NULL;
+        decimal = g_ascii_strtoll(label,
+                                  &end_ptr,
+                                  10);
+        const char *roman = (end_ptr != label && *end_ptr == '\0') ? roman_from_decimal(decimal)
+                                                                   : NULL;
+        if(roman){
+            alias = normalize_page_label(roman);
+        }
+    }
+    if(!alias){
+        return;
+    }
+    if(g_hash_table_contains(page_label_index,
+                             alias))
+    {
+        g_free(alias);
+        return;
+    }
+    g_hash_table_insert(page_label_index,
+                        alias,
+                        GINT_TO_POINTER(page_num));
+}
+
+static gboolean
+lookup_page_label(GHashTable *page_label_index,
+                  const char *key,
+                  int        *page_num)
+{
+    gpointer value = NULL;
+    if(!g_hash_table_lookup_extended(page_label_index,
+                                     key,
+                                     NULL,
+                                     &value))
+    {
+        return FALSE;
+    }
+    *page_num = GPOINTER_TO_INT(value);
+    return TRUE;
+}
+
 int
-translate_page_label(GHashTable *page_label_num_hash,
+translate_page_label(GHashTable *page_label_index,
                      const char *label)
 {
+    /*
+       labels are looked up casefolded, e.g. 'XIV', 'xiv' and '14'(if no page
+       is labeled so) are the same page. ranges such as '12-14' resolve to
+       their first page.
+    */
+    if(!label){
+        return -1;
+    }
     int page_num = -1;
-    if(g_hash_table_contains(page_label_num_hash,
-                             label))
+    char *key = normalize_page_label(label);
+    if(!lookup_page_label(page_label_index,
+                          key,
+                          &page_num))
     {
-        page_num = GPOINTER_TO_INT(g_hash_table_lookup(page_label_num_hash,
-                                                       label));
-    }
-    else{
-        GList *key_list = g_hash_table_get_keys(page_label_num_hash);
-        GList *list_p = key_list;
-        while(list_p){
-            char *key = list_p->data;
-            char *escaped = g_regex_escape_string(key,
-                                                  -1);
-            char *pattern = g_strdup_printf("^%s$",
-                                            escaped);
-            g_free(escaped);
-            if(g_regex_match_simple(pattern,
-                                    label,
-                                    G_REGEX_CASELESS, 0))
+        /* hyphen, en dash and em dash */
+        const char *range_delimiters[] = {"-", "\u2013", "\u2014", NULL};
+        for(int i = 0; range_delimiters[i]; i++){
+            char *delimiter = strstr(key,
+                                     range_delimiters[i]);
+            if(!delimiter || delimiter == key ||
+               delimiter[strlen(range_delimiters[i])] == '\0')
             {
-                g_free(pattern);
-                page_num = GPOINTER_TO_INT(g_hash_table_lookup(page_label_num_hash,
-                                                               key));
-                break;
+                continue;
             }
-            g_free(pattern);
-            list_p = list_p->next;
+            char *start = g_strndup(key,
+                                    delimiter - key);
+            int start_page_num = -1,
+                end_page_num = -1;
+            if(lookup_page_label(page_label_index,
+                                 start,
+                                 &start_page_num) &&
+               lookup_page_label(page_label_index,
+                                 delimiter + strlen(range_delimiters[i]),
+                                 &end_page_num) &&
+               start_page_num <= end_page_num)
+            {
+                page_num = start_page_num;
+            }
+            g_free(start);
+            break;
         }
-        g_list_free(key_list);
     }
+    g_free(key);
     return page_num;
 }
 
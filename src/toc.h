@@ -97,9 +97,8 @@ toc_search_by_id(const TOCItem *head_item,
                  const char *label,
                  const char *id);
 
-const TOCItem *
-toc_search_by_title(const TOCItem *toc_item,
-                    const char    *title);
+gboolean
+toc_title_has_label(const char *title);
 
 void
 toc_fix_labels_blindly(TOCItem    *toc_item,
@@ -109,8 +108,18 @@ void
 toc_create_from_poppler_index(PopplerDocument *doc,
                               TOCItem        **head_item);
 
+void
+page_label_index_insert(GHashTable *page_label_index,
+                        const char *label,
+                        int         page_num);
+
+void
+page_label_index_insert_aliases(GHashTable *page_label_index,
+                                const char *label,
+                                int         page_num);
+
 int
-translate_page_label(GHashTable *page_label_num_hash,
+translate_page_label(GHashTable *page_label_index,
                      const char *label);
 
 void
@@ -18,7 +18,10 @@
 
 #include "find.h"
 #include "page_meta.h"
+#include "page_store.h"
 #include "roman_numeral.h"
+#include "regex_registry.h"
+#include "multi_pattern.h"
 #include <math.h>
 #include <poppler/glib/poppler.h>
 
@@ -40,15 +43,133 @@ typedef struct
     double score;
 }ContentsPage;
 
+typedef struct
+{
+    char *text;
+    Rect rect;
+}VisualSegment;
+
+static int
+compare_visual_segments_y(const void *a,
+                          const void *b)
+{
+    const VisualSegment *segment_a = *(VisualSegment **)a;
+    const VisualSegment *segment_b = *(VisualSegment **)b;
+    double cy_a = (segment_a->rect.y1 + segment_a->rect.y2) / 2.0;
+    double cy_b = (segment_b->rect.y1 + segment_b->rect.y2) / 2.0;
+    if(cy_a != cy_b){
+        return cy_a < cy_b ? -1 : +1;
+    }
+    if(segment_a->rect.x1 != segment_b->rect.x1){
+        return segment_a->rect.x1 < segment_b->rect.x1 ? -1 : +1;
+    }
+    return 0;
+}
+
+static int
+compare_visual_segments_x(const void *a,
+                          const void *b)
+{
+    const VisualSegment *segment_a = *(VisualSegment **)a;
+    const VisualSegment *segment_b = *(VisualSegment **)b;
+    if(segment_a->rect.x1 != segment_b->rect.x1){
+        return segment_a->rect.x1 < segment_b->rect.x1 ? -1 : +1;
+    }
+    return 0;
+}
+
+static GHashTable *
+build_visual_segments(PageMeta *meta)
+{
+    /*
+       walk the page text once and attach a bounding box to each text line
+       using the per-character layouts. lines are keyed by their text so
+       that unprocessed lines can find their boxes without searching the
+       page; duplicate lines queue up in reading order.
+    */
+    GHashTable *segment_hash = g_hash_table_new(g_str_hash,
+                                                g_str_equal);
+    if(!meta->text){
+        return segment_hash;
+    }
+    const char *p = meta->text;
+    const char *line_start = p;
+    long char_index = 0;
+    gboolean has_box = FALSE;
+    Rect box = {0};
+    while(TRUE){
+        gunichar c = g_utf8_get_char(p);
+        if(c == '\0' || c == '\n' || c == '\r'){
+            if(has_box){
+                VisualSegment *segment = g_malloc(sizeof(VisualSegment));
+                segment->text = g_strndup(line_start,
+                                          p - line_start);
+                segment->rect = box;
+                GQueue *queue = g_hash_table_lookup(segment_hash,
+                                                    segment->text);
+                if(!queue){
+                    queue = g_queue_new();
+                    g_hash_table_insert(segment_hash,
+                                        segment->text,
+                                        queue);
+                }
+                g_queue_push_tail(queue,
+                                  segment);
+            }
+            if(c == '\0'){
+                break;
+            }
+            has_box = FALSE;
+            line_start = g_utf8_next_char(p);
+        }
+        else if(!g_unichar_isspace(c) && char_index < meta->num_layouts){
+            Rect layout = text_layout_get(meta->text_layout,
+                                          char_index);
+            if(has_box){
+                box.x1 = MIN(box.x1, layout.x1);
+                box.y1 = MIN(box.y1, layout.y1);
+                box.x2 = MAX(box.x2, layout.x2);
+                box.y2 = MAX(box.y2, layout.y2);
+            }
+            else{
+                box = layout;
+                has_box = TRUE;
+            }
+        }
+        p = g_utf8_next_char(p);
+        char_index++;
+    }
+    return segment_hash;
+}
+
+static void
+free_visual_segments(GHashTable *segment_hash)
+{
+    GHashTableIter iter;
+    gpointer key, value;
+    g_hash_table_iter_init(&iter, segment_hash);
+    while(g_hash_table_iter_next(&iter, &key, &value)){
+        GQueue *queue = value;
+        VisualSegment *segment = NULL;
+        while((segment = g_queue_pop_head(queue))){
+            g_free(segment->text);
+            g_free(segment);
+        }
+        g_queue_free(queue);
+    }
+    g_hash_table_unref(segment_hash);
+}
+
 static void
-align_unprocessed_lines(PopplerDocument *document,
-                        GPtrArray       *page_meta_list,
-                        GHashTable      *unprocessed_line_hash,
-                        GList          **aligned_line_list)
+align_unprocessed_lines(GPtrArray   *page_meta_list,
+                        GHashTable  *unprocessed_line_hash,
+                        GList      **aligned_line_list)
 {
     /* 
-       align incorrectly separated lines of text by simple geograhical
-       checks(comparing Y-centers with thresholding)
+       align incorrectly separated lines of text into visual lines. each
+       unprocessed line gets its box from the character layouts, the boxes
+       are sorted by their Y-centers and lines whose centers fall within a
+       threshold of a cluster's first line are joined from left to right.
     */
     *aligned_line_list = NULL;
     GHashTableIter iter;
@@ -58,134 +179,65 @@ align_unprocessed_lines(PopplerDocument *document,
         int page_num = GPOINTER_TO_INT(key);
         PageMeta *meta = g_ptr_array_index(page_meta_list,
                                            page_num);
-        PopplerPage *page = poppler_document_get_page(document,
-                                                      page_num);
         const double ALIGNMENT_THRESHOLD = meta->mean_line_height * 0.25;
-        GList *unprocessed_line_list = value;
-        GList *already_matched_list = NULL;
-        GList *list_p = unprocessed_line_list;
+        GHashTable *segment_hash = build_visual_segments(meta);
+        GPtrArray *segments = g_ptr_array_new();
+        GList *list_p = value;
         while(list_p){
-            if(g_list_find(already_matched_list,
-                           list_p))
-            {
-                list_p = list_p->next;
-                continue;
-            }
-            GList *matched_line_list = NULL,
-                  *matched_rect_list = NULL;
-            char *line = list_p->data;            
-            GList *rect_list = NULL;            
-            GList *pop_list = poppler_page_find_text_with_options(page,
-                                                                  line,
-                                                                  POPPLER_FIND_WHOLE_WORDS_ONLY);
-            GList *pop_p = pop_list;
-            while(pop_p){
-                Rect *rect = rect_from_poppler_rectangle(pop_p->data);
-                rect->y1 = meta->page_height - rect->y1;
-                rect->y2 = meta->page_height - rect->y2;                
-                rect_list = g_list_append(rect_list,
-                                          rect);
-                pop_p = pop_p->next;
+            GQueue *queue = g_hash_table_lookup(segment_hash,
+                                                list_p->data);
+            if(queue && !g_queue_is_empty(queue)){
+                /* hand each occurrence of a repeated line out only once */
+                VisualSegment *segment = g_queue_pop_head(queue);
+                g_ptr_array_add(segments,
+                                segment);
+                g_queue_push_tail(queue,
+                                  segment);
             }
-            g_list_free(pop_list);
-            GList *list_other_p = list_p->next;
-            while(list_other_p){
-                if(g_list_find(already_matched_list,
-                               list_other_p))
-                {
-                    list_other_p = list_other_p->next;
-                    continue;
-                }
-                char *line_other = list_other_p->data;
-                GList *rect_other_list = NULL;
-                GList *pop_other_list = poppler_page_find_text_with_options(page,
-                                                                            line_other,
-                                                                            POPPLER_FIND_WHOLE_WORDS_ONLY);
-
-                GList *pop_other_p = pop_other_list;
-                while(pop_other_p){
-                    Rect *rect_other = rect_from_poppler_rectangle(pop_other_p->data);
-                    rect_other->y1 = meta->page_height - rect_other->y1;
-                    rect_other->y2 = meta->page_height - rect_other->y2;                
-                    rect_other_list = g_list_append(rect_other_list,
-                                                    rect_other);
-                    pop_other_p = pop_other_p->next;
-                }
-                g_list_free(pop_other_list);
-                gboolean is_matched = FALSE;
-                GList *rect_p = rect_list;
-                while(!is_matched && rect_p){
-                    Rect *rect = rect_p->data;
-                    double rect_cy = rect_center_y(rect);
-                    GList *rect_other_p = rect_other_list;
-                    while(!is_matched && rect_other_p){
-                        Rect *rect_other = rect_other_p->data;
-                        double rect_other_cy = rect_center_y(rect_other);
-                        if(fabs(rect_cy - rect_other_cy) < ALIGNMENT_THRESHOLD){
-                            if(!matched_line_list){
-                                matched_line_list = g_list_append(matched_line_list,
-                                                                  list_p);
-                                matched_rect_list = g_list_append(matched_rect_list,
-                                                                  rect_copy(rect));
-                            }
-                            matched_line_list = g_list_append(matched_line_list,
-                                                              list_other_p);
-                            matched_rect_list = g_list_append(matched_rect_list,
-                                                              rect_copy(rect_other));
-                            is_matched = TRUE;
-                        }
-                        rect_other_p = rect_other_p->next;
-                    }                    
-                    rect_p = rect_p->next;
+            list_p = list_p->next;
+        }
+        g_ptr_array_sort(segments,
+                         compare_visual_segments_y);
+        int cluster_start = 0;
+        while(cluster_start < segments->len){
+            VisualSegment *anchor = g_ptr_array_index(segments,
+                                                      cluster_start);
+            double anchor_cy = (anchor->rect.y1 + anchor->rect.y2) / 2.0;
+            int cluster_end = cluster_start + 1;
+            while(cluster_end < segments->len){
+                VisualSegment *segment = g_ptr_array_index(segments,
+                                                           cluster_end);
+                double segment_cy = (segment->rect.y1 + segment->rect.y2) / 2.0;
+                if(segment_cy - anchor_cy >= ALIGNMENT_THRESHOLD){
+                    break;
                 }
-                g_list_free_full(rect_other_list,
-                                 (GDestroyNotify)rect_free);
-                list_other_p = list_other_p->next;
+                cluster_end++;
             }
-            g_list_free_full(rect_list,
-                             (GDestroyNotify)rect_free);
-            g_object_unref(page);
-            if(matched_line_list){
-                already_matched_list = g_list_concat(already_matched_list,
-                                                     matched_line_list);
-                GHashTable *rect_string_hash = g_hash_table_new(g_direct_hash,
-                                                                g_direct_equal);
-                for(int i = 0; i < g_list_length(matched_line_list); i++){
-                    Rect *rect = g_list_nth_data(matched_rect_list,
-                                                 i);
-                    GList *line_string_p = g_list_nth_data(matched_line_list,
-                                                           i);
-                    g_hash_table_insert(rect_string_hash,
-                                        rect,
-                                        line_string_p->data);
-                }
-                matched_rect_list = g_list_sort(matched_rect_list,
-                                                rect_x_compare);
+            if(cluster_end - cluster_start > 1){
+                qsort(segments->pdata + cluster_start,
+                      cluster_end - cluster_start,
+                      sizeof(gpointer),
+                      compare_visual_segments_x);
                 GString *toc_line = g_string_new(NULL);
-                GList *rect_p = matched_rect_list;
-                while(rect_p){
-                    Rect *rect = rect_p->data;
-                    char *string = g_hash_table_lookup(rect_string_hash,
-                                                       rect);
+                for(int i = cluster_start; i < cluster_end; i++){
+                    VisualSegment *segment = g_ptr_array_index(segments,
+                                                               i);
                     toc_line = g_string_append(toc_line,
-                                               string);
-                    if(rect_p->next){
+                                               segment->text);
+                    if(i + 1 < cluster_end){
                         toc_line = g_string_append(toc_line,
                                                    " ");
                     }
-                    rect_p = rect_p->next;
                 }
                 *aligned_line_list = g_list_append(*aligned_line_list,
-                                                   toc_line->str);
-                g_string_free(toc_line,
-                              FALSE);
-                g_hash_table_unref(rect_string_hash);
-                g_list_free_full(matched_rect_list,
-                                 (GDestroyNotify)rect_free);
+                                                   g_string_free(toc_line,
+                                                                 FALSE));
             }
-            list_p = list_p->next;
+            cluster_start = cluster_end;
         }
-        g_list_free(already_matched_list);
+        g_ptr_array_free(segments,
+                         TRUE);
+        free_visual_segments(segment_hash);
     }    
 }
 
@@ -219,10 +271,10 @@ decompose_lines(GList *line_list,
             "(?<caption>.+\\b(?=((I{1,3}|I?V|VI{1,3}|IX)|(XL|XC|L?X{1,3})(I{1,3}|I?V|VI{1,3}|IX)?|\\d+)$))\n"
             "(?<page_label>((I{1,3}|I?V|VI{1,3}|IX)|(XL|XC|L?X{1,3})(I{1,3}|I?V|VI{1,3}|IX)?|\\d+))$";
         GError *err = NULL;
-        discovery_regex = g_regex_new(discovery_pattern,
-                                      G_REGEX_CASELESS | G_REGEX_EXTENDED | G_REGEX_NO_AUTO_CAPTURE,
-                                      G_REGEX_MATCH_NOTEMPTY,
-                                      &err);
+        discovery_regex = regex_registry_lookup(discovery_pattern,
+                                                G_REGEX_CASELESS | G_REGEX_EXTENDED | G_REGEX_NO_AUTO_CAPTURE,
+                                                G_REGEX_MATCH_NOTEMPTY,
+                                                &err);
         if(!discovery_regex){
             g_print("discovery_regex error.\ndomain: %d, \ncode: %d, \nmessage: %s\n",
                     err->domain, err->code, err->message);
@@ -339,6 +391,15 @@ compare_contents_page_groups(const void *a,
     return weighted_score_a - weighted_score_b;
 }
 
+static int
+toc_line_page_num(GHashTable *page_label_num_hash,
+                  const char *page_label)
+{
+    /* an unknown label points to the first page, as it always has */
+    return MAX(0, translate_page_label(page_label_num_hash,
+                                       page_label));
+}
+
 static void
 treeize_toc_list(GHashTable *page_label_num_hash,
                  GList      *label_list,
@@ -383,8 +444,8 @@ treeize_toc_list(GHashTable *page_label_num_hash,
                                         NULL);
     toc_item_child->label = g_strdup(inferred_label);
     toc_item_child->id = toc_line->id ? g_strdup(toc_line->id) : NULL;
-    toc_item_child->page_num = GPOINTER_TO_INT(g_hash_table_lookup(page_label_num_hash,
-                                                                   toc_line->page_label));
+    toc_item_child->page_num = toc_line_page_num(page_label_num_hash,
+                                                   toc_line->page_label);
     toc_item_child->parent = actual_parent;
     actual_parent->children = g_list_append(actual_parent->children,
                                             toc_item_child);
@@ -395,131 +456,307 @@ treeize_toc_list(GHashTable *page_label_num_hash,
                      toc_line->label);    
 }
 
-static void
-find_toc_target_position(PopplerDocument *document,
-                         GPtrArray       *page_meta_list,
-                         TOCItem         *toc_item)
+typedef struct
+{
+    PageMeta *meta;
+    GPtrArray *toc_items;
+}HeadingPage;
+
+typedef struct
+{
+    int item_index;
+    int stage; /* 0: whole title, 1: title without label and id */
+}HeadingNeedle;
+
+typedef struct
+{
+    HeadingPage *heading_page;
+    const char *text;
+    int length;
+    GArray *offsets;
+    double *tallest;
+    double *target_y1;
+}HeadingScan;
+
+static char *
+normalize_heading_text(const char *text,
+                       GArray     *offsets)
 {
     /*
-      find position of a toc item's heading in its page.      
+       fold case, collapse whitespace and join words wrapped by a dash
+       followed by a newline, so titles match page text byte by byte.
+       'offsets' receives the source offset of every output byte.
     */
+    GString *normalized = g_string_sized_new(strlen(text));
+    gboolean pending_space = FALSE;
+    for(int i = 0; text[i]; i++){
+        char c = text[i];
+        if(c == '-' && (text[i + 1] == '\n' || text[i + 1] == '\r')){
+            while(text[i + 1] == '\n' || text[i + 1] == '\r'){
+                i++;
+            }
+            continue;
+        }
+        if(g_ascii_isspace(c)){
+            pending_space = normalized->len > 0;
+            continue;
+        }
+        if(pending_space){
+            normalized = g_string_append_c(normalized,
+                                           ' ');
+            if(offsets){
+                int offset = i - 1;
+                g_array_append_val(offsets,
+                                   offset);
+            }
+            pending_space = FALSE;
+        }
+        normalized = g_string_append_c(normalized,
+                                       g_ascii_tolower(c));
+        if(offsets){
+            g_array_append_val(offsets,
+                               i);
+        }
+    }
+    return g_string_free(normalized,
+                         FALSE);
+}
+
+static char *
+strip_heading_label(const TOCItem *toc_item)
+{
+    /* 'chapter 3. homology' > 'homology' */
+    const char *p = toc_item->title;
+    const char *prefixes[] = {toc_item->label, toc_item->id};
+    for(int i = 0; i < 2; i++){
+        if(!prefixes[i]){
+            continue;
+        }
+        int prefix_len = strlen(prefixes[i]);
+        if(prefix_len == 0 ||
+           g_ascii_strncasecmp(p, prefixes[i], prefix_len) != 0 ||
+           g_ascii_isalnum(p[prefix_len]))
+        {
+            continue;
+        }
+        p += prefix_len;
+        while(*p && (g_ascii_isspace(*p) || (i == 1 && g_ascii_ispunct(*p)))){
+            p++;
+        }
+    }
+    if(p == toc_item->title || *p == '\0'){
+        return NULL;
+    }
+    return g_strdup(p);
+}
+
+static gboolean
+is_word_byte(char c)
+{
+    return g_ascii_isalnum(c) || (guchar)c >= 0x80;
+}
+
+static void
+on_heading_match(int      start,
+                 int      end,
+                 gpointer pattern_data,
+                 gpointer user_data)
+{
+    HeadingScan *scan = user_data;
+    HeadingNeedle *needle = pattern_data;
+    /* whole words only */
+    if((start > 0 && is_word_byte(scan->text[start]) && is_word_byte(scan->text[start - 1])) ||
+       (end < scan->length && is_word_byte(scan->text[end - 1]) && is_word_byte(scan->text[end])))
+    {
+        return;
+    }
+    FindResult *fr = find_result_from_text_range(scan->heading_page->meta,
+                                                 g_array_index(scan->offsets, int, start),
+                                                 g_array_index(scan->offsets, int, end - 1) + 1);
+    if(!fr){
+        return;
+    }
+    Rect *rect_first = g_ptr_array_index(fr->physical_layouts,
+                                         0),
+         *rect_last  = g_ptr_array_index(fr->physical_layouts,
+                                         fr->physical_layouts->len - 1);
+    /* prefer the tallest hit, titles repeated in running heads are smaller */
+    int slot = needle->item_index * 2 + needle->stage;
+    double t = fabs(rect_last->y2 - rect_first->y1);
+    if(t > scan->tallest[slot]){
+        scan->tallest[slot] = t;
+        scan->target_y1[slot] = rect_first->y1;
+    }
+    find_result_free(fr);
+}
+
+static void
+locate_page_headings(gpointer data,
+                     gpointer user_data)
+{
+    /* find all toc headings that target a page in one pass over its text */
+    HeadingPage *heading_page = data;
+    PageMeta *meta = heading_page->meta;
+    if(!meta->text || meta->num_layouts == 0){
+        return;
+    }
+    int num_items = heading_page->toc_items->len;
+    HeadingNeedle *needles = g_new(HeadingNeedle, num_items * 2);
+    GPtrArray *patterns = g_ptr_array_new_with_free_func(g_free);
+    MultiPattern *mp = multi_pattern_new();
+    for(int i = 0; i < num_items; i++){
+        TOCItem *toc_item = g_ptr_array_index(heading_page->toc_items,
+                                              i);
+        char *titles[] = {g_strdup(toc_item->title),
+                          (toc_item->label || toc_item->id) ? strip_heading_label(toc_item)
+                                                            : NULL};
+        for(int stage = 0; stage < 2; stage++){
+            if(!titles[stage]){
+                continue;
+            }
+            char *pattern = normalize_heading_text(titles[stage],
+                                                   NULL);
+            g_free(titles[stage]);
+            g_ptr_array_add(patterns,
+                            pattern);
+            needles[i * 2 + stage].item_index = i;
+            needles[i * 2 + stage].stage = stage;
+            multi_pattern_add(mp,
+                              pattern,
+                              -1,
+                              &needles[i * 2 + stage]);
+        }
+    }
+    HeadingScan scan;
+    scan.heading_page = heading_page;
+    scan.offsets = g_array_sized_new(FALSE,
+                                     FALSE,
+                                     sizeof(int),
+                                     strlen(meta->text));
+    char *text = normalize_heading_text(meta->text,
+                                        scan.offsets);
+    scan.text = text;
+    scan.length = strlen(text);
+    scan.tallest = g_new(double, num_items * 2);
+    scan.target_y1 = g_new(double, num_items * 2);
+    for(int i = 0; i < num_items * 2; i++){
+        scan.tallest[i] = -1.0;
+        scan.target_y1[i] = -1.0;
+    }
+    multi_pattern_compile(mp);
+    multi_pattern_scan(mp,
+                       scan.text,
+                       scan.length,
+                       on_heading_match,
+                       &scan);
+    for(int i = 0; i < num_items; i++){
+        TOCItem *toc_item = g_ptr_array_index(heading_page->toc_items,
+                                              i);
+        /* the stripped title is only a fallback for the whole one */
+        double target_y1 = scan.target_y1[i * 2] >= 0 ? scan.target_y1[i * 2]
+                                                       : scan.target_y1[i * 2 + 1];
+        if(target_y1 > 0){
+            toc_item->offset_y = meta->page_height - target_y1;
+        }
+    }
+    g_free(scan.tallest);
+    g_free(scan.target_y1);
+    g_array_free(scan.offsets,
+                 TRUE);
+    g_free(text);
+    multi_pattern_free(mp);
+    g_ptr_array_free(patterns,
+                     TRUE);
+    g_free(needles);
+}
+
+static void
+collect_toc_items_by_page(TOCItem    *toc_item,
+                          int         num_pages,
+                          GHashTable *page_items_hash)
+{
     if(!toc_item){
         return;
     }
     GList *list_p = toc_item->children;
     while(list_p){
-        find_toc_target_position(document,
-                                 page_meta_list,
-                                 list_p->data);
+        collect_toc_items_by_page(list_p->data,
+                                  num_pages,
+                                  page_items_hash);
         list_p = list_p->next;
     }
-    if(toc_item->page_num < 0 || !toc_item->title){
+    if(toc_item->page_num < 0 || toc_item->page_num >= num_pages || !toc_item->title){
         return;
     }
-    /* 1: look up title */
-    GList *find_results = NULL;
-    find_results = find_text(document,
-                             page_meta_list,
-                             toc_item->title,
-                             toc_item->page_num,
-                             1,
-                             FALSE,
-                             TRUE);
-    find_results = g_list_sort(find_results,
-                               compare_find_results);
-    double target_y1 = -1.0,
-           tallest = -1.0;
-    list_p = find_results;
-    while(list_p){
-        FindResult *fr = list_p->data;
-        Rect *rect_first = g_list_first(fr->physical_layouts)->data,
-             *rect_last  = g_list_last(fr->physical_layouts)->data;
-        double t = fabs(rect_last->y2 - rect_first->y1);
-        if(t > tallest){
-            tallest = t;
-            target_y1 = rect_first->y1;
-        }
-        list_p = list_p->next;
+    GPtrArray *toc_items = g_hash_table_lookup(page_items_hash,
+                                               GINT_TO_POINTER(toc_item->page_num));
+    if(!toc_items){
+        toc_items = g_ptr_array_new();
+        g_hash_table_insert(page_items_hash,
+                            GINT_TO_POINTER(toc_item->page_num),
+                            toc_items);
     }
-    /* 2: remove label and id from title and try again */
-    if(target_y1 < 0 && (toc_item->label || toc_item->id)){
-        char *needle_without_label = NULL;
-        if(toc_item->label){
-            char *pattern = g_strdup_printf("^%s\\b\\s*",
-                                            toc_item->label);
-            GError *err = NULL;
-            GRegex *regex = g_regex_new(pattern,
-                                        G_REGEX_CASELESS,
-                                        G_REGEX_MATCH_NOTEMPTY,
-                                        &err);
-            if(!regex){
-                g_print("label_regex error.\ndomain: %d, \ncode: %d, \nmessage: %s\n",
-                        err->domain, err->code, err->message);
-                return; 
-            }
-            needle_without_label = g_regex_replace(regex,
-                                                   toc_item->title,
-                                                   -1, 0,
-                                                   "",
-                                                   0, NULL);
-            g_regex_unref(regex);
-            g_free(pattern);
-        }
-        char *needle = NULL;
-        if(toc_item->id){
-            char *pattern = g_strdup_printf("^%s\\b\\s*\\W*",
-                                            toc_item->id);
-            GError *err = NULL;
-            GRegex *regex = g_regex_new(pattern,
-                                        G_REGEX_CASELESS,
-                                        G_REGEX_MATCH_NOTEMPTY,
-                                        &err);
-            if(!regex){
-                g_print("label_regex error.\ndomain: %d, \ncode: %d, \nmessage: %s\n",
-                        err->domain, err->code, err->message);
-                return; 
-            }
-            needle = g_regex_replace(regex,
-                                     needle_without_label ? needle_without_label
-                                                          : toc_item->label,
-                                     -1, 0,
-                                     "",
-                                     0, NULL);
-            g_regex_unref(regex);
-            g_free(pattern);
-        }
-        g_free(needle_without_label);
-        find_results = NULL;
-        find_results = find_text(document,
-                                 page_meta_list,
-                                 needle,
-                                 toc_item->page_num,
-                                 1,
-                                 FALSE,
-                                 TRUE);
-        g_free(needle);        
-        find_results = g_list_sort(find_results,
-                                   compare_find_results);
-        GList *list_p = find_results;
-        while(list_p){
-            FindResult *fr = list_p->data;
-            Rect *rect_first = g_list_first(fr->physical_layouts)->data,
-                 *rect_last  = g_list_last(fr->physical_layouts)->data;
-            double t = fabs(rect_last->y2 - rect_first->y1);
-            if(t > tallest){
-                tallest = t;
-                target_y1 = rect_first->y1;
-            }
-            list_p = list_p->next;
+    g_ptr_array_add(toc_items,
+                    toc_item);
+}
+
+static void
+find_toc_target_position(GPtrArray *page_meta_list,
+                         TOCItem   *head_item)
+{
+    /*
+      find position of toc items' headings in their pages. items are grouped
+      by target page and each page is scanned once for all of its titles,
+      pages in parallel.
+    */
+    GHashTable *page_items_hash = g_hash_table_new_full(g_direct_hash,
+                                                        g_direct_equal,
+                                                        NULL,
+                                                        (GDestroyNotify)g_ptr_array_unref);
+    collect_toc_items_by_page(head_item,
+                              page_meta_list->len,
+                              page_items_hash);
+    int num_heading_pages = g_hash_table_size(page_items_hash);
+    HeadingPage *heading_pages = g_new(HeadingPage, num_heading_pages);
+    GHashTableIter iter;
+    gpointer key, value;
+    int n = 0;
+    g_hash_table_iter_init(&iter, page_items_hash);
+    while(g_hash_table_iter_next(&iter, &key, &value)){
+        heading_pages[n].meta = g_ptr_array_index(page_meta_list,
+                                                  GPOINTER_TO_INT(key));
+        heading_pages[n].toc_items = value;
+        n++;
+    }
+    GError *err = NULL;
+    GThreadPool *pool = g_thread_pool_new(locate_page_headings,
+                                          NULL,
+                                          g_get_num_processors(),
+                                          TRUE,
+                                          &err);
+    if(!pool){
+        g_print("heading pool error.\ndomain: %d, \ncode: %d, \nmessage: %s\n",
+                err->domain, err->code, err->message);
+        g_error_free(err);
+    }
+    for(int i = 0; i < num_heading_pages; i++){
+        if(pool){
+            g_thread_pool_push(pool,
+                               &heading_pages[i],
+                               NULL);
+        }
+        else{
+            locate_page_headings(&heading_pages[i],
+                                 NULL);
         }
     }
-    g_list_free_full(find_results,
-                     (GDestroyNotify)find_result_free);                         
-    if(target_y1 > 0){
-        PageMeta *meta = g_ptr_array_index(page_meta_list,
-                                           toc_item->page_num);
-        toc_item->offset_y = meta->page_height - target_y1;
+    if(pool){
+        g_thread_pool_free(pool,
+                           FALSE,
+                           TRUE);
     }
+    g_free(heading_pages);
+    g_hash_table_unref(page_items_hash);
 }
 
 void
@@ -533,9 +770,11 @@ toc_create_from_contents_pages(PopplerDocument *document,
       contain toc contents, try to extract toc related data from the page.
       besides valid data, each page might also contain separate lines that
       are incorrectly scattered by the pdf engine. to recycle scattered
-      lines, a geographical line alignment procedure is employed. finally,
+      lines, visual lines are rebuilt from the character layouts. finally,
       the extracted toc lines are turned into a tree-like toc structure.
     */
+    /* reads the pages' text and layouts, see page_store.h */
+    g_return_if_fail(page_store_is_eviction_suspended());
     const int MIN_CONTENTS_PAGES = 18;
     const int NUM_CONTENTS_PAGES = MAX(floor(page_meta_list->len * 0.05),
                                        MIN_CONTENTS_PAGES);
@@ -544,25 +783,25 @@ toc_create_from_contents_pages(PopplerDocument *document,
     for(int page_num = 0; page_num < NUM_CONTENTS_PAGES; page_num++){
         PageMeta *meta = g_ptr_array_index(page_meta_list,
                                            page_num);
-        char **lines = g_regex_split_simple("\\R",
-                                            meta->text,
-                                            0, 0);
+        char **lines = regex_registry_split_simple("\\R",
+                                                   meta->text,
+                                                   0, 0);
         int num_lines = g_strv_length(lines);
         int num_labels = 0;
         int num_matched_lines = 0;
         char **line_p = lines;
         while(*line_p){
-            if(g_regex_match_simple("\\b((I{1,3}|I?V|VI{1,3}|IX)|(XL|XC|L?X{1,3})(I{1,3}|I?V|VI{1,3}|IX)?|\\d+)$",
-                                    *line_p,
-                                    G_REGEX_CASELESS,
-                                    0))
+            if(regex_registry_match_simple("\\b((I{1,3}|I?V|VI{1,3}|IX)|(XL|XC|L?X{1,3})(I{1,3}|I?V|VI{1,3}|IX)?|\\d+)$",
+                                           *line_p,
+                                           G_REGEX_CASELESS,
+                                           0))
             {
                 num_matched_lines++;
             }
-            if(g_regex_match_simple("^(part|ch(apter)?|(sub)?sec(tion)?)\\b",
-                                    *line_p,
-                                    G_REGEX_CASELESS,
-                                    0))
+            if(regex_registry_match_simple("^(part|ch(apter)?|(sub)?sec(tion)?)\\b",
+                                           *line_p,
+                                           G_REGEX_CASELESS,
+                                           0))
             {
                 num_labels++;
             }
@@ -651,8 +890,7 @@ toc_create_from_contents_pages(PopplerDocument *document,
             contents_p = contents_p->next;
         }
         GList *aligned_line_list = NULL;
-        align_unprocessed_lines(document,
-                                page_meta_list,
+        align_unprocessed_lines(page_meta_list,
                                 unprocessed_line_hash,
                                 &aligned_line_list);
         GList *unprocessed_line_list = g_hash_table_get_values(unprocessed_line_hash);                                   
@@ -755,8 +993,8 @@ toc_create_from_contents_pages(PopplerDocument *document,
                 TOCLine *toc_line = list_p->data;
                 TOCItem *child_item = toc_item_new();
                 child_item->title = g_strdup(toc_line->caption);
-                child_item->page_num = GPOINTER_TO_INT(g_hash_table_lookup(page_label_num_hash,
-                                                                           toc_line->page_label));
+                child_item->page_num = toc_line_page_num(page_label_num_hash,
+                                                           toc_line->page_label);
                 child_item->parent = *head_item;
                 (*head_item)->children = g_list_append((*head_item)->children,
                                                        child_item);
@@ -784,8 +1022,8 @@ toc_create_from_contents_pages(PopplerDocument *document,
                 TOCLine *toc_line = list_p->data;
                 TOCItem *child_item = toc_item_new();
                 child_item->title = g_strchomp(g_strdup(toc_line->caption));
-                child_item->page_num = GPOINTER_TO_INT(g_hash_table_lookup(page_label_num_hash,
-                                                                           toc_line->page_label));
+                child_item->page_num = toc_line_page_num(page_label_num_hash,
+                                                           toc_line->page_label);
                 child_item->parent = *head_item;
                 (*head_item)->children = g_list_append((*head_item)->children,
                                                        child_item);
@@ -800,8 +1038,8 @@ toc_create_from_contents_pages(PopplerDocument *document,
             TOCLine *toc_line = list_p->data;
             TOCItem *child_item = toc_item_new();
             child_item->title = g_strdup(toc_line->match);
-            child_item->page_num = GPOINTER_TO_INT(g_hash_table_lookup(page_label_num_hash,
-                                                                       toc_line->page_label));
+            child_item->page_num = toc_line_page_num(page_label_num_hash,
+                                                       toc_line->page_label);
             child_item->parent = *head_item;
             (*head_item)->children = g_list_append((*head_item)->children,
                                                    child_item);
@@ -828,7 +1066,6 @@ toc_create_from_contents_pages(PopplerDocument *document,
     toc_fix_sibling_links(*head_item);
     (*head_item)->length = poppler_document_get_n_pages(document);
     toc_calc_length(*head_item);
-    find_toc_target_position(document,
-                             page_meta_list,
+    find_toc_target_position(page_meta_list,
                              *head_item);
 }
\ No newline at end of file
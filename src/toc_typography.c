@@ -0,0 +1,505 @@
+/*
+ * Copyright © 2020 Reza Hasanzadeh
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 3.0 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "toc_typography.h"
+#include "page_meta.h"
+#include "page_store.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <poppler/glib/poppler.h>
+
+/*
+   synthesize a toc for documents that have neither an outline nor contents
+   pages. every page is scanned once, in parallel, for short lines set in a
+   font larger or bolder than the page's body text. once all pages are in,
+   the document's body size is known and the surviving heading styles are
+   ranked by size to form toc levels.
+*/
+
+/* font sizes are binned by half a point */
+#define SIZE_BINS_PER_POINT 2
+#define MAX_SIZE_BINS 512
+#define MAX_HEADING_CHARS 120
+#define MAX_HEADING_LEVELS 3
+#define MIN_HEADINGS 3
+#define MAX_WORKERS 4
+
+typedef struct
+{
+    int page_num;
+    int line_index;
+    char *text;
+    int size_bin;
+    gboolean is_bold;
+    double y1;
+}HeadingCandidate;
+
+typedef struct
+{
+    int histogram[MAX_SIZE_BINS];
+    GList *candidates;
+}PageScan;
+
+typedef struct
+{
+    int generation;
+    TOCItem *head_item;
+}TypographyResult;
+
+static GThread *detector_thread = NULL;
+static guint start_source_id = 0;
+static char *detector_uri = NULL;
+static GPtrArray *detector_metae = NULL;
+static TOCTypographyFunc detector_func = NULL;
+/* poppler documents can't be shared between threads, each page borrows one */
+static GAsyncQueue *worker_documents = NULL;
+/* bumped on cancel, pages and results of older generations are dropped */
+static gint generation = 0;
+/* generation the running detector was started with */
+static gint detector_generation = 0;
+
+static void
+heading_candidate_free(HeadingCandidate *candidate)
+{
+    g_free(candidate->text);
+    g_free(candidate);
+}
+
+static gboolean
+is_bold_font(const char *font_name)
+{
+    if(!font_name){
+        return FALSE;
+    }
+    char *name = g_ascii_strdown(font_name,
+                                 -1);
+    gboolean is_bold = strstr(name, "bold") || strstr(name, "black") ||
+                       strstr(name, "heavy") || strstr(name, "demi");
+    g_free(name);
+    return is_bold;
+}
+
+static int
+size_to_bin(double font_size)
+{
+    int bin = round(font_size * SIZE_BINS_PER_POINT);
+    return CLAMP(bin, 0, MAX_SIZE_BINS - 1);
+}
+
+static int
+histogram_mode(const int *histogram)
+{
+    int mode = 0;
+    for(int bin = 1; bin < MAX_SIZE_BINS; bin++){
+        if(histogram[bin] > histogram[mode]){
+            mode = bin;
+        }
+    }
+    return mode;
+}
+
+static void
+scan_page_typography(gpointer data,
+                     gpointer user_data)
+{
+    /* worker thread */
+    PageScan *scans = user_data;
+    int page_num = GPOINTER_TO_INT(data) - 1;
+    PageMeta *meta = g_ptr_array_index(detector_metae,
+                                       page_num);
+    PageScan *scan = &scans[page_num];
+    if(!meta->text || meta->num_layouts == 0 ||
+       g_atomic_int_get(&generation) != detector_generation)
+    {
+        return;
+    }
+    int num_chars = g_utf8_strlen(meta->text,
+                                  -1);
+    PopplerDocument *document = g_async_queue_pop(worker_documents);
+    PopplerPage *page = poppler_document_get_page(document,
+                                                  page_num);
+    GList *attributes = page ? poppler_page_get_text_attributes(page)
+                             : NULL;
+    /* font size bin and boldness of every character */
+    gint16 *size_bins = g_new0(gint16, num_chars);
+    gboolean *bolds = g_new0(gboolean, num_chars);
+    GList *list_p = attributes;
+    while(list_p){
+        PopplerTextAttributes *attrs = list_p->data;
+        int bin = size_to_bin(attrs->font_size);
+        gboolean is_bold = is_bold_font(attrs->font_name);
+        int end = MIN(attrs->end_index, num_chars - 1);
+        for(int i = MAX(attrs->start_index, 0); i <= end; i++){
+            size_bins[i] = bin;
+            bolds[i] = is_bold;
+        }
+        list_p = list_p->next;
+    }
+    poppler_page_free_text_attributes(attributes);
+    if(page){
+        g_object_unref(page);
+    }
+    g_async_queue_push(worker_documents,
+                       document);
+    const char *p = meta->text;
+    for(int i = 0; i < num_chars; i++){
+        if(!g_unichar_isspace(g_utf8_get_char(p))){
+            scan->histogram[size_bins[i]]++;
+        }
+        p = g_utf8_next_char(p);
+    }
+    int body_bin = histogram_mode(scan->histogram);
+    /* lines set uniformly in a font larger or bolder than the body */
+    p = meta->text;
+    int char_index = 0;
+    int line_index = 0;
+    while(*p){
+        const char *line_start = p;
+        int line_first_char = char_index;
+        int num_glyphs = 0,
+            num_alphas = 0,
+            line_bin = -1;
+        gboolean is_uniform = TRUE,
+                 is_bold = TRUE;
+        double y1 = -1.0;
+        while(*p && *p != '\n'){
+            gunichar c = g_utf8_get_char(p);
+            if(!g_unichar_isspace(c)){
+                if(line_bin < 0){
+                    line_bin = size_bins[char_index];
+                    if(char_index < meta->num_layouts){
+                        y1 = meta->text_layout->y1[char_index];
+                    }
+                }
+                else if(abs(size_bins[char_index] - line_bin) > 1){
+                    is_uniform = FALSE;
+                }
+                is_bold = is_bold && bolds[char_index];
+                num_alphas += g_unichar_isalpha(c) ? 1 : 0;
+                num_glyphs++;
+            }
+            p = g_utf8_next_char(p);
+            char_index++;
+        }
+        if(is_uniform && num_alphas > 0 && num_glyphs <= MAX_HEADING_CHARS &&
+           (line_bin > body_bin || is_bold) && char_index > line_first_char)
+        {
+            HeadingCandidate *candidate = g_malloc(sizeof(HeadingCandidate));
+            candidate->page_num = page_num;
+            candidate->line_index = line_index;
+            candidate->text = g_strstrip(g_strndup(line_start,
+                                                   p - line_start));
+            candidate->size_bin = line_bin;
+            candidate->is_bold = is_bold;
+            candidate->y1 = y1;
+            scan->candidates = g_list_prepend(scan->candidates,
+                                              candidate);
+        }
+        if(*p == '\n'){
+            p++;
+            char_index++;
+        }
+        line_index++;
+    }
+    scan->candidates = g_list_reverse(scan->candidates);
+    g_free(size_bins);
+    g_free(bolds);
+}
+
+static TOCItem *
+build_toc(PageScan *scans,
+          int       num_pages)
+{
+    int histogram[MAX_SIZE_BINS] = {0};
+    for(int page_num = 0; page_num < num_pages; page_num++){
+        for(int bin = 0; bin < MAX_SIZE_BINS; bin++){
+            histogram[bin] += scans[page_num].histogram[bin];
+        }
+    }
+    int body_bin = histogram_mode(histogram);
+    /* running heads repeat the same text over many pages */
+    const int MAX_TEXT_REPEATS = 3;
+    GHashTable *text_count_hash = g_hash_table_new(g_str_hash,
+                                                   g_str_equal);
+    for(int page_num = 0; page_num < num_pages; page_num++){
+        GList *list_p = scans[page_num].candidates;
+        while(list_p){
+            HeadingCandidate *candidate = list_p->data;
+            int count = GPOINTER_TO_INT(g_hash_table_lookup(text_count_hash,
+                                                            candidate->text));
+            g_hash_table_insert(text_count_hash,
+                                candidate->text,
+                                GINT_TO_POINTER(count + 1));
+            list_p = list_p->next;
+        }
+    }
+    /* headings in reading order, lines of a wrapped title are joined */
+    GPtrArray *headings = g_ptr_array_new();
+    gboolean is_style_used[MAX_SIZE_BINS * 2] = {FALSE};
+    HeadingCandidate *previous = NULL;
+    int previous_line_index = -1;
+    for(int page_num = 0; page_num < num_pages; page_num++){
+        GList *list_p = scans[page_num].candidates;
+        while(list_p){
+            HeadingCandidate *candidate = list_p->data;
+            list_p = list_p->next;
+            int count = GPOINTER_TO_INT(g_hash_table_lookup(text_count_hash,
+                                                            candidate->text));
+            gboolean is_larger = candidate->size_bin * 100 >= body_bin * 115;
+            gboolean is_labeled_bold = candidate->is_bold &&
+                                       candidate->size_bin >= body_bin &&
+                                       toc_title_has_label(candidate->text);
+            if(count > MAX_TEXT_REPEATS || !(is_larger || is_labeled_bold)){
+                continue;
+            }
+            if(previous &&
+               previous->page_num == candidate->page_num &&
+               previous->size_bin == candidate->size_bin &&
+               previous->is_bold == candidate->is_bold &&
+               previous_line_index + 1 == candidate->line_index)
+            {
+                char *text = g_strconcat(previous->text,
+                                         " ",
+                                         candidate->text,
+                                         NULL);
+                g_free(previous->text);
+                previous->text = text;
+                previous_line_index = candidate->line_index;
+                continue;
+            }
+            /* the candidate's text is a key of text_count_hash, copy it */
+            HeadingCandidate *heading = g_new(HeadingCandidate, 1);
+            *heading = *candidate;
+            heading->text = g_strdup(candidate->text);
+            g_ptr_array_add(headings,
+                            heading);
+            is_style_used[candidate->size_bin * 2 + candidate->is_bold] = TRUE;
+            previous = heading;
+            previous_line_index = candidate->line_index;
+        }
+    }
+    g_hash_table_unref(text_count_hash);
+    /* the largest styles become levels, bold ranks above regular */
+    int style_levels[MAX_SIZE_BINS * 2];
+    int num_levels = 0;
+    for(int style = MAX_SIZE_BINS * 2 - 1; style >= 0; style--){
+        style_levels[style] = -1;
+        if(is_style_used[style] && num_levels < MAX_HEADING_LEVELS){
+            style_levels[style] = num_levels++;
+        }
+    }
+    TOCItem *head_item = NULL;
+    int num_headings = 0;
+    for(int i = 0; i < headings->len; i++){
+        HeadingCandidate *heading = g_ptr_array_index(headings,
+                                                      i);
+        num_headings += style_levels[heading->size_bin * 2 + heading->is_bold] >= 0;
+    }
+    if(num_headings >= MIN_HEADINGS){
+        head_item = toc_item_new();
+        /* most recent item of each level */
+        TOCItem *parents[MAX_HEADING_LEVELS] = {NULL};
+        for(int i = 0; i < headings->len; i++){
+            HeadingCandidate *heading = g_ptr_array_index(headings,
+                                                          i);
+            int level = style_levels[heading->size_bin * 2 + heading->is_bold];
+            if(level < 0){
+                continue;
+            }
+            PageMeta *meta = g_ptr_array_index(detector_metae,
+                                               heading->page_num);
+            TOCItem *toc_item = toc_item_new();
+            toc_item->title = g_strdup(heading->text);
+            toc_item->page_num = heading->page_num;
+            if(heading->y1 > 0){
+                toc_item->offset_y = meta->page_height - heading->y1;
+            }
+            TOCItem *parent = head_item;
+            for(int l = level - 1; l >= 0; l--){
+                if(parents[l]){
+                    parent = parents[l];
+                    break;
+                }
+            }
+            toc_item->parent = parent;
+            parent->children = g_list_append(parent->children,
+                                             toc_item);
+            parents[level] = toc_item;
+            for(int l = level + 1; l < MAX_HEADING_LEVELS; l++){
+                parents[l] = NULL;
+            }
+        }
+        toc_fix_labels(head_item,
+                       NULL,
+                       NULL);
+        head_item->depth = 0;
+        toc_fix_depth(head_item);
+        toc_fix_sibling_links(head_item);
+        head_item->length = num_pages;
+        toc_calc_length(head_item);
+    }
+    g_ptr_array_set_free_func(headings,
+                              (GDestroyNotify)heading_candidate_free);
+    g_ptr_array_unref(headings);
+    return head_item;
+}
+
+static gboolean
+deliver_toc(gpointer data)
+{
+    /* main thread */
+    TypographyResult *result = data;
+    if(result->generation == g_atomic_int_get(&generation) && detector_func){
+        detector_func(result->head_item);
+    }
+    else if(result->head_item){
+        toc_destroy(result->head_item);
+    }
+    g_free(result);
+    return G_SOURCE_REMOVE;
+}
+
+static gpointer
+detect_headings(gpointer data)
+{
+    /* detector thread */
+    int num_pages = detector_metae->len;
+    PageScan *scans = g_new0(PageScan, num_pages);
+    worker_documents = g_async_queue_new();
+    int num_workers = MIN(MAX_WORKERS, g_get_num_processors());
+    for(int i = 0; i < num_workers; i++){
+        GError *err = NULL;
+        PopplerDocument *document = poppler_document_new_from_file(detector_uri,
+                                                                   NULL,
+                                                                   &err);
+        if(!document){
+            g_print("heading detector document error.\ndomain: %d, \ncode: %d, \nmessage: %s\n",
+                    err->domain, err->code, err->message);
+            g_error_free(err);
+            break;
+        }
+        g_async_queue_push(worker_documents,
+                           document);
+    }
+    int num_documents = g_async_queue_length(worker_documents);
+    GThreadPool *pool = NULL;
+    if(num_documents > 0){
+        GError *err = NULL;
+        pool = g_thread_pool_new(scan_page_typography,
+                                 scans,
+                                 num_documents,
+                                 TRUE,
+                                 &err);
+        if(!pool){
+            g_print("heading detector pool error.\ndomain: %d, \ncode: %d, \nmessage: %s\n",
+                    err->domain, err->code, err->message);
+            g_error_free(err);
+        }
+    }
+    if(pool){
+        /* page numbers are offset by one, NULL can't be pushed */
+        for(int page_num = 0; page_num < num_pages; page_num++){
+            g_thread_pool_push(pool,
+                               GINT_TO_POINTER(page_num + 1),
+                               NULL);
+        }
+        g_thread_pool_free(pool,
+                           FALSE,
+                           TRUE);
+    }
+    TypographyResult *result = g_malloc(sizeof(TypographyResult));
+    result->generation = detector_generation;
+    result->head_item = NULL;
+    if(pool && g_atomic_int_get(&generation) == detector_generation){
+        result->head_item = build_toc(scans,
+                                      num_pages);
+    }
+    g_idle_add(deliver_toc,
+               result);
+    for(int page_num = 0; page_num < num_pages; page_num++){
+        g_list_free_full(scans[page_num].candidates,
+                         (GDestroyNotify)heading_candidate_free);
+    }
+    g_free(scans);
+    PopplerDocument *document;
+    while((document = g_async_queue_try_pop(worker_documents))){
+        g_object_unref(document);
+    }
+    g_async_queue_unref(worker_documents);
+    worker_documents = NULL;
+    return NULL;
+}
+
+static gboolean
+start_detection(gpointer data)
+{
+    /* main thread, the document has been painted by now */
+    start_source_id = 0;
+    detector_thread = g_thread_new("heading detector",
+                                   detect_headings,
+                                   NULL);
+    return G_SOURCE_REMOVE;
+}
+
+void
+toc_typography_start(const char       *filename,
+                     GPtrArray        *page_meta_list,
+                     TOCTypographyFunc func)
+{
+    toc_typography_cancel();
+    /*
+       the detector thread reads every page's text and layouts, the caller
+       keeps eviction suspended until func is called.
+    */
+    g_return_if_fail(page_store_is_eviction_suspended());
+    if(!page_meta_list || page_meta_list->len == 0){
+        return;
+    }
+    detector_uri = g_filename_to_uri(filename,
+                                     NULL,
+                                     NULL);
+    if(!detector_uri){
+        return;
+    }
+    detector_metae = page_meta_list;
+    detector_func = func;
+    detector_generation = g_atomic_int_get(&generation);
+    start_source_id = g_idle_add_full(G_PRIORITY_LOW,
+                                      start_detection,
+                                      NULL,
+                                      NULL);
+}
+
+void
+toc_typography_cancel(void)
+{
+    /* the detector reads the page metas, so wait for it before they go */
+    g_atomic_int_inc(&generation);
+    if(start_source_id){
+        g_source_remove(start_source_id);
+        start_source_id = 0;
+    }
+    if(detector_thread){
+        g_thread_join(detector_thread);
+        detector_thread = NULL;
+    }
+    g_free(detector_uri);
+    detector_uri = NULL;
+    detector_metae = NULL;
+    detector_func = NULL;
+}
@@ -0,0 +1,35 @@
+/*
+ * Copyright © 2020 Reza Hasanzadeh
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 3.0 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef TOC_TYPOGRAPHY_H
+#define TOC_TYPOGRAPHY_H
+
+#include <glib.h>
+#include "toc.h"
+
+/* receives the synthesized toc on the main thread, NULL if none was found */
+typedef void (*TOCTypographyFunc)(TOCItem *head_item);
+
+void
+toc_typography_start(const char       *filename,
+                     GPtrArray        *page_meta_list,
+                     TOCTypographyFunc func);
+
+void
+toc_typography_cancel(void);
+
+#endif
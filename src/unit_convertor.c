@@ -16,16 +16,351 @@
  */
 
 #include "unit_convertor.h"
+#include "regex_registry.h"
 #include <math.h>
+#include <string.h>
 
+#ifdef UNIT_CONVERTOR_DEBUG
+/* the former matcher, kept to cross-check the scanner */
 static GRegex *unit_regex = NULL;
+#endif
 static GRegex *comma_regex = NULL;
+static GRegex *zero_regex = NULL;
+/* normalized unit spelling > UnitSpelling */
+static GHashTable *unit_spelling_hash = NULL;
+
+typedef struct
+{
+    const Measurement *measurement;
+    /*
+       bit i is set when the spelling may break into words before its i'th
+       byte, e.g. 'sq|ft' but not 'm|ph'
+    */
+    guint64 word_breaks;
+}UnitSpelling;
+
+typedef struct
+{
+    /* optional, e.g. square, cubic */
+    const char *prefixes;
+    const char *names;
+    /* optional, the 'per' part of rates */
+    const char *pers;
+    Measurement measurement;
+}UnitDefinition;
+
+/* 
+   spellings are normalized(see normalize_unit()) and '|' separated. each
+   spelling of a definition is 'prefix name/per'. the target measurement
+   is the one a unit gets converted to, e.g. feet > SI. when two definitions
+   share a spelling, the first one wins. in text, a unit may only span
+   several words between its prefix, name and per, around a '/' and where
+   its name has a space, e.g. 'nautical mile' and 'kilo metre'.
+*/
+#define METRE_NAMES(prefix) prefix "metre|" prefix "metres|" prefix "meter|" prefix "meters"
+#define METRE_RATE_NAMES(prefix) prefix "m|" METRE_NAMES(prefix)
+#define LITRE_NAMES(prefix) prefix "l|" prefix "litre|" prefix "litres|" prefix "liter|" prefix "liters"
+#define GRAM_NAMES(prefix) prefix "gram|" prefix "grams"
+#define SQUARE "sq|square"
+#define CUBIC "cu|cubic"
+#define PER_SECOND "s|sec|secs|second|seconds"
+#define PER_MINUTE "m|min|mins|minute|minutes"
+#define PER_HOUR "h|hour|hours"
+
+static const UnitDefinition UNIT_DEFINITIONS[] = {
+    /* imperial to si */
+    /* length, base unit is meters */
+    {NULL, "thou", NULL, {SI, Length, 0.0000254}},
+    {NULL, "inch|inches|\"", NULL, {SI, Length, 0.0254}},
+    {NULL, "ft|foot|feet|'", NULL, {SI, Length, 0.3048}},
+    {NULL, "yard|yards|yd", NULL, {SI, Length, 0.9144}},
+    {NULL, "ch|chain|chains", NULL, {SI, Length, 20.1168}},
+    {NULL, "fur|furlong|furlongs", NULL, {SI, Length, 201.168}},
+    {NULL, "mi|mile|miles", NULL, {SI, Length, 1609.344}},
+    {NULL, "lea|league|leagues", NULL, {SI, Length, 4828.032}},
+    {NULL, "fathom|fathoms|ftm", NULL, {SI, Length, 1.852}},
+    {NULL, "cable|cables", NULL, {SI, Length, 185.2}},
+    {NULL, "nautical mile|nautical miles|nmi", NULL, {SI, Length, 1852}},
+    {NULL, "link|links", NULL, {SI, Length, 0.201168}},
+    {NULL, "rod|rods", NULL, {SI, Length, 5.0292}},
+    /* area, base unit is square meters */
+    {SQUARE, "in|inch|inches|\"", NULL, {SI, Area, 0.00064516}},
+    {NULL, "in2", NULL, {SI, Area, 0.00064516}},
+    {SQUARE, "ft|foot|feet|'", NULL, {SI, Area, 0.092903}},
+    {NULL, "ft2", NULL, {SI, Area, 0.092903}},
+    {SQUARE, "yard|yards|yd", NULL, {SI, Area, 0.836127}},
+    {NULL, "yd2", NULL, {SI, Area, 0.836127}},
+    {SQUARE, "mi|mile|miles", NULL, {SI, Area, 2.59e+6}},
+    {NULL, "mi2", NULL, {SI, Area, 2.59e+6}},
+    {NULL, "perch|perchs|perches", NULL, {SI, Area, 25.29285264}},
+    {NULL, "rood|roods", NULL, {SI, Area, 1011.7141056}},
+    {NULL, "acre|acres", NULL, {SI, Area, 4046.86}},
+    /* volume, base unit is liters */
+    {NULL, "gi|gill|gills", NULL, {SI, Volume, 0.1420653125}},
+    {NULL, "pint|pints", NULL, {SI, Volume, 0.56826125}},
+    {NULL, "quart|quarts|qt", NULL, {SI, Volume, 1.1365225}},
+    {NULL, "gal|gallon|gallons", NULL, {SI, Volume, 4.54609}},
+    {NULL, "teaspoon|teaspoons|tsp", NULL, {SI, Volume, 0.00492892159375}},
+    {NULL, "tablespoon|tablespoons|tbsp", NULL, {SI, Volume, 0.01478676478125}},
+    {CUBIC, "in|inch|inches", NULL, {SI, Volume, 0.016387064}},
+    {NULL, "in3", NULL, {SI, Volume, 0.016387064}},
+    {CUBIC, "ft|foot|feet|'", NULL, {SI, Volume, 28.316846592}},
+    {NULL, "ft3", NULL, {SI, Volume, 28.316846592}},
+    {CUBIC, "yard|yards|yd", NULL, {SI, Volume, 746.554857984}},
+    {NULL, "yd3", NULL, {SI, Volume, 746.554857984}},
+    /* mass, base unit is grams */
+    {NULL, "gr|grain|grains", NULL, {SI, Mass, 0.06479891}},
+    {NULL, "drachm|drachms", NULL, {SI, Mass, 1.7718451953125}},
+    {NULL, "ounce|ounces|oz", NULL, {SI, Mass, 28.349523125}},
+    {NULL, "pound|pounds|lb|lbs", NULL, {SI, Mass, 453.59237}},
+    {NULL, "stone", NULL, {SI, Mass, 6350.29318}},
+    {NULL, "hundredweight|hundredweights|cwt", NULL, {SI, Mass, 5.0802345443e+4}},
+    {NULL, "ton|tons", NULL, {SI, Mass, 1.016047e+6}},
+    /* temperature */
+    {"|deg|degree|degrees", "fahrenheit", NULL, {SI, Temperature, 1}},
+    {NULL, "℉", NULL, {SI, Temperature, 1}},
+    /* velocity, base unit is m/s */
+    {NULL, "in|inch|inches", PER_SECOND, {SI, Velocity, 2.54e-2}},
+    {NULL, "in|inch|inches", PER_MINUTE, {SI, Velocity, 4.233333333e-4}},
+    {NULL, "in|inch|inches", PER_HOUR, {SI, Velocity, 7.05556e-6}},
+    {NULL, "ft|foot|feet", PER_SECOND, {SI, Velocity, 0.3048}},
+    {NULL, "ft|foot|feet", PER_MINUTE, {SI, Velocity, 5.08e-3}},
+    {NULL, "fpm", NULL, {SI, Velocity, 5.08e-3}},
+    {NULL, "ft|foot|feet", PER_HOUR, {SI, Velocity, 8.466667e-5}},
+    {NULL, "fth|fph", NULL, {SI, Velocity, 8.466667e-5}},
+    {NULL, "yard|yards|yd", PER_SECOND, {SI, Velocity, 0.9}},
+    {NULL, "yds", NULL, {SI, Velocity, 0.9}},
+    {NULL, "yard|yards|yd", PER_MINUTE, {SI, Velocity, 1.5e-2}},
+    {NULL, "ydm", NULL, {SI, Velocity, 1.5e-2}},
+    {NULL, "yard|yards|yd", PER_HOUR, {SI, Velocity, 2.5e-4}},
+    {NULL, "ydh", NULL, {SI, Velocity, 2.5e-4}},
+    {NULL, "mi|mile|miles", PER_SECOND, {SI, Velocity, 1609.344}},
+    {NULL, "mps", NULL, {SI, Velocity, 1609.344}},
+    {NULL, "mi|mile|miles", PER_MINUTE, {SI, Velocity, 26.8224}},
+    {NULL, "mpm", NULL, {SI, Velocity, 26.8224}},
+    {NULL, "mi|mile|miles", PER_HOUR, {SI, Velocity, 0.44704}},
+    {NULL, "mph|mp/h", NULL, {SI, Velocity, 0.44704}},
+    {NULL, "nautical mile|nautical miles|nm", PER_HOUR, {SI, Velocity, 0.514772}},
+    {NULL, "kn|knot|knots", NULL, {SI, Velocity, 0.514772}},
+    {NULL, "furlong|furlongs", "fortnight|fortnights", {SI, Velocity, 1.663095e-4}},
+    /* si to imperial */
+    /* length, base unit is feet */
+    {NULL, METRE_NAMES("nano ") "|nm", NULL, {Imperial, Length, 3.28084 / 1e+9}},
+    {NULL, METRE_NAMES("micro ") "|µm|μm", NULL, {Imperial, Length, 3.28084 / 1e+6}},
+    {NULL, METRE_NAMES("milli ") "|mm", NULL, {Imperial, Length, 3.28084 / 1e+3}},
+    {NULL, METRE_NAMES("centi ") "|cm", NULL, {Imperial, Length, 3.28084 / 1e+2}},
+    {NULL, METRE_NAMES("deci "), NULL, {Imperial, Length, 3.28084 / 1e+1}},
+    {NULL, METRE_NAMES("") "|m", NULL, {Imperial, Length, 3.28084}},
+    {NULL, METRE_NAMES("kilo ") "|km", NULL, {Imperial, Length, 3.28084 * 1e+3}},
+    /* area, base unit is square feet */
+    {SQUARE, METRE_NAMES("nano ") "|nm", NULL, {Imperial, Area, 10.7639 / 1e+18}},
+    {SQUARE, METRE_NAMES("micro ") "|µm|μm", NULL, {Imperial, Area, 10.7639 / 1e+12}},
+    {SQUARE, METRE_NAMES("milli ") "|mm", NULL, {Imperial, Area, 10.7639 / 1e+6}},
+    {SQUARE, METRE_NAMES("centi ") "|cm", NULL, {Imperial, Area, 10.7639 / 1e+4}},
+    {SQUARE, METRE_NAMES("") "|m", NULL, {Imperial, Area, 10.7639}},
+    {NULL, "m2", NULL, {Imperial, Area, 10.7639}},
+    {SQUARE, METRE_NAMES("kilo ") "|km", NULL, {Imperial, Area, 10.7639 * 1e+6}},
+    {NULL, "hectare|hectares", NULL, {Imperial, Area, 10.7639 * 1e+4}},
+    /* volume, base unit is cubic feet */
+    {NULL, LITRE_NAMES("milli") "|ml", NULL, {Imperial, Volume, 0.035314667 / 1e+3}},
+    {NULL, LITRE_NAMES(""), NULL, {Imperial, Volume, 0.035314667}},
+    {CUBIC, METRE_NAMES("") "|m", NULL, {Imperial, Volume, 0.035314667 * 1e+3}},
+    {NULL, "m3", NULL, {Imperial, Volume, 0.035314667 * 1e+3}},
+    /* mass, base unit is pounds */
+    {NULL, GRAM_NAMES("nano "), NULL, {Imperial, Mass, 0.00220462 / 1e+9}},
+    {NULL, GRAM_NAMES("micro ") "|µg|μg", NULL, {Imperial, Mass, 0.00220462 / 1e+6}},
+    {NULL, GRAM_NAMES("milli ") "|mg", NULL, {Imperial, Mass, 0.00220462 / 1e+3}},
+    {NULL, GRAM_NAMES("") "|g", NULL, {Imperial, Mass, 0.00220462}},
+    {NULL, GRAM_NAMES("kilo ") "|kg", NULL, {Imperial, Mass, 0.00220462 * 1e+3}},
+    {"|metric", "ton|tonne|tonnes", NULL, {Imperial, Mass, 0.00220462 * 1e+6}},
+    {NULL, "mt", NULL, {Imperial, Mass, 0.00220462 * 1e+6}},
+    {NULL, "kt", NULL, {Imperial, Mass, 0.00220462 * 1e+9}},
+    /* temperature */
+    {"|deg|degree|degrees", "celsius", NULL, {Imperial, Temperature, 1}},
+    {NULL, "℃", NULL, {Imperial, Temperature, 1}},
+    /* velocity, base unit is ft/s */
+    {NULL, METRE_RATE_NAMES("nano "), PER_SECOND, {Imperial, Velocity, 3.280839895e-9}},
+    {NULL, METRE_RATE_NAMES("nano "), PER_MINUTE, {Imperial, Velocity, 5.4680665e-11}},
+    {NULL, METRE_RATE_NAMES("nano "), PER_HOUR, {Imperial, Velocity, 9.1134442e-13}},
+    {NULL, METRE_RATE_NAMES("micro "), PER_SECOND, {Imperial, Velocity, 3.280839895e-6}},
+    {NULL, METRE_RATE_NAMES("micro "), PER_MINUTE, {Imperial, Velocity, 5.4680665e-8}},
+    {NULL, METRE_RATE_NAMES("micro "), PER_HOUR, {Imperial, Velocity, 9.1134442e-10}},
+    {NULL, METRE_RATE_NAMES("milli "), PER_SECOND, {Imperial, Velocity, 3.280839895e-3}},
+    {NULL, METRE_RATE_NAMES("milli "), PER_MINUTE, {Imperial, Velocity, 5.4680665e-5}},
+    {NULL, METRE_RATE_NAMES("milli "), PER_HOUR, {Imperial, Velocity, 9.1134442e-7}},
+    {NULL, METRE_RATE_NAMES("centi "), PER_SECOND, {Imperial, Velocity, 3.280839895e-2}},
+    {NULL, METRE_RATE_NAMES("centi "), PER_MINUTE, {Imperial, Velocity, 5.4680665e-4}},
+    {NULL, METRE_RATE_NAMES("centi "), PER_HOUR, {Imperial, Velocity, 9.1134442e-6}},
+    {NULL, METRE_RATE_NAMES("deci "), PER_SECOND, {Imperial, Velocity, 3.2808399e-1}},
+    {NULL, METRE_RATE_NAMES("deci "), PER_MINUTE, {Imperial, Velocity, 5.468066e-3}},
+    {NULL, METRE_RATE_NAMES("deci "), PER_HOUR, {Imperial, Velocity, 9.1134e-5}},
+    {NULL, METRE_RATE_NAMES(""), PER_SECOND, {Imperial, Velocity, 3.280839895}},
+    {NULL, METRE_RATE_NAMES(""), PER_MINUTE, {Imperial, Velocity, 5.4680665e-2}},
+    {NULL, METRE_RATE_NAMES(""), PER_HOUR, {Imperial, Velocity, 9.1134442e-4}},
+    {NULL, METRE_RATE_NAMES("kilo "), PER_SECOND, {Imperial, Velocity, 3.280839895e+3}},
+    {NULL, METRE_RATE_NAMES("kilo "), PER_MINUTE, {Imperial, Velocity, 54.680664917}},
+    {NULL, METRE_RATE_NAMES("kilo "), PER_HOUR, {Imperial, Velocity, 0.911344415}},
+    {NULL, "kmh|kph|km/h", NULL, {Imperial, Velocity, 0.911344415}},
+    {NULL, NULL, NULL, {0, 0, 0}}
+};
+
+typedef struct
+{
+    const char *name;
+    double value;
+    /* 'm' and 'b' are only multipliers when followed by whitespace */
+    gboolean needs_space;
+}Multiplier;
+
+/* longer names first, the scanner takes the first one that fits */
+static const Multiplier MULTIPLIERS[] = {
+    {"thousand", 1e+3, FALSE},
+    {"hundred", 1e+2, FALSE},
+    {"million", 1e+6, TRUE},
+    {"billion", 1e+9, TRUE},
+    {"kilo", 1e+3, FALSE},
+    {"k", 1e+3, FALSE},
+    {"m", 1e+6, TRUE},
+    {"b", 1e+9, TRUE},
+    {NULL, 0, FALSE}
+};
+
+/* longest normalized unit spelling plus some slack */
+#define MAX_UNIT_LENGTH 64
+
+static gboolean
+normalize_unit(const char *unit,
+               int         unit_length,
+               char       *normalized)
+{
+    /*
+       lowercase, drop whitespace and line-break hyphenation and spell 'per'
+       as '/', so 'Feet per\nSecond' > 'feet/second', 'sq-\nft' > 'sqft'.
+       'per' leading a unit is left alone, e.g. 'perches'. a negative
+       unit_length means unit is nul-terminated. normalized must hold
+       MAX_UNIT_LENGTH bytes.
+    */
+    int len = 0;
+    const char *p = unit;
+    const char *end = unit_length < 0 ? NULL : unit + unit_length;
+    while(*p && (!end || p < end)){
+        if(g_ascii_isspace(*p)){
+            p++;
+            continue;
+        }
+        if(*p == '-' && (p[1] == '\n' || p[1] == '\r')){
+            p++;
+            continue;
+        }
+        if(len > 0 &&
+           (!end || end - p > 3) &&
+           g_ascii_strncasecmp(p, "per", 3) == 0 &&
+           (g_ascii_isspace(p[3]) || p[3] == '-' || g_ascii_isalpha(p[3])))
+        {
+            if(len + 1 >= MAX_UNIT_LENGTH){
+                return FALSE;
+            }
+            normalized[len++] = '/';
+            p += 3;
+            continue;
+        }
+        if(len + 1 >= MAX_UNIT_LENGTH){
+            return FALSE;
+        }
+        normalized[len++] = g_ascii_tolower(*p);
+        p++;
+    }
+    normalized[len] = '\0';
+    return len > 0;
+}
+
+static void
+register_unit_spelling(const char        *spelling,
+                       const Measurement *measurement)
+{
+    /* spelling is normalized but for the spaces that mark its word breaks */
+    char normalized[MAX_UNIT_LENGTH];
+    guint64 word_breaks = 0;
+    int len = 0;
+    for(const char *p = spelling; *p && len + 1 < MAX_UNIT_LENGTH; p++){
+        if(*p == ' '){
+            word_breaks |= G_GUINT64_CONSTANT(1) << len;
+            continue;
+        }
+        if(*p == '/'){
+            word_breaks |= G_GUINT64_CONSTANT(1) << len;
+            normalized[len++] = *p;
+            word_breaks |= G_GUINT64_CONSTANT(1) << len;
+            continue;
+        }
+        normalized[len++] = *p;
+    }
+    normalized[len] = '\0';
+    UnitSpelling *unit_spelling = g_hash_table_lookup(unit_spelling_hash,
+                                                      normalized);
+    if(unit_spelling){
+        /* 'nm' is both nanometre and nautical mile, words may break either way */
+        unit_spelling->word_breaks |= word_breaks;
+        return;
+    }
+    unit_spelling = g_new(UnitSpelling, 1);
+    unit_spelling->measurement = measurement;
+    unit_spelling->word_breaks = word_breaks;
+    g_hash_table_insert(unit_spelling_hash,
+                        g_strdup(normalized),
+                        unit_spelling);
+}
+
+static void
+register_unit_spellings(const UnitDefinition *definition)
+{
+    char **prefixes = g_strsplit(definition->prefixes ? definition->prefixes : "",
+                                 "|",
+                                 -1);
+    char **names = g_strsplit(definition->names,
+                              "|",
+                              -1);
+    char **pers = definition->pers ? g_strsplit(definition->pers,
+                                                "|",
+                                                -1)
+                                   : NULL;
+    /* an empty prefix list still yields a single empty prefix */
+    char *no_prefix[] = {"", NULL};
+    char **prefix_p = *prefixes ? prefixes : no_prefix;
+    for(; *prefix_p; prefix_p++){
+        for(char **name_p = names; *name_p; name_p++){
+            char **per_p = pers;
+            do{
+                char *spelling = g_strconcat(*prefix_p,
+                                             **prefix_p ? " " : "",
+                                             *name_p,
+                                             per_p ? "/" : "",
+                                             per_p ? *per_p : "",
+                                             NULL);
+                register_unit_spelling(spelling,
+                                       &definition->measurement);
+                g_free(spelling);
+            }while(per_p && *(++per_p));
+        }
+    }
+    g_strfreev(prefixes);
+    g_strfreev(names);
+    g_strfreev(pers);
+}
 
 void
 unit_convertor_module_init(void)
 {
+    unit_spelling_hash = g_hash_table_new_full(g_str_hash,
+                                               g_str_equal,
+                                               g_free,
+                                               g_free);
+    for(int i = 0; UNIT_DEFINITIONS[i].names; i++){
+        register_unit_spellings(&UNIT_DEFINITIONS[i]);
+    }
 	GError *err = NULL;
-	unit_regex = g_regex_new(
+#ifdef UNIT_CONVERTOR_DEBUG
+	unit_regex = regex_registry_lookup(
         "\\b\n"
         "(?<value>[-+]?[0-9]*\\,?[0-9]*\\.?[0-9]+([eE][-+]?[0-9]+)?)\\s?\n"
         "(?<multiplier>hundred|k(ilo)?|thousand|(m|b)(illion)?\\s)?(-\\R+)?\n"
@@ -68,12 +403,13 @@ unit_convertor_module_init(void)
 		g_print("regex error.\ndomain:  %d, \ncode: %d, \nmessage: %s\n",
                 err->domain, err->code, err->message);
 	}
-
     err = NULL;
-    comma_regex = g_regex_new(",",
-                              0,
-                              0,
-                              &err);
+#endif
+
+    comma_regex = regex_registry_lookup(",",
+                                        0,
+                                        0,
+                                        &err);
     if(!comma_regex){
         g_print("comma_regex error. pattern: %s \ndomain: %d, \ncode: %d, \nmessage: %s\n",
                 ",",
@@ -81,13 +417,29 @@ unit_convertor_module_init(void)
                 err->code, 
                 err->message);
     }
+    err = NULL;
+    zero_regex = regex_registry_lookup("^0+$",
+                                       0,
+                                       0,
+                                       &err);
+    if(!zero_regex){
+        g_print("zero_regex error. pattern: %s \ndomain: %d, \ncode: %d, \nmessage: %s\n",
+                "^0+$",
+                err->domain, 
+                err->code, 
+                err->message);
+    }
 }
 
 void
 unit_convertor_module_destroy(void)
 {
+#ifdef UNIT_CONVERTOR_DEBUG
     g_regex_unref(unit_regex);
+#endif
     g_regex_unref(comma_regex);
+    g_regex_unref(zero_regex);
+    g_hash_table_unref(unit_spelling_hash);
 }
 
 ConvertedUnit *
@@ -102,6 +454,9 @@ converted_unit_new(void)
     cv->unit = NULL;
     cv->value_str = NULL;
     cv->find_results = NULL;
+    cv->match_offsets = g_array_new(FALSE,
+                                    FALSE,
+                                    sizeof(int));
     return cv;
 }
 
@@ -123,937 +478,296 @@ converted_unit_free(ConvertedUnit *cv)
         list_p = list_p->next;
     }
     g_list_free(cv->find_results);
+    g_array_unref(cv->match_offsets);
     g_free(cv);
 }
 
 static double
 get_multiplier (const char *multiplier_str)
 {
-    double multiplier = 1.0;
-    if(g_regex_match_simple("^hundred$",
-                            multiplier_str,
-                            G_REGEX_CASELESS,
-                            0))
-    {
-        multiplier = 1e+2;
-    }
-    else if(g_regex_match_simple("^(k(ilo)?|thousand)$",
-                            multiplier_str,
-                            G_REGEX_CASELESS,
-                            0))
-    {
-        multiplier = 1e+3;
+    if(!multiplier_str){
+        return 1.0;
     }
-    else if(g_regex_match_simple("^m(illion)?$",
-                            multiplier_str,
-                            G_REGEX_CASELESS,
-                            0))
-    {
-        multiplier = 1e+6;
-    }
-    else if(g_regex_match_simple("^b(illion)?$",
-                            multiplier_str,
-                            G_REGEX_CASELESS,
-                            0))
-    {
-        multiplier = 1e+9;
+    for(int i = 0; MULTIPLIERS[i].name; i++){
+        if(g_ascii_strcasecmp(MULTIPLIERS[i].name,
+                              multiplier_str) == 0)
+        {
+            return MULTIPLIERS[i].value;
+        }
     }
-    return multiplier;
+    return 1.0;
 }
 
-static Measurement
+static const Measurement *
 get_target_measurement (const char *unit)
 {
-    Measurement measurement;
-    /* imerial to si */
-    /* length, base unit is meters */
-    if(g_regex_match_simple("^thou$",
-                            unit,
-                            G_REGEX_CASELESS,
-                            0))
-    {
-        measurement.system = SI;
-        measurement.type = Length;
-        measurement.factor = 0.0000254;
-    }
-    else if(g_regex_match_simple("^(inch(es)?|\")$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = SI;
-        measurement.type = Length;
-        measurement.factor = 0.0254;
-    }
-    else if(g_regex_match_simple("^(f(oo|ee)?t|\')$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = SI;
-        measurement.type = Length;
-        measurement.factor = 0.3048;
-    }
-    else if(g_regex_match_simple("^(yards?|yd)$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = SI;
-        measurement.type = Length;
-        measurement.factor = 0.9144;
-    }
-    else if(g_regex_match_simple("^ch(ains?)?$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = SI;
-        measurement.type = Length;
-        measurement.factor = 20.1168;
-    }
-    else if(g_regex_match_simple("^fur(longs?)?$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = SI;
-        measurement.type = Length;
-        measurement.factor = 201.168;
-    }
-    else if(g_regex_match_simple("^mi(les?)?$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = SI;
-        measurement.type = Length;
-        measurement.factor = 1609.344;
-    }
-    else if(g_regex_match_simple("^lea(gues?)?$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = SI;
-        measurement.type = Length;
-        measurement.factor = 4828.032;
-    }
-    else if(g_regex_match_simple("^(fathoms?|ftm)$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = SI;
-        measurement.type = Length;
-        measurement.factor = 1.852;
-    }
-    else if(g_regex_match_simple("^cables?$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = SI;
-        measurement.type = Length;
-        measurement.factor = 185.2;
-    }
-    else if(g_regex_match_simple("^(nautical(\\R|\\s)?miles?|nmi)$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = SI;
-        measurement.type = Length;
-        measurement.factor = 1852;
-    }
-    else if(g_regex_match_simple("^links?$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = SI;
-        measurement.type = Length;
-        measurement.factor = 0.201168;
-    }
-    else if(g_regex_match_simple("^rods?$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = SI;
-        measurement.type = Length;
-        measurement.factor = 5.0292;
-    }
-    /* area, base unit is square meters */
-    else if(g_regex_match_simple("^sq(uare)?(\\R|\\s)?(in(ch(es)?)?|\")$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = SI;
-        measurement.type = Area;
-        measurement.factor = 0.00064516;
-    }
-    else if(g_regex_match_simple("^sq(uare)?(\\R|\\s)?(f(oo|ee)?t|\')$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = SI;
-        measurement.type = Area;
-        measurement.factor = 0.092903;
-    }
-    else if(g_regex_match_simple("^sq(uare)?(\\R|\\s)?(yards?|yd)$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = SI;
-        measurement.type = Area;
-        measurement.factor = 0.836127;
-    }
-    else if(g_regex_match_simple("^sq(uare)?(\\R|\\s)?mi(les?)?$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = SI;
-        measurement.type = Area;
-        measurement.factor = 2.59e+6;
-    }
-    else if(g_regex_match_simple("^perchs?$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = SI;
-        measurement.type = Area;
-        measurement.factor = 25.29285264;
-    }
-    else if(g_regex_match_simple("^roods?$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = SI;
-        measurement.type = Area;
-        measurement.factor = 1011.7141056;
-    }
-    else if(g_regex_match_simple("^acres?$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = SI;
-        measurement.type = Area;
-        measurement.factor = 4046.86;
-    }
-    /* volume, base unit is liters */
-    else if(g_regex_match_simple("^gi(lls?)?$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = SI;
-        measurement.type = Volume;
-        measurement.factor = 0.1420653125;
-    }
-    else if(g_regex_match_simple("^pints?$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = SI;
-        measurement.type = Volume;
-        measurement.factor = 0.56826125;
-    }
-    else if(g_regex_match_simple("^(quarts?|qt)$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = SI;
-        measurement.type = Volume;
-        measurement.factor = 1.1365225;
-    }
-    else if(g_regex_match_simple("^gal(lons?)?$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = SI;
-        measurement.type = Volume;
-        measurement.factor = 4.54609;
-    }
-    else if(g_regex_match_simple("^(teaspoons?|tsp)$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = SI;
-        measurement.type = Volume;
-        measurement.factor = 0.00492892159375;
-    }
-    else if(g_regex_match_simple("^(tablespoons?|tbsp)$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {        
-        measurement.system = SI;
-        measurement.type = Volume;
-        measurement.factor = 0.01478676478125;
-    }
-    else if(g_regex_match_simple("^cu(bic)?(\\R|\\s)?(in(ch(es)?)?|in3)$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = SI;
-        measurement.type = Volume;
-        measurement.factor = 0.016387064;
-    }
-    else if(g_regex_match_simple("^(cu(bic)?(\\R|\\s)?(f(oo|ee)?t|\')|ft3)$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = SI;
-        measurement.type = Volume;
-        measurement.factor = 28.316846592;
-    }
-    else if(g_regex_match_simple("^(cu(bic)?(\\R|\\s)?(yards?|yd)|yd3)$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = SI;
-        measurement.type = Volume;
-        measurement.factor = 746.554857984;
-    }
-    /* mass, base unit is grams */
-    else if(g_regex_match_simple("^gr(ains?)?$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = SI;
-        measurement.type = Mass;
-        measurement.factor = 0.06479891;
-    }
-    else if(g_regex_match_simple("^drachms?$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = SI;
-        measurement.type = Mass;
-        measurement.factor = 1.7718451953125;
-    }
-    else if(g_regex_match_simple("^(ounces?|oz)$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = SI;
-        measurement.type = Mass;
-        measurement.factor = 28.349523125;
-    }
-    else if(g_regex_match_simple("^(pounds?|lbs?)$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = SI;
-        measurement.type = Mass;
-        measurement.factor = 453.59237;
-    }
-    else if(g_regex_match_simple("^stone$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = SI;
-        measurement.type = Mass;
-        measurement.factor = 6350.29318;
-    }
-    else if(g_regex_match_simple("^(hundredweights?|cwt)$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = SI;
-        measurement.type = Mass;
-        measurement.factor = 5.0802345443e+4;
-    }
-    else if(g_regex_match_simple("^tons?$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = SI;
-        measurement.type = Mass;
-        measurement.factor = 1.016047e+6;
-    }   
-    /* temperature */
-    else if(g_regex_match_simple("^((deg(rees?)?)?\\s?fahrenheit|\\x2109)$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = SI;
-        measurement.type = Temperature;
-        measurement.factor = 1;
-    }
-    /* velocity */
-    /* base unit is m/s */
-    else if(g_regex_match_simple("^in(ch(es)?)?\\s?(per|/)\\s?s(ec(ond)?s?)?$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = SI;
-        measurement.type = Velocity;
-        measurement.factor = 2.54e-2;        
-    }
-    else if(g_regex_match_simple("^in(ch(es)?)?\\s?(per|/)\\s?m(in(ute)?s?)?$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = SI;
-        measurement.type = Velocity;
-        measurement.factor = 4.233333333e-4;
-    }
-    else if(g_regex_match_simple("^in(ch(es)?)?\\s?(per|/)\\s?h(ours?)?$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = SI;
-        measurement.type = Velocity;
-        measurement.factor = 7.05556e-6;    
-    }
-    else if(g_regex_match_simple("^f(oo|ee)?t\\s?(per|/)\\s?s(ec(ond)?s?)?$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = SI;
-        measurement.type = Velocity;
-        measurement.factor = 0.3048;        
-    }
-    else if(g_regex_match_simple("^(f(oo|ee)?t\\s?(per|/)\\s?m(in(ute)?s?)?|fpm)$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = SI;
-        measurement.type = Velocity;
-        measurement.factor = 5.08e-3;
-    }
-    else if(g_regex_match_simple("^(f(oo|ee)?t\\s?(per|/)\\s?h(ours?)?|fth|fph)$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = SI;
-        measurement.type = Velocity;
-        measurement.factor =  8.466667e-5;    
-    }
-    else if(g_regex_match_simple("^((yards?|yd)\\s?(per|/)\\s?s(ec(ond)?s?)?|yds)$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = SI;
-        measurement.type = Velocity;
-        measurement.factor = 0.9;        
-    }
-    else if(g_regex_match_simple("^((yards?|yd)\\s?(per|/)\\s?m(in(ute)?s?)?|ydm)$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = SI;
-        measurement.type = Velocity;
-        measurement.factor = 1.5e-2;
-    }
-    else if(g_regex_match_simple("^((yards?|yd)\\s?(per|/)\\s?h(ours?)?|ydh)$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = SI;
-        measurement.type = Velocity;
-        measurement.factor = 2.5e-4;    
-    }
-    else if(g_regex_match_simple("^(mi(les?)?\\s?(per|/)\\s?s(ec(ond)?s?)?|mps)$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = SI;
-        measurement.type = Velocity;
-        measurement.factor = 1609.344;        
-    }
-    else if(g_regex_match_simple("^(mi(les?)?\\s?(per|/)\\s?m(in(ute)?s?)?|mpm)$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = SI;
-        measurement.type = Velocity;
-        measurement.factor = 26.8224;
-    }
-    else if(g_regex_match_simple("^(mi(les?)?\\s?(per|/)\\s?h(ours?)?|mph|mp\\s?/\\s?h)$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = SI;
-        measurement.type = Velocity;
-        measurement.factor = 0.44704;    
-    }
-    else if(g_regex_match_simple("^(n(autical\\s?)?m(iles?)?|nm\\s?/\\s?h|kn(ots?)?)$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = SI;
-        measurement.type = Velocity;
-        measurement.factor = 0.514772;    
-    }
-    
-    else if(g_regex_match_simple("^furlongs?(per|/)fortnights?$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = SI;
-        measurement.type = Velocity;
-        measurement.factor = 1.663095e-4;    
-    }
-    /* si to imperial */
-    /* length, base unit is feet */
-    else if(g_regex_match_simple("^(nano(\\R|\\s)?(metres?|meters?)|nm)$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = Imperial;
-        measurement.type = Length;
-        measurement.factor = 3.28084 / 1e+9;
-    }
-    else if(g_regex_match_simple("^(micro(\\R|\\s)?(metres?|meters?)|\\x00b5m)$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = Imperial;
-        measurement.type = Length;
-        measurement.factor = 3.28084 / 1e+6;
-    }
-    else if(g_regex_match_simple("^(milli(\\R|\\s)?(metres?|meters?)|mm)$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = Imperial;
-        measurement.type = Length;
-        measurement.factor = 3.28084 / 1e+3;
-    }
-    else if(g_regex_match_simple("^(centi(\\R|\\s)?(metres?|meters?)|cm)$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = Imperial;
-        measurement.type = Length;
-        measurement.factor = 3.28084 / 1e+2;
-    }
-    else if(g_regex_match_simple("^deci(\\R|\\s)?(metres?|meters?)$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = Imperial;
-        measurement.type = Length;
-        measurement.factor = 3.28084 / 1e+1;
-    }
-    else if(g_regex_match_simple("^m(etres?|eters?)?$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = Imperial;
-        measurement.type = Length;
-        measurement.factor = 3.28084;
-    }
-    else if(g_regex_match_simple("^(kilo(metres?|meters?)|km)$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = Imperial;
-        measurement.type = Length;
-        measurement.factor = 3.28084 * 1e+3;
-    }
-    /* area, base unit is square feet */
-    else if(g_regex_match_simple("^sq(uare)?(\\R|\\s)?(nano(\\R|\\s)?(metres?|meters?)|nm)$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = Imperial;
-        measurement.type = Area;
-        measurement.factor = 10.7639 / 1e+18;
-    }
-    else if(g_regex_match_simple("^sq(uare)?(\\R|\\s)?(micro(\\R|\\s)?(metres?|meters?)|\\x00b5m)$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = Imperial;
-        measurement.type = Area;
-        measurement.factor = 10.7639 / 1e+12;
-    }
-    else if(g_regex_match_simple("^sq(uare)?(\\R|\\s)?(milli(\\R|\\s)?(metres?|meters?)|mm)$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = Imperial;
-        measurement.type = Area;
-        measurement.factor = 10.7639 / 1e+6;
-    }
-    else if(g_regex_match_simple("^sq(uare)?(\\R|\\s)?(centi(\\R|\\s)?(metres?|meters?)|cm)$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = Imperial;
-        measurement.type = Area;
-        measurement.factor = 10.7639 / 1e+4;
-    }
-    else if(g_regex_match_simple("^sq(uare)?(\\R|\\s)?(metres?|meters?|m)$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = Imperial;
-        measurement.type = Area;
-        measurement.factor = 10.7639;
-    }
-    else if(g_regex_match_simple("^sq(uare)?(\\R|\\s)?(kilo(\\R|\\s)?(metres?|meters?)|km)$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = Imperial;
-        measurement.type = Area;
-        measurement.factor = 10.7639 * 1e+6;
-    }
-    else if(g_regex_match_simple("^hectares?$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = Imperial;
-        measurement.type = Area;
-        measurement.factor = 10.7639 * 1e+4;
-    }
-    /* volume, base unit is cubic feet */
-    else if(g_regex_match_simple("^(milli(\\R|\\s)?l(itres?|iters?)?|ml)$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = Imperial;
-        measurement.type = Volume;
-        measurement.factor = 0.035314667 / 1e+3;
-    }
-    else if(g_regex_match_simple("^l(itres?|iters?)?$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
+    char normalized[MAX_UNIT_LENGTH];
+    if(!normalize_unit(unit,
+                       -1,
+                       normalized))
     {
-        measurement.system = Imperial;
-        measurement.type = Volume;
-        measurement.factor = 0.035314667;
+        return NULL;
     }
-    else if(g_regex_match_simple("^(cu(bic)?(\\R|\\s)?m(etres?|eters?)?|m3)$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = Imperial;
-        measurement.type = Volume;
-        measurement.factor = 0.035314667 * 1e+3;
-    }
-    /* mass, base unit is pounds */
-    else if(g_regex_match_simple("^nano(\\R|\\s)?grams?$", 
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = Imperial;
-        measurement.type = Mass;
-        measurement.factor = 0.00220462 / 1e+9;
-    }
-    else if(g_regex_match_simple("^micro(\\R|\\s)?grams?$", 
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0)){
-        measurement.system = Imperial;
-        measurement.type = Mass;
-        measurement.factor = 0.00220462 / 1e+6;
-    }
-    else if(g_regex_match_simple("^(milli(\\R|\\s)?grams?|mg)$", 
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = Imperial;
-        measurement.type = Mass;
-        measurement.factor = 0.00220462 / 1e+3;
-    }
-    else if(g_regex_match_simple("^g(rams?)?$", 
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = Imperial;
-        measurement.type = Mass;
-        measurement.factor = 0.00220462 ;
-    }
-    else if(g_regex_match_simple("^kg$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0)){
-        measurement.system = Imperial;
-        measurement.type = Mass;
-        measurement.factor = 0.00220462 * 1e+3;
-    }
-    else if(g_regex_match_simple("^((metric)?(\\R|\\s)?ton(nes?)?|mt)$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = Imperial;
-        measurement.type = Mass;
-        measurement.factor = 0.00220462 * 1e+6;
-    }
-    else if(g_regex_match_simple("^kt$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = Imperial;
-        measurement.type = Mass;
-        measurement.factor = 0.00220462 * 1e+9;
-    }
-    /* temperature */
-    else if(g_regex_match_simple("^(deg(rees?)?)?(\\R|\\s)?celsius|\\x2103$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = Imperial;
-        measurement.type = Temperature;
-        measurement.factor = 1;
-    }
-    /* velocity, base unit is ft/s */
-    else if(g_regex_match_simple("^nano?\\s?m(etres?|eters?)?\\s?(per|/)\\s?s(ec(ond)?s?)?$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = Imperial;
-        measurement.type = Velocity;
-        measurement.factor = 3.280839895e-9;
-    }
-    else if(g_regex_match_simple("^nano?\\s?m(etres?|eters?)?\\s?(per|/)\\s?m(in(ute)?s?)?$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = Imperial;
-        measurement.type = Velocity;
-        measurement.factor = 5.4680665e-11;
-    }
-    else if(g_regex_match_simple("^nano?\\s?m(etres?|eters?)?\\s?(per|/)\\s?h(ours?)?$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = Imperial;
-        measurement.type = Velocity;
-        measurement.factor = 9.1134442e-13;
-    }
-    else if(g_regex_match_simple("^micro?\\s?m(etres?|eters?)?\\s?(per|/)\\s?s(ec(ond)?s?)?$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = Imperial;
-        measurement.type = Velocity;
-        measurement.factor = 3.280839895e-6;
-    }
-    else if(g_regex_match_simple("^micro?\\s?m(etres?|eters?)?\\s?(per|/)\\s?m(in(ute)?s?)?$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = Imperial;
-        measurement.type = Velocity;
-        measurement.factor = 5.4680665e-8;
-    }
-    else if(g_regex_match_simple("^micro?\\s?m(etres?|eters?)?\\s?(per|/)\\s?h(ours?)?$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = Imperial;
-        measurement.type = Velocity;
-        measurement.factor = 9.1134442e-10;
-    }
-    else if(g_regex_match_simple("^milli?\\s?m(etres?|eters?)?\\s?(per|/)\\s?s(ec(ond)?s?)?$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = Imperial;
-        measurement.type = Velocity;
-        measurement.factor = 3.280839895e-3;
-    }
-    else if(g_regex_match_simple("^milli?\\s?m(etres?|eters?)?\\s?(per|/)\\s?m(in(ute)?s?)?$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = Imperial;
-        measurement.type = Velocity;
-        measurement.factor = 5.4680665e-5;
-    }
-    else if(g_regex_match_simple("^milli?\\s?m(etres?|eters?)?\\s?(per|/)\\s?h(ours?)?$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = Imperial;
-        measurement.type = Velocity;
-        measurement.factor = 9.1134442e-7;
-    }
-    else if(g_regex_match_simple("^centi?\\s?m(etres?|eters?)?\\s?(per|/)\\s?s(ec(ond)?s?)?$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = Imperial;
-        measurement.type = Velocity;
-        measurement.factor = 3.280839895e-2;
-    }
-    else if(g_regex_match_simple("^centi?\\s?m(etres?|eters?)?\\s?(per|/)\\s?m(in(ute)?s?)?$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = Imperial;
-        measurement.type = Velocity;
-        measurement.factor = 5.4680665e-4;
+    UnitSpelling *unit_spelling = g_hash_table_lookup(unit_spelling_hash,
+                                                      normalized);
+    return unit_spelling ? unit_spelling->measurement : NULL;
+}
+
+/* 'feet per second' and 'degrees fahrenheit' span several words */
+#define MAX_UNIT_WORDS 4
+
+typedef struct
+{
+    /* byte offsets into the scanned text, ends are exclusive */
+    int start;
+    int end;
+    int value_end;
+    int multiplier_start;
+    int multiplier_end;
+    int unit_start;
+}UnitToken;
+
+static gboolean
+is_word_char(char c)
+{
+    return g_ascii_isalnum(c) || c == '_';
+}
+
+static int
+skip_hyphenation(const char *text,
+                 int         pos)
+{
+    /* 'sq-\nft' */
+    if(text[pos] == '-' && (text[pos + 1] == '\n' || text[pos + 1] == '\r')){
+        pos++;
+        while(text[pos] == '\n' || text[pos] == '\r'){
+            pos++;
+        }
     }
-    else if(g_regex_match_simple("^centi?\\s?m(etres?|eters?)?\\s?(per|/)\\s?h(ours?)?$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = Imperial;
-        measurement.type = Velocity;
-        measurement.factor = 9.1134442e-6;
+    return pos;
+}
+
+static int
+unit_char_length(const char *p)
+{
+    /* byte length of the unit character at p, 0 if there is none */
+    if(g_ascii_isalnum(*p) || *p == '/' || *p == '"' || *p == '\''){
+        return 1;
     }
-    else if(g_regex_match_simple("^deci?\\s?m(etres?|eters?)?\\s?(per|/)\\s?s(ec(ond)?s?)?$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = Imperial;
-        measurement.type = Velocity;
-        measurement.factor = 3.2808399e-1;
+    if((guchar)*p < 0x80){
+        return 0;
     }
-    else if(g_regex_match_simple("^deci?\\s?m(etres?|eters?)?\\s?(per|/)\\s?m(in(ute)?s?)?$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = Imperial;
-        measurement.type = Velocity;
-        measurement.factor = 5.468066e-3;
+    gunichar c = g_utf8_get_char_validated(p,
+                                           -1);
+    /* micro sign, greek mu, degree fahrenheit and degree celsius */
+    if(c == 0x00b5 || c == 0x03bc || c == 0x2109 || c == 0x2103){
+        return g_utf8_next_char(p) - p;
     }
-    else if(g_regex_match_simple("^deci?\\s?m(etres?|eters?)?\\s?(per|/)\\s?h(ours?)?$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = Imperial;
-        measurement.type = Velocity;
-        measurement.factor = 9.1134e-5;
+    return 0;
+}
+
+static int
+scan_number(const char *text,
+            int         pos)
+{
+    /*
+       1, 1.5, .5, 1,000,000.25, 1e-3. returns the end of the number, pos if
+       there is none.
+    */
+    int p = pos,
+        num_digits = 0;
+    while(g_ascii_isdigit(text[p])){
+        p++;
+        num_digits++;
+    }
+    while(num_digits > 0 && text[p] == ',' && g_ascii_isdigit(text[p + 1])){
+        p++;
+        while(g_ascii_isdigit(text[p])){
+            p++;
+        }
     }
-    else if(g_regex_match_simple("^m(etres?|eters?)?\\s?(per|/)\\s?s(ec(ond)?s?)?$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = Imperial;
-        measurement.type = Velocity;
-        measurement.factor = 3.280839895;
+    if(text[p] == '.' && g_ascii_isdigit(text[p + 1])){
+        p++;
+        while(g_ascii_isdigit(text[p])){
+            p++;
+            num_digits++;
+        }
     }
-    else if(g_regex_match_simple("m(etres?|eters?)?\\s?(per|/)\\s?m(in(ute)?s?)?$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = Imperial;
-        measurement.type = Velocity;
-        measurement.factor = 5.4680665e-2;
+    if(num_digits == 0){
+        return pos;
     }
-    else if(g_regex_match_simple("m(etres?|eters?)?\\s?(per|/)\\s?h(ours?)?$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = Imperial;
-        measurement.type = Velocity;
-        measurement.factor = 9.1134442e-4;
+    if(text[p] == 'e' || text[p] == 'E'){
+        int q = p + 1;
+        if(text[q] == '+' || text[q] == '-'){
+            q++;
+        }
+        if(g_ascii_isdigit(text[q])){
+            while(g_ascii_isdigit(text[q])){
+                q++;
+            }
+            p = q;
+        }
     }
-    else if(g_regex_match_simple("^kilom(etres?|eters?)?\\s?(per|/)\\s?s(ec(ond)?s?)?$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = Imperial;
-        measurement.type = Velocity;
-        measurement.factor = 3.280839895e+3;
+    return p;
+}
+
+static int
+scan_multiplier(const char *text,
+                int         pos)
+{
+    for(int i = 0; MULTIPLIERS[i].name; i++){
+        int len = strlen(MULTIPLIERS[i].name);
+        if(g_ascii_strncasecmp(text + pos,
+                               MULTIPLIERS[i].name,
+                               len) == 0 &&
+           (!MULTIPLIERS[i].needs_space || g_ascii_isspace(text[pos + len])))
+        {
+            return pos + len;
+        }
     }
-    else if(g_regex_match_simple("^kilom(etres?|eters?)?(per|/)\\s?m(in(ute)?s?)?$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = Imperial;
-        measurement.type = Velocity;
-        measurement.factor = 54.680664917;
+    return pos;
+}
+
+static int
+scan_unit(const char *text,
+          int         pos)
+{
+    /*
+       collect up to MAX_UNIT_WORDS words separated by a whitespace or a
+       hyphenated line break and take the longest run of them that spells a
+       known unit broken into words only where that unit may be(see
+       UnitSpelling), so '200 m ph' is not mph. returns the end of the unit,
+       pos if there is none.
+    */
+    int word_starts[MAX_UNIT_WORDS];
+    int word_ends[MAX_UNIT_WORDS];
+    int num_words = 0;
+    int p = pos;
+    while(num_words < MAX_UNIT_WORDS){
+        if(g_ascii_isdigit(text[p]) || unit_char_length(text + p) == 0){
+            break;
+        }
+        word_starts[num_words] = p;
+        int len;
+        while((len = unit_char_length(text + p)) > 0){
+            p += len;
+        }
+        word_ends[num_words++] = p;
+        int q = p;
+        if(g_ascii_isspace(text[q])){
+            q++;
+        }
+        q = skip_hyphenation(text,
+                             q);
+        if(q == p){
+            break;
+        }
+        p = q;
     }
-    else if(g_regex_match_simple("^(kilom(etres?|eters?)?(per|/)\\s?h(ours?)?|k(mh|ph|m\\s?/\\s?h))$",
-                                 unit,
-                                 G_REGEX_CASELESS,
-                                 0))
-    {
-        measurement.system = Imperial;
-        measurement.type = Velocity;
-        measurement.factor = 0.911344415;
+    char normalized[MAX_UNIT_LENGTH];
+    for(int i = num_words - 1; i >= 0; i--){
+        if(!normalize_unit(text + pos,
+                           word_ends[i] - pos,
+                           normalized))
+        {
+            continue;
+        }
+        UnitSpelling *unit_spelling = g_hash_table_lookup(unit_spelling_hash,
+                                                          normalized);
+        if(!unit_spelling){
+            continue;
+        }
+        /* where each later word starts within the normalized spelling */
+        gboolean is_split_allowed = TRUE;
+        char leading[MAX_UNIT_LENGTH];
+        for(int j = 1; j <= i && is_split_allowed; j++){
+            normalize_unit(text + pos,
+                           word_starts[j] - pos,
+                           leading);
+            guint64 word_break = G_GUINT64_CONSTANT(1) << strlen(leading);
+            is_split_allowed = (unit_spelling->word_breaks & word_break) != 0;
+        }
+        if(is_split_allowed){
+            return word_ends[i];
+        }
     }
+    return pos;
+}
 
-    return measurement;
+static gboolean
+scan_next_unit(const char *text,
+               int        *pos,
+               UnitToken  *token)
+{
+    /*
+       a single forward pass: find the next number that starts a word, then
+       an optional multiplier and a unit right after it.
+       '-5 kilo-\nmeters' > value: '-5', multiplier: 'kilo', unit: 'meters'
+    */
+    int p = *pos;
+    while(text[p]){
+        gboolean is_number_start = (g_ascii_isdigit(text[p]) ||
+                                    (text[p] == '.' && g_ascii_isdigit(text[p + 1]))) &&
+                                   (p == 0 || !is_word_char(text[p - 1]));
+        if(!is_number_start){
+            p++;
+            continue;
+        }
+        int value_end = scan_number(text,
+                                    p);
+        if(value_end == p){
+            p++;
+            continue;
+        }
+        token->start = p;
+        if(p > 0 && (text[p - 1] == '-' || text[p - 1] == '+') &&
+           (p == 1 || !g_ascii_isalnum(text[p - 2])))
+        {
+            token->start = p - 1;
+        }
+        token->value_end = value_end;
+        int q = value_end;
+        if(g_ascii_isspace(text[q])){
+            q++;
+        }
+        /* 1: with a multiplier, e.g. '5 million miles' */
+        int multiplier_end = scan_multiplier(text,
+                                             q);
+        if(multiplier_end > q){
+            int unit_start = multiplier_end;
+            if(g_ascii_isspace(text[unit_start])){
+                unit_start++;
+            }
+            unit_start = skip_hyphenation(text,
+                                          unit_start);
+            int unit_end = scan_unit(text,
+                                     unit_start);
+            if(unit_end > unit_start){
+                token->multiplier_start = q;
+                token->multiplier_end = multiplier_end;
+                token->unit_start = unit_start;
+                token->end = unit_end;
+                *pos = unit_end;
+                return TRUE;
+            }
+        }
+        /* 2: without one, e.g. '5 m' */
+        int unit_start = skip_hyphenation(text,
+                                          q);
+        int unit_end = scan_unit(text,
+                                 unit_start);
+        if(unit_end > unit_start){
+            token->multiplier_start = q;
+            token->multiplier_end = q;
+            token->unit_start = unit_start;
+            token->end = unit_end;
+            *pos = unit_end;
+            return TRUE;
+        }
+        p = value_end;
+    }
+    *pos = p;
+    return FALSE;
 }
 
 static
@@ -1063,16 +777,19 @@ humanize (const char *value_str,
 		  const char *unit)
 {
 	double multiplier = get_multiplier(multiplier_str);
-	Measurement target_measurement = get_target_measurement(unit);
+	const Measurement *target_measurement = get_target_measurement(unit);
+    if(!target_measurement){
+        return NULL;
+    }
 	
 	double value = g_ascii_strtod(value_str,
 								  NULL);
     gboolean is_neg = value < 0;
-    value = fabs(value) * multiplier * target_measurement.factor;
+    value = fabs(value) * multiplier * target_measurement->factor;
 	ConvertedUnit *cv = converted_unit_new();
-    switch (target_measurement.system) {
+    switch (target_measurement->system) {
     case SI:
-        switch (target_measurement.type) {
+        switch (target_measurement->type) {
         case Length:
             if(value <= 1e-9){
                 cv->value = value * 1e+9;
@@ -1165,7 +882,7 @@ humanize (const char *value_str,
         }
         break;
     case Imperial:
-        switch (target_measurement.type) {
+        switch (target_measurement->type) {
         case Length:
             if(value < 1){
                 cv->value = value * 8;
@@ -1276,10 +993,120 @@ compare_units(gconstpointer a,
     return -diff;
 }
 
+static void
+add_converted_unit(GHashTable *unit_hash,
+                   char       *whole_match,
+                   char       *value,
+                   char       *multiplier,
+                   char       *unit,
+                   int         offset_start,
+                   int         offset_end,
+                   GList     **converted_units)
+{
+    /*
+       takes ownership of the strings. a unit seen before only gets the
+       offsets of this occurrence.
+    */
+    char *key = g_strdup_printf("%s %s %s",
+                                value,
+                                multiplier,
+                                unit);
+    ConvertedUnit *seen_cv = g_hash_table_lookup(unit_hash,
+                                                 key);
+    if(seen_cv){
+        g_array_append_val(seen_cv->match_offsets,
+                           offset_start);
+        g_array_append_val(seen_cv->match_offsets,
+                           offset_end);
+    }
+    else if(!g_regex_match(zero_regex,
+                           value,
+                           0,
+                           NULL))
+    {
+        char *comma_less_value = g_regex_replace(comma_regex,
+                                                 value,
+                                                 -1,
+                                                 0,
+                                                 "",
+                                                 0, NULL);
+        ConvertedUnit *cv = humanize(comma_less_value,
+                                     multiplier,
+                                     unit);
+        g_free(comma_less_value);
+        if(cv){
+            cv->whole_match = whole_match;
+            cv->old_value = value;
+            cv->multiplier = multiplier;
+            cv->old_unit = unit;
+            g_array_append_val(cv->match_offsets,
+                               offset_start);
+            g_array_append_val(cv->match_offsets,
+                               offset_end);
+            *converted_units = g_list_insert_sorted(*converted_units,
+                                                    cv,
+                                                    compare_units);
+            g_hash_table_insert(unit_hash,
+                                key,
+                                cv);
+            return;
+        }
+        /* not a unit we know of */
+    }
+    g_free(key);
+    g_free(whole_match);
+    g_free(value);
+    g_free(multiplier);
+    g_free(unit);
+}
+
+static void
+free_unit_hash(GHashTable *unit_hash)
+{
+    GList *keys = g_hash_table_get_keys(unit_hash);
+    GList *list_p = keys;
+    while(list_p){
+        g_free((char*)list_p->data);
+        list_p = list_p->next;
+    }
+    g_list_free(keys);
+    g_hash_table_unref(unit_hash);
+}
+
 void
 convert_units(const char *text,
               GList     **converted_units)
 {   
+    GHashTable *unit_hash = g_hash_table_new(g_str_hash,
+                                             g_str_equal);
+    *converted_units = NULL;
+    UnitToken token;
+    int pos = 0;
+    while(scan_next_unit(text,
+                         &pos,
+                         &token))
+    {
+        add_converted_unit(unit_hash,
+                           g_strndup(text + token.start,
+                                     token.end - token.start),
+                           g_strndup(text + token.start,
+                                     token.value_end - token.start),
+                           g_strndup(text + token.multiplier_start,
+                                     token.multiplier_end - token.multiplier_start),
+                           g_strndup(text + token.unit_start,
+                                     token.end - token.unit_start),
+                           token.start,
+                           token.end,
+                           converted_units);
+    }
+    free_unit_hash(unit_hash);
+}
+
+#ifdef UNIT_CONVERTOR_DEBUG
+static void
+convert_units_with_regex(const char *text,
+                         GList     **converted_units)
+{
     GHashTable *unit_hash = g_hash_table_new(g_str_hash,
                                              g_str_equal);
     *converted_units = NULL;
@@ -1289,61 +1116,77 @@ convert_units(const char *text,
                   0,
                   &match_info);
     while(g_match_info_matches(match_info)){
-        char *value = g_match_info_fetch_named(match_info,
-                                               "value");
-        char *multiplier = g_match_info_fetch_named(match_info,
-                                                    "multiplier");
-        multiplier = g_strchomp(multiplier);
-        char *unit = g_match_info_fetch_named(match_info,
-                                              "unit");
-        char *key = g_strdup_printf("%s %s %s",
-                                    value,
-                                    multiplier,
-                                    unit);
-        if(!g_hash_table_contains(unit_hash,
-                                  key) &&
-           !g_regex_match_simple("^0+$",
-                                 value,
-                                 0, 0))
-        {
-            char *comma_less_value = g_regex_replace(comma_regex,
-                                                     value,
-                                                     -1,
-                                                     0,
-                                                     "",
-                                                     0, NULL);
-            ConvertedUnit *cv = humanize(comma_less_value,
-                                         multiplier,
-                                         unit);            
-            cv->whole_match = g_match_info_fetch(match_info,
-                                                 0);
-            // g_print("unit: '%s'\n", cv->whole_match);
-            cv->old_value = value;
-            cv->multiplier = multiplier;
-            cv->old_unit = unit;
-            *converted_units = g_list_insert_sorted(*converted_units,
-                                                    cv,
-                                                    compare_units);
-            g_free(comma_less_value);
-            g_hash_table_add(unit_hash,
-                             key);
-        }
-        else{
-            g_free(key);
-            g_free(value);
-            g_free(unit);
-            g_free(multiplier);
-        }
+        int start, end;
+        g_match_info_fetch_pos(match_info,
+                               0,
+                               &start,
+                               &end);
+        add_converted_unit(unit_hash,
+                           g_match_info_fetch(match_info,
+                                              0),
+                           g_match_info_fetch_named(match_info,
+                                                    "value"),
+                           g_strchomp(g_match_info_fetch_named(match_info,
+                                                               "multiplier")),
+                           g_match_info_fetch_named(match_info,
+                                                    "unit"),
+                           start,
+                           end,
+                           converted_units);
         g_match_info_next(match_info,
                           NULL);
     }
     g_match_info_free(match_info);
-    GList *keys = g_hash_table_get_keys(unit_hash);
-    GList *list_p = keys;
-    while(list_p){
-        g_free((char*)list_p->data);
-        list_p = list_p->next;
-    }
-    g_list_free(keys);
-    g_hash_table_unref(unit_hash);
-}
\ No newline at end of file
+    free_unit_hash(unit_hash);
+}
+
+void
+unit_convertor_compare(const char *text)
+{
+    /*
+       run the scanner and the former regex on text, report where they
+       disagree and how long each took.
+    */
+    GList *scanned = NULL,
+          *matched = NULL;
+    gint64 t0 = g_get_monotonic_time();
+    convert_units(text,
+                  &scanned);
+    gint64 t1 = g_get_monotonic_time();
+    convert_units_with_regex(text,
+                             &matched);
+    gint64 t2 = g_get_monotonic_time();
+    int num_mismatches = 0;
+    GList *scanned_p = scanned,
+          *matched_p = matched;
+    while(scanned_p || matched_p){
+        ConvertedUnit *a = scanned_p ? scanned_p->data : NULL;
+        ConvertedUnit *b = matched_p ? matched_p->data : NULL;
+        if(!a || !b ||
+           g_strcmp0(a->old_value, b->old_value) != 0 ||
+           g_strcmp0(a->multiplier, b->multiplier) != 0 ||
+           g_strcmp0(a->old_unit, b->old_unit) != 0 ||
+           g_strcmp0(a->value_str, b->value_str) != 0)
+        {
+            g_print("unit mismatch: scanner: '%s', regex: '%s'\n",
+                    a ? a->whole_match : "",
+                    b ? b->whole_match : "");
+            num_mismatches++;
+        }
+        scanned_p = scanned_p ? scanned_p->next : NULL;
+        matched_p = matched_p ? matched_p->next : NULL;
+    }
+    gsize num_bytes = strlen(text);
+    g_print("units: %d scanned, %d matched, %d mismatches\n"
+            "scanner: %.2f MB/s, regex: %.2f MB/s\n",
+            g_list_length(scanned),
+            g_list_length(matched),
+            num_mismatches,
+            num_bytes / (double)MAX(t1 - t0, 1),
+            num_bytes / (double)MAX(t2 - t1, 1));
+    g_list_free_full(scanned,
+                     (GDestroyNotify)converted_unit_free);
+    g_list_free_full(matched,
+                     (GDestroyNotify)converted_unit_free);
+}
+#endif
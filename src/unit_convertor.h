@@ -57,6 +57,8 @@ struct ConvertedUnit
 	char *unit;
     char *value_str;
     GList *find_results;
+    /* start/end byte offsets of every occurrence in the text, pairwise */
+    GArray *match_offsets;
 };
 
 void 
@@ -75,4 +77,9 @@ void
 convert_units(const char *text,
 			  GList      **converted_units);
 
+#ifdef UNIT_CONVERTOR_DEBUG
+void
+unit_convertor_compare(const char *text);
+#endif
+
 #endif
\ No newline at end of file
@@ -0,0 +1,106 @@
+/*
+ * Copyright © 2020 Reza Hasanzadeh
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 3.0 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/*
+   the SSE2 and AVX2 page filter kernels have to give the scalar ones'
+   result byte for byte. runs every kernel on random buffers of many lengths
+   and alignments. build and run with 'make check'.
+*/
+
+#include "../src/page_filter.c"
+#include <string.h>
+
+#define MAX_TEST_LENGTH 4200
+#define NUM_ROUNDS 8
+
+typedef struct
+{
+    const char *isa;
+    KernelFunc kernels[NumKernels];
+}KernelSet;
+
+static int
+compare_kernels(const KernelSet *reference,
+                const KernelSet *candidate,
+                GRand           *rand)
+{
+    int num_failures = 0;
+    guint8 *input = g_malloc(MAX_TEST_LENGTH + 32);
+    guint8 *expected = g_malloc(MAX_TEST_LENGTH + 32);
+    guint8 *actual = g_malloc(MAX_TEST_LENGTH + 32);
+    for(int kernel = 0; kernel < NumKernels; kernel++){
+        for(int round = 0; round < NUM_ROUNDS; round++){
+            for(gsize length = 0; length <= MAX_TEST_LENGTH; length += length < 300 ? 1 : 97){
+                /* unaligned starts too, the kernels use unaligned loads */
+                gsize offset = g_rand_int_range(rand, 0, 32);
+                for(gsize i = 0; i < length; i++){
+                    input[offset + i] = g_rand_int_range(rand, 0, 256);
+                }
+                memcpy(expected + offset, input + offset, length);
+                memcpy(actual + offset, input + offset, length);
+                reference->kernels[kernel](expected + offset,
+                                           length);
+                candidate->kernels[kernel](actual + offset,
+                                           length);
+                if(memcmp(expected + offset, actual + offset, length) != 0){
+                    g_print("%s %s differs from %s at length %lu, offset %lu\n",
+                            candidate->isa,
+                            kernel_names[kernel],
+                            reference->isa,
+                            (unsigned long)length,
+                            (unsigned long)offset);
+                    num_failures++;
+                }
+            }
+        }
+    }
+    g_free(input);
+    g_free(expected);
+    g_free(actual);
+    return num_failures;
+}
+
+int
+main(void)
+{
+    KernelSet scalar = {"scalar", {invert_scalar, tint_scalar, contrast_scalar}};
+    GRand *rand = g_rand_new_with_seed(46);
+    int num_failures = 0,
+        num_checked = 0;
+#ifdef HAVE_X86_KERNELS
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("sse2")){
+        KernelSet sse2 = {"sse2", {invert_sse2, tint_sse2, contrast_sse2}};
+        num_failures += compare_kernels(&scalar,
+                                        &sse2,
+                                        rand);
+        num_checked++;
+    }
+    if(__builtin_cpu_supports("avx2")){
+        KernelSet avx2 = {"avx2", {invert_avx2, tint_avx2, contrast_avx2}};
+        num_failures += compare_kernels(&scalar,
+                                        &avx2,
+                                        rand);
+        num_checked++;
+    }
+#endif
+    g_rand_free(rand);
+    g_print("page filter kernels: %d vector sets checked against scalar, %d failures\n",
+            num_checked,
+            num_failures);
+    return num_failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,200 @@
+/*
+ * Copyright © 2020 Reza Hasanzadeh
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 3.0 of the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/*
+   the unit scanner has to find what the former regex found. runs both on
+   short synthetic texts: unit spellings, multipliers, units broken into
+   words, signed numbers and numbers with commas. the scanner knows better
+   than the regex in a few places on purpose, those texts are kept in a
+   mismatch corpus along with what each of them has to find. build and run
+   with 'make check'.
+*/
+
+#define UNIT_CONVERTOR_DEBUG
+#include "../src/unit_convertor.c"
+
+static const char *AGREEMENT_CORPUS[] = {
+    /* unit spellings */
+    "a 5 ft wall",
+    "3 feet of snow",
+    "2 inches",
+    "12 yd",
+    "7 miles away",
+    "7 mi",
+    "3 rods",
+    "5 nautical miles",
+    "1 acre of land",
+    "4 pints",
+    "2 gallons",
+    "3 oz",
+    "10 lbs",
+    "5 tons",
+    "2 tonnes",
+    "98 fahrenheit",
+    "40 degrees celsius",
+    "100 km",
+    "100 nm",
+    "5 mm",
+    "3 cm",
+    "2 kilometres",
+    "500 mg",
+    "2 litres",
+    "30 ml",
+    "60 mph",
+    "100 km/h",
+    "3 m/s",
+    "3 ft/s",
+    "5 sq ft",
+    "3 cubic feet",
+    "10 m2",
+    "4 hectares",
+    "5 FT and 5 Ft",
+    /* multipliers */
+    "5 million miles",
+    "2 billion tons",
+    "1 m km",
+    /* word breaks and hyphenated line breaks */
+    "5 sq-\nft",
+    "10 kilo-\nmeters",
+    "5 kilo meters",
+    /* not mph, 'm ph' may not break there */
+    "200 m ph",
+    "40 degrees\ncelsius",
+    /* numbers */
+    "1,000 feet",
+    "1e3 m",
+    "2.5e-3 mm",
+    /* not units */
+    "page 12 of 300",
+    "abc5 km",
+    "Item 3 in the list",
+    "5mmx",
+    "",
+    NULL
+};
+
+typedef struct
+{
+    const char *text;
+    /* whole matches, '|' separated */
+    const char *scanned;
+    const char *matched;
+}MismatchCase;
+
+static const MismatchCase MISMATCH_CORPUS[] = {
+    /* spellings the regex lacks or gets wrong(\x2109 is '!' then '09') */
+    {"12 kg", "12 kg", ""},
+    {"5 stone", "5 stone", ""},
+    {"2 square meters", "2 square meters", ""},
+    {"5 µm", "5 µm", ""},
+    {"25 ℃ and 77 ℉", "77 ℉|25 ℃", ""},
+    /* the regex wants the unit glued to these multipliers */
+    {"5 thousand feet", "5 thousand feet", ""},
+    {"3 k km", "3 k km", ""},
+    /* the regex allows a single comma and no sign outside a word */
+    {"1,000,000.5 km", "1,000,000.5 km", "000,000.5 km"},
+    {"-5 km", "-5 km", "5 km"},
+    {"+3 m", "+3 m", "3 m"},
+    /* a range or a word, not a sign */
+    {"between 3-5 km", "5 km", "-5 km"},
+    {"x-5 km", "5 km", "-5 km"},
+    {NULL, NULL, NULL}
+};
+
+static char *
+describe_units(GList *units)
+{
+    GString *description = g_string_new(NULL);
+    for(GList *list_p = units; list_p; list_p = list_p->next){
+        ConvertedUnit *cv = list_p->data;
+        g_string_append_printf(description,
+                               "%s%s",
+                               description->len > 0 ? "|" : "",
+                               cv->whole_match);
+    }
+    return g_string_free(description,
+                         FALSE);
+}
+
+static void
+run_both(const char  *text,
+         char       **scanned,
+         char       **matched)
+{
+    GList *scanned_units = NULL,
+          *matched_units = NULL;
+    convert_units(text,
+                  &scanned_units);
+    convert_units_with_regex(text,
+                             &matched_units);
+    *scanned = describe_units(scanned_units);
+    *matched = describe_units(matched_units);
+    g_list_free_full(scanned_units,
+                     (GDestroyNotify)converted_unit_free);
+    g_list_free_full(matched_units,
+                     (GDestroyNotify)converted_unit_free);
+}
+
+int
+main(void)
+{
+    int num_failures = 0,
+        num_checked = 0;
+    unit_convertor_module_init();
+    for(int i = 0; AGREEMENT_CORPUS[i]; i++){
+        char *scanned, *matched;
+        run_both(AGREEMENT_CORPUS[i],
+                 &scanned,
+                 &matched);
+        if(g_strcmp0(scanned, matched) != 0){
+            g_print("'%s': scanner: '%s', regex: '%s'\n",
+                    AGREEMENT_CORPUS[i],
+                    scanned,
+                    matched);
+            num_failures++;
+        }
+        g_free(scanned);
+        g_free(matched);
+        num_checked++;
+    }
+    for(int i = 0; MISMATCH_CORPUS[i].text; i++){
+        char *scanned, *matched;
+        run_both(MISMATCH_CORPUS[i].text,
+                 &scanned,
+                 &matched);
+        if(g_strcmp0(scanned, MISMATCH_CORPUS[i].scanned) != 0 ||
+           g_strcmp0(matched, MISMATCH_CORPUS[i].matched) != 0)
+        {
+            g_print("'%s': scanner: '%s', expected '%s', regex: '%s', expected '%s'\n",
+                    MISMATCH_CORPUS[i].text,
+                    scanned,
+                    MISMATCH_CORPUS[i].scanned,
+                    matched,
+                    MISMATCH_CORPUS[i].matched);
+            num_failures++;
+        }
+        g_free(scanned);
+        g_free(matched);
+        num_checked++;
+    }
+    unit_convertor_module_destroy();
+    regex_registry_module_destroy();
+    g_print("unit convertor: %d texts checked, %d failures\n",
+            num_checked,
+            num_failures);
+    return num_failures > 0 ? 1 : 0;
+}